@@ -11,17 +11,238 @@
 #include <iomanip>
 #include <list>
 #include <set>
+#include <map>
+#include <queue>
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <sstream>
 #include <functional>
 #include <stdexcept>
-#include <regex>
+#include <string_view>
+#include <charconv>
 #include <cctype>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstring>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <future>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h> // console mode, for ANSI escape sequences
+#else
+#include <poll.h>    // whether console input is waiting
+#endif
 using namespace std;
 
+// Length of a budget period; weeks start on Monday
+enum class BudgetPeriod { Weekly, Monthly, Yearly };
+
+// Result codes of the non-throwing parsers
+enum class ParseError {
+    None,
+    Empty,
+    NotNumeric,
+    LeadingDecimal,
+    OutOfRange,
+    BadDateFormat,
+    InvalidDate
+};
+
+// Calendar helpers working on day numbers (days since 1970-01-01)
+class DateUtil {
+public:
+    static int toDayNumber(int year, int month, int day) {
+        year -= month <= 2;
+        const int era = (year >= 0 ? year : year - 399) / 400;
+        const int yearOfEra = year - era * 400;
+        const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
+    }
+
+    static void fromDayNumber(int dayNumber, int& year, int& month, int& day) {
+        dayNumber += 719468;
+        const int era = (dayNumber >= 0 ? dayNumber : dayNumber - 146096) / 146097;
+        const int dayOfEra = dayNumber - era * 146097;
+        const int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const int monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = yearOfEra + era * 400 + (month <= 2);
+    }
+
+    // YYYY-MM-DD naming a real calendar day; the one date parser, for stored rows and input alike
+    static ParseError parse(string_view input, int& dayNumber) noexcept {
+        if (input.size() != 10 || input[4] != '-' || input[7] != '-') {
+            return ParseError::BadDateFormat;
+        }
+        int fields[3] = {0, 0, 0};
+        for (size_t i = 0, field = 0; i < input.size(); ++i) {
+            if (i == 4 || i == 7) {
+                field++;
+            } else if (input[i] >= '0' && input[i] <= '9') {
+                fields[field] = fields[field] * 10 + (input[i] - '0');
+            } else {
+                return ParseError::BadDateFormat;
+            }
+        }
+        int year = fields[0], month = fields[1], day = fields[2];
+        if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) {
+            return ParseError::InvalidDate;
+        }
+        dayNumber = toDayNumber(year, month, day);
+        return ParseError::None;
+    }
+
+    static bool toDayNumber(const string& date, int& dayNumber) {
+        return parse(date, dayNumber) == ParseError::None;
+    }
+
+    static string toString(int dayNumber) {
+        int year, month, day;
+        fromDayNumber(dayNumber, year, month, day);
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, day);
+        return buffer;
+    }
+
+    static bool isLeapYear(int year) {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    static int daysInMonth(int year, int month) {
+        static const int DAYS[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        return month == 2 && isLeapYear(year) ? 29 : DAYS[month - 1];
+    }
+
+    static int today() {
+        return dayOf(time(nullptr));
+    }
+
+    // Local day holding a time_t
+    static int dayOf(time_t instant) {
+        tm local = *localtime(&instant);
+        return toDayNumber(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+    }
+
+    // First day of the period holding dayNumber
+    static int periodStart(BudgetPeriod period, int dayNumber) {
+        if (period == BudgetPeriod::Weekly) {
+            return dayNumber - ((dayNumber % 7 + 10) % 7); // day 0 was a Thursday
+        }
+        int year, month, day;
+        fromDayNumber(dayNumber, year, month, day);
+        return period == BudgetPeriod::Monthly ? toDayNumber(year, month, 1) : toDayNumber(year, 1, 1);
+    }
+
+    // Last day of the period holding dayNumber
+    static int periodEnd(BudgetPeriod period, int dayNumber) {
+        int start = periodStart(period, dayNumber);
+        if (period == BudgetPeriod::Weekly) {
+            return start + 6;
+        }
+        int year, month, day;
+        fromDayNumber(start, year, month, day);
+        return period == BudgetPeriod::Monthly ? start + daysInMonth(year, month) - 1 : toDayNumber(year, 12, 31);
+    }
+
+    // Whole periods from the period starting at fromStart to the one starting at toStart
+    static int periodsBetween(BudgetPeriod period, int fromStart, int toStart) {
+        if (period == BudgetPeriod::Weekly) {
+            return (toStart - fromStart) / 7;
+        }
+        int fromYear, fromMonth, toYear, toMonth, day;
+        fromDayNumber(fromStart, fromYear, fromMonth, day);
+        fromDayNumber(toStart, toYear, toMonth, day);
+        return period == BudgetPeriod::Monthly ? (toYear - fromYear) * 12 + toMonth - fromMonth : toYear - fromYear;
+    }
+
+    static string periodName(BudgetPeriod period) {
+        return period == BudgetPeriod::Weekly ? "weekly" : period == BudgetPeriod::Monthly ? "monthly" : "yearly";
+    }
+
+    // "week of 2024-03-11", "2024-03" or "2024"
+    static string periodLabel(BudgetPeriod period, int dayNumber) {
+        string start = toString(periodStart(period, dayNumber));
+        if (period == BudgetPeriod::Weekly) {
+            return "week of " + start;
+        }
+        return period == BudgetPeriod::Monthly ? start.substr(0, 7) : start.substr(0, 4);
+    }
+};
+
 class InputValidator { //call validations thru exception handlers
 public:
+    // Single-pass parsers: validate and convert in one step, no exceptions or allocation.
+    // Bulk paths use these and DateUtil::parse directly; the throwing validators below wrap them for the UI.
+
+    // Digits with at most one decimal point, not starting with the point
+    static ParseError parseAmount(string_view input, double& value) noexcept {
+        bool hasDecimal = false;
+        for (char c : input) {
+            if (c < '0' || c > '9') {
+                if (c != '.' || hasDecimal) {
+                    return ParseError::NotNumeric;
+                }
+                hasDecimal = true; // Allow one decimal point
+            }
+        }
+        if (input.empty()) {
+            return ParseError::Empty;
+        }
+        if (input[0] == '.') {
+            return ParseError::LeadingDecimal;
+        }
+        auto result = from_chars(input.data(), input.data() + input.size(), value);
+        if (result.ec != errc() || result.ptr != input.data() + input.size()) {
+            return ParseError::OutOfRange;
+        }
+        return ParseError::None;
+    }
+
+    static const char* describe(ParseError error) noexcept {
+        switch (error) {
+            case ParseError::None:           return "";
+            case ParseError::NotNumeric:     return "Input must be a number.";
+            case ParseError::Empty:
+            case ParseError::LeadingDecimal: return "Input must be a valid number. (no spaces and not start with a decimal.)";
+            case ParseError::OutOfRange:     return "Input is out of valid range.";
+            case ParseError::BadDateFormat:  return "Date must be in YYYY-MM-DD format.";
+            case ParseError::InvalidDate:    return "Invalid date format. Please enter a valid date.";
+        }
+        return "Invalid input.";
+    }
+
+    // Validated amount; throws with a user-facing message
+    static double toAmount(const std::string& input) {
+        double value = 0;
+        ParseError error = parseAmount(input, value);
+        if (error != ParseError::None) {
+            throw std::invalid_argument(describe(error));
+        }
+        return value;
+    }
+
+    // Validated date as a day number; throws with a user-facing message
+    static int toDayNumber(const std::string& date) {
+        int dayNumber = 0;
+        ParseError error = DateUtil::parse(date, dayNumber);
+        if (error != ParseError::None) {
+            throw std::invalid_argument(describe(error));
+        }
+        return dayNumber;
+    }
+
     // Validate that input is not empty
     static void validateNotEmpty(const std::string& input) {
         if (input.empty()) {
@@ -31,24 +252,13 @@ public:
 
     // Validate that input is numeric
     static void validateIsNumeric(const std::string& input) {
-    bool hasDecimal = false;
-    
-    for (char c : input) {
-        if (!isdigit(c)) {
-            if (c == '.' && !hasDecimal) {
-                hasDecimal = true; // Allow one decimal point
-            } else {
-                throw std::invalid_argument("Input must be a number.");
-            }
+        double value;
+        ParseError error = parseAmount(input, value);
+        if (error != ParseError::None) {
+            throw std::invalid_argument(describe(error));
         }
     }
 
-    // Ensure input is not empty and does not start with a decimal
-	if (input.empty() || input[0] == '.') {
-	        throw std::invalid_argument("Input must be a valid number. (no spaces and not start with a decimal.)");
-	    }
-	}
-
     // Validate input range
     static void validateRange(int value, int min, int max) {
         if (value < min || value > max) {
@@ -56,6 +266,16 @@ public:
         }
     }
     
+    // Letters, digits, spaces and '>' between the levels of a category path
+    static void validateCategory(const std::string& category) {
+        validateNotEmpty(category);
+        for (char c : category) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != ' ' && c != '>') {
+                throw std::invalid_argument("Category can only contain letters, numbers and '>' between levels.");
+            }
+        }
+    }
+
     static void validateNoSpaces(const string& input) {
         if (input.find(' ') != string::npos) {
             throw std::invalid_argument("Input cannot contain spaces.");
@@ -115,17 +335,17 @@ public:
 	
 	// Validate date format (YYYY-MM-DD)
     static void validateDateFormat(const std::string& date) {
-        if (!std::regex_match(date, std::regex(R"(^\d{4}-\d{2}-\d{2}$)"))) {
-            throw std::invalid_argument("Date must be in YYYY-MM-DD format.");
+        int dayNumber;
+        if (DateUtil::parse(date, dayNumber) == ParseError::BadDateFormat) {
+            throw std::invalid_argument(describe(ParseError::BadDateFormat));
         }
 	}
 	
 	// Static helper method to convert a string to lowercase
     static string toLowerCase(const string& str) {
-        string lowerStr;
-        for (char c : str) {
-            lowerStr += tolower(c);
-        }
+        string lowerStr(str.size(), '\0');
+        transform(str.begin(), str.end(), lowerStr.begin(),
+                  [](unsigned char c) { return static_cast<char>(tolower(c)); });
         return lowerStr;
     }
 };
@@ -135,7 +355,7 @@ class UserInterface {
 public:
     virtual void displayScreen() const = 0; 
 
-    void validateNumericInput(int& input, int min, int max) const {
+    static void validateNumericInput(int& input, int min, int max) {
         while (!(cin >> input) || input < min || input > max) {
             cout << "Invalid choice. Please try again: ";
             cin.clear();
@@ -160,6 +380,8 @@ class Expense {
 		string category;
 		double amount;
 		string date;
+		uint64_t tags = 0;
+		uint16_t currency = 0; // CurrencyCode; 0 is the owner's base currency
 		
 	public:
 		Expense(int id, const string& category, double amount, const string& date) : id(id), category(category), amount(amount), date(date) {}
@@ -168,11 +390,16 @@ class Expense {
 	
 	    int getId() const { return id; }
 		void setCategory(string newCategory) {category = newCategory;}
-	    string getCategory() const { return category; }
+	    const string& getCategory() const { return category; }
 		void setAmount(double newAmount) {amount = newAmount;}
 	    double getAmount() const { return amount; }
 	    void setDate(string newDate) {date = newDate;}
-	    string getDate() const { return date; }
+	    const string& getDate() const { return date; }
+	    // Bit i is set when the expense carries tag i of its owner's TagDictionary
+	    void setTags(uint64_t newTags) {tags = newTags;}
+	    uint64_t getTags() const { return tags; }
+	    void setCurrency(uint16_t newCurrency) {currency = newCurrency;}
+	    uint16_t getCurrency() const { return currency; }
 	
 	    virtual void displayExpense() const = 0; // Abstraction
 };
@@ -188,925 +415,7506 @@ public:
     }
 };
 
-class User {
-private:
-    string username;
-    string password;
-    vector<shared_ptr<Expense>> expenses;
-    double budget;
-
+// Three-letter currency codes packed into a small integer, so per-currency tables can be plain arrays
+class CurrencyCode {
 public:
-    User(const string& username, const string& password, double budget)
-        : username(username), password(password), budget(budget) {}
-
-    string getUsername() const { return username; }
-    bool verifyPassword(const string& inputPassword) const { return password == inputPassword; }
-    void setBudget(double newBudget) {budget = newBudget;}
-    double getBudget() const { return budget; }
-
-    // Non-const version
-    vector<shared_ptr<Expense>>& getExpenses() { return expenses; }
+    static const uint16_t BASE = 0;                  // the owner's base currency, whatever it is named
+    static const size_t COUNT = 26 * 26 * 26 + 1;   // every code, plus BASE
 
-    // Const version
-    const vector<shared_ptr<Expense>>& getExpenses() const { return expenses; }
-
-    void addExpense(shared_ptr<Expense> expense) { expenses.push_back(expense); }
+    // Three letters, either case
+    static bool parse(const string& text, uint16_t& code) {
+        if (text.size() != 3) {
+            return false;
+        }
+        int packed = 0;
+        for (char c : text) {
+            c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+            if (c < 'A' || c > 'Z') {
+                return false;
+            }
+            packed = packed * 26 + (c - 'A');
+        }
+        code = static_cast<uint16_t>(packed + 1);
+        return true;
+    }
 
-    void displayExpenses() const {
-        if (expenses.empty()) {
-            cout << "No expenses to display." << endl;
-            return;
+    static string toString(uint16_t code) {
+        if (code == BASE || code >= COUNT) {
+            return "";
         }
-        cout << "Expenses for user: " << username << endl;
-        for (const auto& expense : expenses) {
-            expense->displayExpense();
+        int packed = code - 1;
+        string text(3, 'A');
+        for (int i = 2; i >= 0; --i, packed /= 26) {
+            text[i] = static_cast<char>('A' + packed % 26);
         }
+        return text;
     }
 };
 
-class BudgetManager {
+/*
+    Exchange rates loaded from a local CSV file, one quote per line: date,code,rate where rate is
+    the value of one unit of the currency in the file's reference currency. Each currency's quotes
+    are expanded once into a rate per day between its first and last quote, carrying the last
+    quote forward over weekends and gaps, so a lookup is an array index with no search. Days
+    before the first quote use the first, days after the last use the last. Currencies missing
+    from the table are worth one reference unit, which keeps single-currency accounts unaffected.
+*/
+class FxRates {
 private:
-    User& user; // Reference to the User object
+    struct Series {
+        int firstDay;
+        vector<double> rates; // one per day from firstDay
+    };
+
+    vector<int> slotOf; // by currency code, the index of its series or -1
+    vector<Series> series;
+    unsigned long long version = 0; // bumped by every load, so users know to re-convert
+
+    FxRates() : slotOf(CurrencyCode::COUNT, -1) {}
 
 public:
-    explicit BudgetManager(User& user) : user(user) {}
+    static const int FIRST_YEAR = 1970;
+    static const int LAST_YEAR = 2100;
 
-    double getBudget() const {
-        return user.getBudget();
+    static FxRates* getInstance() {
+        static FxRates instance;
+        return &instance;
     }
 
-    void updateBudget(double updatedBudget) {
-        if (updatedBudget < 0) {
-            cout << "\n> Error: Budget cannot be negative!" << endl;
-            return;
+    // Replaces the table with the file's quotes; false if it cannot be opened. Each currency is
+    // expanded to one rate per day, so quotes must fall within FIRST_YEAR..LAST_YEAR
+    bool load(const string& path, size_t& loaded, vector<string>& errors) {
+        ifstream in(path);
+        if (!in) {
+            return false;
         }
-        user.setBudget(updatedBudget);
-        cout << "> Successfully changed the budget!" << endl;
-        cout << "\nCURRENT BUDGET: " << user.getBudget() << endl;
+        map<uint16_t, map<int, double>> quotes;
+        string line;
+        loaded = 0;
+        for (size_t lineNumber = 1; getline(in, line); ++lineNumber) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (line.empty() || (lineNumber == 1 && InputValidator::toLowerCase(line.substr(0, 4)) == "date")) {
+                continue;
+            }
+            size_t firstComma = line.find(',');
+            size_t lastComma = line.rfind(',');
+            int dayNumber;
+            uint16_t code;
+            double rate;
+            if (firstComma == string::npos || firstComma == lastComma
+                || DateUtil::parse(string_view(line).substr(0, firstComma), dayNumber) != ParseError::None
+                || !CurrencyCode::parse(line.substr(firstComma + 1, lastComma - firstComma - 1), code)
+                || InputValidator::parseAmount(string_view(line).substr(lastComma + 1), rate) != ParseError::None
+                || rate <= 0) {
+                errors.push_back("Line " + to_string(lineNumber) + ": expected YYYY-MM-DD,CODE,rate.");
+                continue;
+            }
+            if (dayNumber < DateUtil::toDayNumber(FIRST_YEAR, 1, 1) || dayNumber > DateUtil::toDayNumber(LAST_YEAR, 12, 31)) {
+                errors.push_back("Line " + to_string(lineNumber) + ": dates must be from " + to_string(FIRST_YEAR)
+                                 + " to " + to_string(LAST_YEAR) + ".");
+                continue;
+            }
+            quotes[code][dayNumber] = rate;
+            loaded++;
+        }
+
+        fill(slotOf.begin(), slotOf.end(), -1);
+        series.clear();
+        for (const auto& currency : quotes) {
+            Series expanded{currency.second.begin()->first, {}};
+            expanded.rates.reserve(static_cast<size_t>(currency.second.rbegin()->first - expanded.firstDay + 1));
+            for (auto quote = currency.second.begin(); quote != currency.second.end(); ++quote) {
+                auto next = std::next(quote);
+                int until = next == currency.second.end() ? quote->first + 1 : next->first;
+                expanded.rates.insert(expanded.rates.end(), static_cast<size_t>(until - quote->first), quote->second);
+            }
+            slotOf[currency.first] = static_cast<int>(series.size());
+            series.push_back(std::move(expanded));
+        }
+        version++;
+        return true;
     }
 
-    double getRemainingBudget() const {
-        double totalExpenses = 0;
-        for (const auto& expense : user.getExpenses()) {
-            totalExpenses += expense->getAmount();
+    // Value of one unit in the reference currency on a day, using only the quotes dated up to
+    // quotedBy, e.g. to see the rates as they stood on a past day
+    double rate(uint16_t code, int dayNumber, int quotedBy = numeric_limits<int>::max()) const {
+        int slot = slotOf[code];
+        if (slot < 0 || series[slot].firstDay > quotedBy) {
+            return 1;
         }
-        return user.getBudget() - totalExpenses;
+        const Series& quoted = series[slot];
+        int offset = min(max(min(dayNumber, quotedBy) - quoted.firstDay, 0), static_cast<int>(quoted.rates.size()) - 1);
+        return quoted.rates[offset];
     }
 
-    void manageBudgetPrompt() {
-        char modifyChoice;
-        system("cls");
-        cout << "================================================" << endl;
-        cout << "              MANAGE BUDGET                     " << endl;
-        cout << "================================================" << endl;
+    // Multiplier taking an amount in from to base on a day
+    double factor(uint16_t from, uint16_t base, int dayNumber, int quotedBy = numeric_limits<int>::max()) const {
+        if (from == CurrencyCode::BASE || from == base) {
+            return 1;
+        }
+        return rate(from, dayNumber, quotedBy) / rate(base, dayNumber, quotedBy);
+    }
 
-        cout << "\nCURRENT BUDGET: " << getRemainingBudget() << endl;
-        
-	    do {
-		    cout << "\n> Modify existing budget? (Y/N): ";
-        	cin >> modifyChoice;
-		    if (tolower(modifyChoice) != 'y' && tolower(modifyChoice) != 'n') {
-				cout << "Invalid Answer!\n";
-			}
-		    if (tolower(modifyChoice) == 'y') {
-	            double newBudget;
-	            cout << "\n> Input the amount of the new budget: ";
-	            while (!(cin >> newBudget) || newBudget < 0) {
-	                cin.clear();
-	                cin.ignore(numeric_limits<streamsize>::max(), '\n');
-	                cout << "Invalid input! Please enter a positive value: ";
-	            }
-            updateBudget(newBudget);
-        	}
-		} while (tolower(modifyChoice) != 'y' && tolower(modifyChoice) != 'n');
-		
-		if(tolower(modifyChoice) == 'n') {
-	        cout << endl << "\n> Redirecting to the main menu ..." << endl;
-		} else {
-            cout << "\n> Successfully updated the budget!" << endl;
+    // Converts count amounts to base in one pass; out may alias amounts
+    void toBase(uint16_t base, size_t count, const double* amounts, const uint16_t* codes, const int* days, double* out,
+                int quotedBy = numeric_limits<int>::max()) const {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = amounts[i] * factor(codes[i], base, days[i], quotedBy);
         }
-        
-        
-        cout << "> Press any key to continue ...";
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cin.get();
     }
-};
 
-// Strategy
-class ExpenseViewStrategy {
-public: 
-	static bool stringToDate(const string& dateStr, struct tm& date) {
-    istringstream ss(dateStr);
-    ss >> get_time(&date, "%Y-%m-%d");
-    return !ss.fail();  // Returns true if conversion is successful
-	}
-	
-    virtual void viewExpenses(const User& user, double& totalExpenses) const = 0; // abstraction
-    virtual ~ExpenseViewStrategy() {}
+    unsigned long long getVersion() const { return version; }
+    size_t currencyCount() const { return series.size(); }
 };
 
-class WeeklyViewStrategy : public ExpenseViewStrategy {
-public:
-	bool isSameWeek(const std::tm& date1, const std::tm& date2) {
-    auto time1 = std::mktime(const_cast<std::tm*>(&date1));
-    auto time2 = std::mktime(const_cast<std::tm*>(&date2));
-    const int SECONDS_IN_A_WEEK = 7 * 24 * 60 * 60;
-
-    return std::abs(std::difftime(time1, time2)) < SECONDS_IN_A_WEEK &&
-           date1.tm_wday <= date2.tm_wday; // Ensure they're in the same week
-	}
-	
-    void viewExpenses(const User& user, double& totalExpenses) const override {
-        cout << "\n> Viewing expenses for the past week:\n";
-        cout << "\n-------------------------------------------------------\n";
-        cout << "ID\tAMOUNT\tCATEGORY\tDATE\n";
-        cout << "-------------------------------------------------------\n";
-
-        time_t now = time(nullptr);
-        tm* currentDate = localtime(&now); // Current date
-        tm expenseDate = {};
-
-        bool found = false; // To track if any expenses were found
-        for (const auto& expense : user.getExpenses()) {
-            if (stringToDate(expense->getDate(), expenseDate)) {
-                time_t expenseTime = mktime(&expenseDate);
-                double secondsDiff = difftime(now, expenseTime);
-                double daysDiff = secondsDiff / (60 * 60 * 24); // Convert seconds to days
-
-                if (daysDiff <= 7) { // Expense is within the last 7 days
-                    cout << setw(5) << expense->getId() << "\t"
-                         << setw(7) << expense->getAmount() << "\t"
-                         << setw(10) << expense->getCategory() << "\t"
-                         << expense->getDate() << endl;
-                    totalExpenses += expense->getAmount();
-                    found = true;
-                }
+// Fenwick tree of spend per day number; range totals in O(log days)
+class DailySpendIndex {
+private:
+    int baseDay = 0;      // day number stored at position 0
+    vector<double> daily; // raw spend per day, kept to rebuild the tree when the range grows
+    vector<double> tree;  // 1-based Fenwick tree over daily
+
+    void rebuild(int newBase, size_t newSize) {
+        vector<double> resized(newSize, 0.0);
+        for (size_t i = 0; i < daily.size(); ++i) {
+            resized[static_cast<size_t>(baseDay - newBase) + i] = daily[i];
+        }
+        daily.swap(resized);
+        baseDay = newBase;
+        tree.assign(newSize + 1, 0.0);
+        for (size_t i = 1; i <= newSize; ++i) { // O(n) construction
+            tree[i] += daily[i - 1];
+            size_t parent = i + (i & (~i + 1));
+            if (parent <= newSize) {
+                tree[parent] += tree[i];
             }
         }
+    }
 
-        if (!found) {
-            cout << "> No expenses made in the past week.\n";
+    // Spend on days [baseDay, baseDay + count)
+    double prefix(long long count) const {
+        double sum = 0;
+        if (count <= 0) {
+            return sum;
         }
+        for (size_t i = static_cast<size_t>(min<long long>(count, static_cast<long long>(daily.size()))); i > 0; i -= i & (~i + 1)) {
+            sum += tree[i];
+        }
+        return sum;
     }
-};
 
-class MonthlyViewStrategy : public ExpenseViewStrategy {
 public:
-	bool isSameMonth(const std::tm& date1, const std::tm& date2) {
-    return date1.tm_year == date2.tm_year && date1.tm_mon == date2.tm_mon;
-	}
-	
-    void viewExpenses(const User& user, double& totalExpenses) const override {
-        cout << "\n> Please enter the month (#) you want your expenses to be viewed (1 - 12): ";
-        int month;
-        cin >> month;
+    void add(int dayNumber, double amount) {
+        if (daily.empty()) {
+            baseDay = dayNumber;
+            rebuild(dayNumber, 1);
+        } else if (dayNumber < baseDay || dayNumber >= baseDay + static_cast<long long>(daily.size())) {
+            // Grow geometrically so repeated extensions stay amortized O(1)
+            int low = min(baseDay, dayNumber);
+            long long high = max<long long>(baseDay + static_cast<long long>(daily.size()), dayNumber + 1LL);
+            size_t span = static_cast<size_t>(high - low);
+            size_t newSize = max(span, daily.size() * 2);
+            int newBase = dayNumber < baseDay ? static_cast<int>(high - static_cast<long long>(newSize)) : low;
+            rebuild(newBase, newSize);
+        }
+        size_t position = static_cast<size_t>(dayNumber - baseDay);
+        daily[position] += amount;
+        for (size_t i = position + 1; i <= daily.size(); i += i & (~i + 1)) {
+            tree[i] += amount;
+        }
+    }
 
-        while (month < 1 || month > 12) {
-            cout << "Invalid month! Please enter a valid month (1 - 12): ";
-            cin >> month;
+    // Total spent on days fromDay..toDay inclusive
+    double total(int fromDay, int toDay) const {
+        if (daily.empty() || fromDay > toDay) {
+            return 0;
         }
+        return prefix(static_cast<long long>(toDay) - baseDay + 1) - prefix(static_cast<long long>(fromDay) - baseDay);
+    }
 
-        time_t now = time(nullptr);
-        tm currentDate = *localtime(&now);
-        int currentYear = currentDate.tm_year + 1900;
+    void clear() {
+        daily.clear();
+        daily.shrink_to_fit();
+        tree.clear();
+        tree.shrink_to_fit();
+    }
 
-        cout << "\n> Viewing expenses for the selected month of the current year (" << currentYear << "):\n";
-        cout << "\n-------------------------------------------------------\n";
-        cout << "ID\tAMOUNT\tCATEGORY\tDATE\n";
-        cout << "-------------------------------------------------------\n";
+    size_t memoryBytes() const {
+        return (daily.capacity() + tree.capacity()) * sizeof(double);
+    }
+};
 
-        bool found = false;
-        for (const auto& expense : user.getExpenses()) {
-            tm expenseDate = {};
-            if (stringToDate(expense->getDate(), expenseDate)) {
-                int expenseYear = expenseDate.tm_year + 1900;
-                if (expenseDate.tm_mon + 1 == month && expenseYear == currentYear) {
-                    cout << setw(5) << expense->getId() << "\t"
-                         << setw(7) << expense->getAmount() << "\t"
-                         << setw(10) << expense->getCategory() << "\t"
-                         << expense->getDate() << endl;
-                    totalExpenses += expense->getAmount();
-                    found = true;
-                }
-            }
-        }
+// Mergeable log-bucket quantile sketch (DDSketch style); quantiles within 1% relative error
+class QuantileSketch {
+private:
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+    static double gamma() { return (1 + RELATIVE_ACCURACY) / (1 - RELATIVE_ACCURACY); }
+    static constexpr double MIN_POSITIVE = 1e-9; // smaller amounts count as zero
 
-        if (!found) {
-            cout << "> No expenses made for this month in " << currentYear << ".\n";
-        }
+    map<int, long long> buckets; // bucket i holds values in (gamma^(i-1), gamma^i]
+    long long zeroCount = 0;
+    long long total = 0;
+
+    static int bucketOf(double value) {
+        return static_cast<int>(ceil(log(value) / log(gamma())));
     }
-};
 
-class YearlyViewStrategy : public ExpenseViewStrategy {
 public:
-	bool isSameYear(const std::tm& date1, const std::tm& date2) {
-    return date1.tm_year == date2.tm_year;
-	}
-	
-    void viewExpenses(const User& user, double& totalExpenses) const override {
-        cout << "\n> Viewing expenses for the current year:\n";
-        cout << "\n-------------------------------------------------------\n";
-        cout << "ID\tAMOUNT\tCATEGORY\tDATE\n";
-        cout << "-------------------------------------------------------\n";
+    void add(double value, long long count = 1) {
+        if (value < MIN_POSITIVE) {
+            zeroCount += count;
+        } else {
+            long long& bucket = buckets[bucketOf(value)];
+            bucket += count;
+            if (bucket == 0) {
+                buckets.erase(bucketOf(value));
+            }
+        }
+        total += count;
+    }
 
-        time_t now = time(nullptr);
-        tm currentDate = *localtime(&now);
-        int currentYear = currentDate.tm_year + 1900;
+    void remove(double value) { add(value, -1); }
 
-        bool found = false;
-        for (const auto& expense : user.getExpenses()) {
-            tm expenseDate = {};
-            if (stringToDate(expense->getDate(), expenseDate)) {
-                int expenseYear = expenseDate.tm_year + 1900;
-                if (expenseYear == currentYear) {
-                    cout << setw(5) << expense->getId() << "\t"
-                         << setw(7) << expense->getAmount() << "\t"
-                         << setw(10) << expense->getCategory() << "\t"
-                         << expense->getDate() << endl;
-                    totalExpenses += expense->getAmount();
-                    found = true;
-                }
-            }
+    void merge(const QuantileSketch& other) {
+        for (const auto& bucket : other.buckets) {
+            buckets[bucket.first] += bucket.second;
         }
+        zeroCount += other.zeroCount;
+        total += other.total;
+    }
 
-        if (!found) {
-            cout << "> No expenses made for this year.\n";
+    long long count() const { return total; }
+
+    // Value at quantile q (0..1); 0 for an empty sketch
+    double quantile(double q) const {
+        if (total <= 0) {
+            return 0;
+        }
+        long long rank = llround(q * static_cast<double>(total - 1));
+        long long seen = zeroCount;
+        if (rank < seen) {
+            return 0;
+        }
+        for (const auto& bucket : buckets) {
+            seen += bucket.second;
+            if (rank < seen) {
+                return 2 * pow(gamma(), bucket.first) / (gamma() + 1);
+            }
         }
+        return 2 * pow(gamma(), buckets.rbegin()->first) / (gamma() + 1);
     }
 };
 
-class CategoryViewStrategy : public ExpenseViewStrategy {
+// Per category and calendar month: spend total and amount sketch, kept incrementally
+class CategoryStatsIndex {
 public:
-    void viewExpenses(const User& user, double& totalExpenses) const override {
-        set<string> categories;
-        for (const auto& expense : user.getExpenses()) {
-            categories.insert(expense->getCategory());
-        }
+    struct MonthStats {
+        double total = 0;
+        QuantileSketch amounts;
+    };
+
+    // Months are numbered year * 12 + (month - 1)
+    static int monthKeyOf(int dayNumber) {
+        int year, month, day;
+        DateUtil::fromDayNumber(dayNumber, year, month, day);
+        return year * 12 + month - 1;
+    }
 
-        cout << "\n> Your available categories:\n";
-        cout << "---------------------------------\n";
-        for (const auto& category : categories) {
-            cout << category << endl;
+    void add(const string& category, int dayNumber, double amount, int sign) {
+        string key = InputValidator::toLowerCase(category);
+        auto& months = categories[key];
+        MonthStats& stats = months[monthKeyOf(dayNumber)];
+        stats.total += sign * amount;
+        stats.amounts.add(amount, sign);
+        if (stats.amounts.count() == 0) {
+            months.erase(monthKeyOf(dayNumber));
+            if (months.empty()) {
+                categories.erase(key);
+            }
         }
+    }
 
-        string category;
-        cout << "\n> Please input the category you wanted the expenses to be viewed.\n";
-        cout << "CATEGORY: ";
-        cin >> category;
-
-        string categoryLower = InputValidator::toLowerCase(category);
-        bool categoryFound = false;
-
-        cout << "\n-------------------------------------------------------\n";
-        cout << "ID\tAMOUNT\tCATEGORY\tDATE\n";
-        cout << "-------------------------------------------------------\n";
-
-        for (const auto& expense : user.getExpenses()) {
-            if (InputValidator::toLowerCase(expense->getCategory()) == categoryLower) {
-                cout << expense->getId() << "\t"
-                     << expense->getAmount() << "\t"
-                     << expense->getCategory() << "\t"
-                     << expense->getDate() << endl;
-                totalExpenses += expense->getAmount();
-                categoryFound = true;
+    // Spend per category over the months [fromMonth, toMonth]
+    vector<pair<string, double>> totals(int fromMonth, int toMonth) const {
+        vector<pair<string, double>> result;
+        for (const auto& category : categories) {
+            double sum = 0;
+            for (auto it = category.second.lower_bound(fromMonth); it != category.second.end() && it->first <= toMonth; ++it) {
+                sum += it->second.total;
+            }
+            if (sum > 0) {
+                result.emplace_back(category.first, sum);
             }
         }
+        return result;
+    }
 
-        if (!categoryFound) {
-            cout << "\n> No expenses found in this category.\n";
+    // Sketches of each category merged over the months [fromMonth, toMonth]
+    map<string, QuantileSketch> sketches(int fromMonth, int toMonth) const {
+        map<string, QuantileSketch> result;
+        for (const auto& category : categories) {
+            QuantileSketch merged;
+            for (auto it = category.second.lower_bound(fromMonth); it != category.second.end() && it->first <= toMonth; ++it) {
+                merged.merge(it->second.amounts);
+            }
+            if (merged.count() > 0) {
+                result[category.first] = merged;
+            }
         }
+        return result;
     }
-};
 
-class AllViewStrategy : public ExpenseViewStrategy {
-    
-	void viewExpenses(const User& user, double& totalExpenses) const override {
-        cout << "\n-------------------------------------------------------\n";
-        cout << "ID\tAMOUNT\tCATEGORY\tDATE\n";
-        cout << "-------------------------------------------------------\n";
-        //displayExpense()
-		for (const auto& expense : user.getExpenses()) {
-            cout << expense->getId() << "\t"
-                 << setw(7) << expense->getAmount() << "\t"
-                 << setw(10) << expense->getCategory() << "\t"
-                 << expense->getDate() << endl;
-                 totalExpenses += expense->getAmount(); // Accumulate total for all expenses
+    // Visits every (category, month, total) entry
+    void forEachMonth(const function<void(const string&, int, double)>& visit) const {
+        for (const auto& category : categories) {
+            for (const auto& month : category.second) {
+                visit(category.first, month.first, month.second.total);
+            }
         }
     }
 
-};
+    void clear() { categories.clear(); }
+
+    size_t size() const { return categories.size(); }
 
-class ExpenseManager { 
 private:
-    list<shared_ptr<Expense>> expenses; 
-	shared_ptr<ExpenseViewStrategy> viewStrategy; 
-    string expenseId;
-    double amount;
-    double totalExpenses;
+    unordered_map<string, map<int, MonthStats>> categories; // lower-cased category -> month -> stats
+};
 
+// Category names interned with their trigrams, for fuzzy search: a query is scored against only
+// the categories sharing at least one trigram with it, found through the trigram postings
+class CategorySearchIndex {
 public:
-	
-	static bool stringToDate(const string& dateStr, struct tm& date) {
-    istringstream ss(dateStr);
-    ss >> get_time(&date, "%Y-%m-%d");
-    return !ss.fail();  // Returns true if conversion is successful
-	}
-		
-	void addExpense(User& user, BudgetManager& budgetManager) { 
-    system("cls"); // Clear the screen
-    string menuTitle = "ADD EXPENSE";
-    printHeader(menuTitle);
-    cout << "> Please enter the following expense details to add." << endl;
-    cout << "> Input 'x' to cancel anytime." << endl;
-
-    cout << "CURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
-
-    string amountInput, category, date;
-    double amount;
-    struct tm expenseDate = {};  // Initialize tm struct
-    time_t now = time(nullptr); // Get current time
-    struct tm* currentDate = localtime(&now); // Convert to local time
-
-    try {
-        // Loop until valid expense amount is entered
-        while (true) {
-            cout << "\nAMOUNT: ";
-            cin >> amountInput;
-            if (amountInput == "x" || amountInput == "X") {
-                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+    struct Match {
+        string name;
+        string key;         // lower-cased name
+        double score;       // trigram similarity, 1 for an identical name
+        size_t expenseCount;
+    };
+
+    // Counts one more (sign = 1) or one fewer (sign = -1) expense in the category
+    void add(const string& category, int sign) {
+        string key = InputValidator::toLowerCase(category);
+        auto found = idByKey.find(key);
+        if (found == idByKey.end()) {
+            if (sign < 0) {
                 return;
             }
+            int id = static_cast<int>(entries.size());
+            vector<uint32_t> trigrams;
+            trigramsOf(key, trigrams);
+            for (uint32_t trigram : trigrams) {
+                postings[trigram].push_back(id);
+            }
+            entries.push_back({category, key, 0, trigrams.size()});
+            found = idByKey.emplace(key, id).first;
+        }
+        Entry& entry = entries[found->second];
+        entry.count = sign > 0 ? entry.count + 1 : entry.count - min<size_t>(entry.count, 1);
+    }
 
-            try {
-                InputValidator::validateIsNumeric(amountInput);
-                amount = stod(amountInput); // Convert validated input to double
-                if (amount > budgetManager.getBudget()) {
-                    throw std::invalid_argument("Insufficient Budget! Cannot exceed the available budget.");
+    // Up to limit categories in use that resemble the query, best first
+    vector<Match> search(const string& query, size_t limit) const {
+        vector<uint32_t> trigrams;
+        trigramsOf(InputValidator::toLowerCase(query), trigrams);
+        shared.resize(entries.size());
+        for (uint32_t trigram : trigrams) {
+            auto found = postings.find(trigram);
+            if (found == postings.end()) {
+                continue;
+            }
+            for (int id : found->second) {
+                if (shared[id]++ == 0) {
+                    touched.push_back(id);
                 }
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
             }
         }
 
-        // Loop until valid category is entered
-        while (true) {
-            cout << "CATEGORY: ";
-            cin >> category;
-            if (category == "x" || category == "X") {
-                cout << "> Operation canceled. Redirecting to main menu..." << endl;
-                return;
+        auto better = [](const Match& a, const Match& b) {
+            return a.score != b.score ? a.score > b.score : a.expenseCount > b.expenseCount;
+        };
+        priority_queue<Match, vector<Match>, decltype(better)> best(better); // worst kept match on top
+        for (int id : touched) {
+            const Entry& entry = entries[id];
+            if (entry.count > 0) {
+                double score = static_cast<double>(shared[id]) / (trigrams.size() + entry.trigramCount - shared[id]); // Jaccard
+                if (score >= MIN_SCORE) {
+                    best.push({entry.name, entry.key, score, entry.count});
+                    if (best.size() > limit) {
+                        best.pop();
+                    }
+                }
             }
+            shared[id] = 0;
+        }
+        touched.clear();
 
-            try {
-                InputValidator::validateNotEmpty(category);
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
-            }
+        vector<Match> matches;
+        for (; !best.empty(); best.pop()) {
+            matches.push_back(best.top());
         }
+        reverse(matches.begin(), matches.end());
+        return matches;
+    }
 
-        // Loop until valid date is entered
-        while (true) {
-            cout << "DATE (YYYY-MM-DD): ";
-            cin >> date;
-            if (date == "x" || date == "X") {
-                cout << "> Operation canceled. Redirecting to main menu..." << endl;
-                return;
-            }
+    // The spelling first typed for a lower-cased key, or the key itself if it is unknown
+    const string& displayName(const string& key) const {
+        auto found = idByKey.find(key);
+        return found == idByKey.end() ? key : entries[found->second].name;
+    }
 
-            try {
-                InputValidator::validateDateFormat(date);
-                if (!stringToDate(date, expenseDate)) {
-                    throw std::invalid_argument("Invalid date format. Please enter a valid date.");
-                }
+    // Categories in use
+    size_t size() const {
+        return count_if(entries.begin(), entries.end(), [](const Entry& entry) { return entry.count > 0; });
+    }
 
-                // Check if date is in the future
-                if (mktime(&expenseDate) > mktime(currentDate)) {
-                    throw std::invalid_argument("Date cannot be in the future.");
-                }
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
-            }
+    void clear() {
+        entries.clear();
+        idByKey.clear();
+        postings.clear();
+    }
+
+private:
+    static constexpr double MIN_SCORE = 0.2;
+
+    struct Entry {
+        string name; // spelling first seen
+        string key;
+        size_t count; // expenses using it; names stay interned at zero
+        size_t trigramCount;
+    };
+
+    vector<Entry> entries;
+    unordered_map<string, int> idByKey;
+    unordered_map<uint32_t, vector<int>> postings; // trigram -> category ids
+    mutable vector<int> shared;  // per category, trigrams shared with the current query
+    mutable vector<int> touched; // categories with a non-zero count in shared
+
+    // Distinct trigrams of "  key ", so short names and word starts still produce some
+    static void trigramsOf(const string& key, vector<uint32_t>& trigrams) {
+        string padded = "  " + key + " ";
+        trigrams.clear();
+        for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+            trigrams.push_back(static_cast<uint32_t>(static_cast<unsigned char>(padded[i])) << 16
+                               | static_cast<uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8
+                               | static_cast<unsigned char>(padded[i + 2]));
         }
+        sort(trigrams.begin(), trigrams.end());
+        trigrams.erase(unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    }
+};
 
-        // Generate ID and add the expense
-        int id = static_cast<int>(user.getExpenses().size()) + 1;
-        auto newExpense = make_shared<DetailedExpense>(id, category, amount, date);
-        user.addExpense(newExpense);
+// Running mean and variance of the amounts of each category (Welford), kept incrementally in
+// both directions so an expense can be scored against its category's history in O(1)
+class CategoryMoments {
+public:
+    static constexpr double Z_THRESHOLD = 3.0;  // flag amounts this many deviations above the mean
+    static constexpr long long MIN_SAMPLES = 5; // too little history to say what is usual
+    static constexpr double MIN_SPREAD = 0.1;   // deviation floor as a share of the mean, for near-constant amounts
+
+    struct Moments {
+        long long count = 0;
+        double mean = 0;
+        double m2 = 0; // sum of squared deviations from the mean
+
+        double stddev() const { return count > 1 ? sqrt(m2 / (count - 1)) : 0; }
+    };
+
+    // Adds (sign = 1) or withdraws (sign = -1) one amount
+    void add(const string& category, double amount, int sign) {
+        string key = InputValidator::toLowerCase(category);
+        Moments& moments = categories[key];
+        if (sign > 0) {
+            moments.count++;
+            double delta = amount - moments.mean;
+            moments.mean += delta / moments.count;
+            moments.m2 += delta * (amount - moments.mean);
+        } else if (moments.count <= 1) {
+            categories.erase(key);
+        } else {
+            double previousMean = moments.mean;
+            moments.count--;
+            moments.mean = (previousMean * (moments.count + 1) - amount) / moments.count;
+            moments.m2 = max(0.0, moments.m2 - (amount - previousMean) * (amount - moments.mean));
+        }
+    }
 
-        // Display success message
-        cout << "\n> Expense added successfully!\n" << endl;
-        cout << "EXPENSE ID: " << id << endl;
-        cout << "AMOUNT: " << amount << endl;
-        cout << "CATEGORY: " << category << endl;
-        cout << "DATE: " << put_time(&expenseDate, "%Y-%m-%d") << endl;
-        cout << "\nREMAINING BUDGET: " << budgetManager.getRemainingBudget() << endl;
+    // Standard deviations the amount lies above the category's mean; false without enough history
+    bool score(const string& category, double amount, double& zScore, double& mean) const {
+        auto found = categories.find(InputValidator::toLowerCase(category));
+        if (found == categories.end() || found->second.count < MIN_SAMPLES) {
+            return false;
+        }
+        const Moments& moments = found->second;
+        double spread = max(moments.stddev(), MIN_SPREAD * fabs(moments.mean));
+        if (spread <= 0) {
+            return false;
+        }
+        zScore = (amount - moments.mean) / spread;
+        mean = moments.mean;
+        return true;
+    }
 
-    } catch (const std::exception& e) {
-        // Handle validation or other errors
-        cout << "Error: " << e.what() << endl;
-        cout << "> Redirecting to the main menu..." << endl;
-        cout << "> Press any key to continue ...";
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cin.get();
-        return;
+    void clear() { categories.clear(); }
+
+private:
+    unordered_map<string, Moments> categories; // lower-cased category
+};
+
+// An expense whose amount stood out from its category when it was entered or last changed
+struct ExpenseAnomaly {
+    double zScore;
+    double categoryMean;
+};
+
+/*
+    Fingerprints of (date, amount, currency, normalized category) for duplicate detection.
+    Lookups go through a Bloom filter first, so the common case of a new expense is answered
+    from a few bits without touching the exact index; a positive is confirmed against an exact
+    count of each fingerprint, so no expense is ever reported as a duplicate by mistake.
+    The filter is sized for the configured false-positive rate and rebuilt from the exact
+    index with twice the capacity once it fills up; removals only update the exact counts,
+    and their stale bits are dropped at the next rebuild.
+*/
+class ExpenseFingerprints {
+public:
+    static constexpr double DEFAULT_FALSE_POSITIVE_RATE = 0.01;
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    explicit ExpenseFingerprints(double falsePositiveRate = DEFAULT_FALSE_POSITIVE_RATE) {
+        configure(falsePositiveRate);
     }
 
-    // Prompt to add another expense
-    char choice;
-    do {
-	    cout << "\n> Add another expense? (Y/N): ";
-	    cin >> choice;
-	    if (tolower(choice) != 'y' && tolower(choice) != 'n') {
-			cout << "Invalid Answer!\n";
-		}
-	    if (tolower(choice) == 'y') {
-	        addExpense(user, budgetManager);
-	    }
-	} while (tolower(choice) != 'y' && tolower(choice) != 'n');
-	
-	if(tolower(choice) == 'n') {
-        cout << endl << "> Redirecting to the main menu ..." << endl;
-        cout << "> Press any key to continue ...";
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cin.get();
-	} 
-}
-	
-	void setViewStrategy(const shared_ptr<ExpenseViewStrategy>& strategy) {
-        viewStrategy = strategy;
+    // Lower false-positive rates cost more bits per fingerprint: 9.6 bits at 1%, 14.4 at 0.1%
+    void configure(double falsePositiveRate) {
+        falsePositiveRate = min(max(falsePositiveRate, 1e-6), 0.5);
+        const double LN2 = log(2.0);
+        bitsPerKey = -log(falsePositiveRate) / (LN2 * LN2);
+        hashCount = max(1, static_cast<int>(lround(bitsPerKey * LN2)));
+        rebuild(max(MIN_CAPACITY, counts.size()));
     }
-	
-	void handleExpensesView(const User& user) {
-	    int choice;
-	    char cancelChoice;
-	
-	    do {
-	        cout << "> Select display type to view your expenses:" << endl;
-	        cout << "> Input 'x' to cancel anytime." << endl;
-	        cout << "1 - Category\n";
-	        cout << "2 - Weekly\n";
-	        cout << "3 - Monthly\n";
-	        cout << "4 - Yearly\n";
-	        cout << "5 - View All\n";
-	        cout << "CHOICE: ";
-	
-	        string input;
-	        cin >> input;
-	
-	        // Check if the user entered 'x' or 'X' to cancel
-	        if (input == "x" || input == "X") {
-	            return;  // Exit if 'x' is chosen
-	        }
-	
-	        // Try to convert the input to an integer
-	        try {
-	            choice = stoi(input); // Convert input to integer
-	        } catch (const invalid_argument&) {
-	            cout << "Invalid choice! Please enter a number between 1 and 5.\n";
-	            continue; // Skip to the next loop iteration
-	        }
-	
-	        switch (choice) {
-	            case 1:
-	                setViewStrategy(make_shared<CategoryViewStrategy>());
-	                break;
-	            case 2:
-	                setViewStrategy(make_shared<WeeklyViewStrategy>());
-	                break;
-	            case 3:
-	                setViewStrategy(make_shared<MonthlyViewStrategy>());
-	                break;
-	            case 4:
-	                setViewStrategy(make_shared<YearlyViewStrategy>());
-	                break;
-	            case 5:
-	                setViewStrategy(make_shared<AllViewStrategy>());
-	                break;
-	            default:
-	                cout << "Invalid choice! Please select a valid option.\n";
-	                continue; // Go back to the top of the loop
-	        }
-	
-	        // If a valid choice was made, break out of the loop
-	        break;
-	    } while (true);
-	}
 
+    static uint64_t fingerprint(int dayNumber, double amount, uint16_t currency, string_view category) {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a over the trimmed, lower-cased category
+        size_t begin = category.find_first_not_of(' ');
+        size_t end = category.find_last_not_of(' ');
+        for (size_t i = begin; begin != string_view::npos && i <= end; ++i) {
+            hash = (hash ^ static_cast<unsigned char>(tolower(static_cast<unsigned char>(category[i])))) * 1099511628211ull;
+        }
+        hash = mix(hash ^ static_cast<uint32_t>(dayNumber));
+        hash = mix(hash ^ static_cast<uint64_t>(llround(amount * 100)));
+        return mix(hash ^ currency);
+    }
 
-	void expensesView(const User& user, double& totalExpenses) {
-        if (!viewStrategy) {
-            cout << "No view strategy selected!\n";
+    // Adds (sign = 1) or withdraws (sign = -1) one expense's fingerprint
+    void add(uint64_t key, int sign) {
+        if (sign < 0) {
+            auto found = counts.find(key);
+            if (found != counts.end() && --found->second == 0) {
+                counts.erase(found);
+            }
             return;
         }
-        viewStrategy->viewExpenses(user, totalExpenses);
+        if (++counts[key] == 1) {
+            if (++inserted > capacity) {
+                rebuild(2 * max(capacity, counts.size()));
+            } else {
+                setBits(key);
+            }
+        }
     }
 
-	void viewExpenses(User& user) {
-    int choice;
-    string menuTitle = "VIEW EXPENSE";
-    system("cls");
-    	// header
-        printHeader(menuTitle); 
-		
-		if (user.getExpenses().empty()) {
-			cout << "> You do not have any expense entries yet." << endl;
-			cout << "> Redirecting to main menu." << endl;
-			cout << "> Press any key to continue ...";
-			cin.ignore(numeric_limits<streamsize>::max(), '\n');
-			cin.get();
-			return;
-		}   
-		    
-		// Let the user select a strategy
-	    handleExpensesView(user);
-	
-	    // Execute the selected strategy
-	    expensesView(user, totalExpenses);
-
-		char viewChoice;
-	    do {
-	        cout << "\n> View in another display type? (Y/N): ";
-	        cin >> viewChoice;
-	    } while (tolower(viewChoice) != 'y' && tolower(viewChoice) != 'n');  // Loop until valid input
-	
-	    if (tolower(viewChoice) == 'y') {
-	        viewExpenses(user);  // Recursive call to view expenses again
-	    } else {
-	        cout << endl << "> Redirecting to the main menu ..." << endl;
-	        cout << "> Press any key to continue ...";
-	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-	        cin.get();
-	    }
-	}
+    // Recorded expenses with this fingerprint; almost always answered by the filter alone
+    size_t count(uint64_t key) const {
+        if (!mayContain(key)) {
+            return 0;
+        }
+        auto found = counts.find(key);
+        return found == counts.end() ? 0 : found->second;
+    }
 
+    bool mayContain(uint64_t key) const {
+        uint64_t step = mix(key) | 1;
+        for (int i = 0; i < hashCount; ++i, key += step) {
+            size_t bit = bitOf(key);
+            if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64)))) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-	void modifyExpense(User& user, BudgetManager& budgetManager) {	
-    string menuTitle = "MODIFY EXPENSE";
-    system("cls");
-    printHeader(menuTitle);
-    
-    if (user.getExpenses().empty()) {
-        cout << "> You do not have any expense entries yet." << endl;
-        cout << "> Redirecting to the main menu..." << endl;
-        system("pause");
-        return;
+    void clear() {
+        counts.clear();
+        rebuild(MIN_CAPACITY);
     }
-    
-    handleExpensesView(user);
-    expensesView(user, totalExpenses);
 
-    int id;
-    cout << "\n> Input expense ID to modify (or '0' to cancel): ";
-    cin >> id;
+    size_t memoryBytes() const {
+        return bits.capacity() * sizeof(uint64_t) + counts.size() * (sizeof(pair<uint64_t, uint32_t>) + 2 * sizeof(void*));
+    }
 
-    if (id == 0) {
-        return;
+private:
+    vector<uint64_t> bits;
+    unordered_map<uint64_t, uint32_t> counts;
+    double bitsPerKey = 0;
+    int hashCount = 1;
+    size_t capacity = 0; // distinct fingerprints the filter was sized for
+    size_t inserted = 0; // distinct fingerprints set since the last rebuild
+
+    // splitmix64 finalizer
+    static uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+        return value ^ (value >> 31);
     }
 
-    // Locate the expense manually using a loop
-    auto& expenses = user.getExpenses();
-    shared_ptr<Expense> expense = nullptr;
+    // Maps the high half of a probe onto the filter without a division
+    size_t bitOf(uint64_t probe) const {
+        return static_cast<size_t>(((probe >> 32) * (bits.size() * 64)) >> 32);
+    }
 
-    for (auto& exp : expenses) {
-        if (exp->getId() == id) {
-            expense = exp;
-            break;
+    void setBits(uint64_t key) {
+        uint64_t step = mix(key) | 1;
+        for (int i = 0; i < hashCount; ++i, key += step) {
+            size_t bit = bitOf(key);
+            bits[bit / 64] |= uint64_t(1) << (bit % 64);
         }
     }
 
-    if (!expense) {
-        cout << "> Expense ID not found. Returning to main menu..." << endl;
-        system("pause");
-        return;
+    void rebuild(size_t newCapacity) {
+        capacity = newCapacity;
+        bits.assign(static_cast<size_t>(ceil(bitsPerKey * capacity / 64)), 0);
+        for (const auto& entry : counts) {
+            setBits(entry.first);
+        }
+        inserted = counts.size();
     }
+};
 
-    // Display current details
-    cout << "\nCurrent Details:" << endl;
-    cout << "ID: " << expense->getId() << endl;
-    cout << "Amount: " << expense->getAmount() << endl;
-    cout << "Category: " << expense->getCategory() << endl;
-    cout << "Date: " << expense->getDate() << endl;
+// Hit/miss counters and memory use of a user's result cache
+struct ResultCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t capacity = 0;
 
-    // Modify expense fields
-    double newAmount = expense->getAmount();
-    string newCategory = expense->getCategory();
-    string newDate = expense->getDate();
+    double hitRate() const { return hits + misses ? 100.0 * hits / (hits + misses) : 0; }
+};
 
-    cout << "\nEnter new details (leave blank to retain current value):" << endl;
+// Rendered views and reports keyed by normalized query, valid for one version of the user's data
+class ResultCache {
+private:
+    struct Entry {
+        string output;
+        double total;
+        unsigned long long version;
+        list<string>::iterator lruPos;
+    };
+    static const size_t DEFAULT_CAPACITY = 256 * 1024; // bytes of cached output per user
+
+    unordered_map<string, Entry> entries;
+    list<string> lru; // front = most recently used
+    size_t bytes = 0;
+    size_t capacity = DEFAULT_CAPACITY;
+    ResultCacheStats stats;
+
+    static size_t entryBytes(const string& key, const Entry& entry) {
+        return 2 * key.size() + entry.output.capacity() + sizeof(Entry) + 4 * sizeof(void*);
+    }
 
-    // Loop until valid amount is entered
-    string amountInput;
+    void erase(unordered_map<string, Entry>::iterator it) {
+        bytes -= entryBytes(it->first, it->second);
+        lru.erase(it->second.lruPos);
+        entries.erase(it);
+    }
+
+public:
+    bool lookup(const string& key, unsigned long long version, string& output, double& total) {
+        auto found = entries.find(key);
+        if (found == entries.end() || found->second.version != version) {
+            stats.misses++;
+            return false;
+        }
+        stats.hits++;
+        lru.splice(lru.begin(), lru, found->second.lruPos);
+        output = found->second.output;
+        total = found->second.total;
+        return true;
+    }
+
+    void store(const string& key, unsigned long long version, const string& output, double total) {
+        auto found = entries.find(key);
+        if (found != entries.end()) {
+            erase(found);
+        }
+        lru.push_front(key);
+        Entry entry{output, total, version, lru.begin()};
+        size_t size = entryBytes(key, entry);
+        if (size > capacity) {
+            lru.pop_front(); // larger than the whole cache; not worth keeping
+            return;
+        }
+        bytes += size;
+        entries.emplace(key, std::move(entry));
+        while (bytes > capacity) {
+            erase(entries.find(lru.back()));
+        }
+    }
+
+    // Any mutation of the user's data makes every cached result stale
+    void invalidate() {
+        entries.clear();
+        lru.clear();
+        bytes = 0;
+    }
+
+    ResultCacheStats getStats() const {
+        ResultCacheStats current = stats;
+        current.entries = entries.size();
+        current.bytes = bytes;
+        current.capacity = capacity;
+        return current;
+    }
+
+    size_t memoryBytes() const { return bytes; }
+};
+
+// Bit tricks on 64-bit words, with portable fallbacks
+class BitUtil {
+public:
+    static int lowestBit(uint64_t bits) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        int index = 0;
+        while (!(bits & 1)) {
+            bits >>= 1;
+            index++;
+        }
+        return index;
+#endif
+    }
+
+    static int bitCount(uint64_t bits) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(bits);
+#else
+        int count = 0;
+        for (; bits; bits &= bits - 1) {
+            count++;
+        }
+        return count;
+#endif
+    }
+};
+
+// Per-user interned tag names; a tag's id is its bit in Expense::getTags()
+class TagDictionary {
+public:
+    static const size_t MAX_TAGS = 64;
+
+    // Letters, digits, '-' and '_'; the TagQuery operators "and", "or" and "not" are reserved
+    static bool isValidName(const string& name) {
+        string lower = InputValidator::toLowerCase(name);
+        if (name.empty() || lower == "and" || lower == "or" || lower == "not") {
+            return false;
+        }
+        for (char c : name) {
+            if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int find(const string& name) const {
+        auto found = ids.find(InputValidator::toLowerCase(name));
+        return found == ids.end() ? -1 : found->second;
+    }
+
+    // Id of the tag, adding it when new; -1 for an invalid name or a full dictionary
+    int intern(const string& name) {
+        string key = InputValidator::toLowerCase(name);
+        auto found = ids.find(key);
+        if (found != ids.end()) {
+            return found->second;
+        }
+        if (!isValidName(key) || names.size() >= MAX_TAGS) {
+            return -1;
+        }
+        ids.emplace(key, static_cast<int>(names.size()));
+        names.push_back(key);
+        return static_cast<int>(names.size()) - 1;
+    }
+
+    size_t size() const { return names.size(); }
+
+    // Tag names of a bitset, comma separated
+    string describe(uint64_t tags) const {
+        string text;
+        for (size_t id = 0; id < names.size(); ++id) {
+            if (tags & (uint64_t(1) << id)) {
+                text += (text.empty() ? "" : ",") + names[id];
+            }
+        }
+        return text;
+    }
+
+private:
+    vector<string> names;
+    unordered_map<string, int> ids;
+};
+
+// Roaring-style set of row slots: slots are grouped in chunks of 65536, each kept as a sorted
+// array of 16-bit offsets while sparse and as a 1024-word bitmap once dense
+class TagBitmap {
+public:
+    static const size_t CHUNK_BITS = 65536;
+    static const size_t CHUNK_WORDS = CHUNK_BITS / 64;
+
+    void add(size_t slot) {
+        Container& container = chunks[slot / CHUNK_BITS];
+        uint16_t low = static_cast<uint16_t>(slot % CHUNK_BITS);
+        if (!container.bits.empty()) {
+            uint64_t& word = container.bits[low / 64];
+            uint64_t mask = uint64_t(1) << (low % 64);
+            container.cardinality += (word & mask) ? 0 : 1;
+            word |= mask;
+            return;
+        }
+        auto position = lower_bound(container.array.begin(), container.array.end(), low);
+        if (position != container.array.end() && *position == low) {
+            return;
+        }
+        container.array.insert(position, low);
+        container.cardinality++;
+        if (container.cardinality > ARRAY_LIMIT) {
+            container.bits.assign(CHUNK_WORDS, 0);
+            for (uint16_t offset : container.array) {
+                container.bits[offset / 64] |= uint64_t(1) << (offset % 64);
+            }
+            vector<uint16_t>().swap(container.array);
+        }
+    }
+
+    void remove(size_t slot) {
+        auto found = chunks.find(slot / CHUNK_BITS);
+        if (found == chunks.end()) {
+            return;
+        }
+        Container& container = found->second;
+        uint16_t low = static_cast<uint16_t>(slot % CHUNK_BITS);
+        if (!container.bits.empty()) {
+            uint64_t& word = container.bits[low / 64];
+            uint64_t mask = uint64_t(1) << (low % 64);
+            container.cardinality -= (word & mask) ? 1 : 0;
+            word &= ~mask;
+            if (container.cardinality <= ARRAY_LIMIT / 2) { // back to an array, with hysteresis
+                for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+                    for (uint64_t bits = container.bits[i]; bits; bits &= bits - 1) {
+                        container.array.push_back(static_cast<uint16_t>(i * 64 + BitUtil::lowestBit(bits)));
+                    }
+                }
+                vector<uint64_t>().swap(container.bits);
+            }
+        } else {
+            auto position = lower_bound(container.array.begin(), container.array.end(), low);
+            if (position != container.array.end() && *position == low) {
+                container.array.erase(position);
+                container.cardinality--;
+            }
+        }
+        if (container.cardinality == 0) {
+            chunks.erase(found);
+        }
+    }
+
+    // Writes the chunk's slots as CHUNK_WORDS bitmap words
+    void load(size_t chunk, uint64_t* words) const {
+        auto found = chunks.find(chunk);
+        if (found == chunks.end()) {
+            fill(words, words + CHUNK_WORDS, 0);
+        } else if (!found->second.bits.empty()) {
+            copy(found->second.bits.begin(), found->second.bits.end(), words);
+        } else {
+            fill(words, words + CHUNK_WORDS, 0);
+            for (uint16_t offset : found->second.array) {
+                words[offset / 64] |= uint64_t(1) << (offset % 64);
+            }
+        }
+    }
+
+    void clear() { chunks.clear(); }
+
+    size_t memoryBytes() const {
+        size_t bytes = 0;
+        for (const auto& chunk : chunks) {
+            bytes += sizeof(Container) + 4 * sizeof(void*) + chunk.second.array.capacity() * sizeof(uint16_t)
+                   + chunk.second.bits.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+private:
+    static const size_t ARRAY_LIMIT = 4096; // beyond this an array outgrows the 8 KB bitmap
+
+    struct Container {
+        vector<uint16_t> array; // sorted offsets, used while bits is empty
+        vector<uint64_t> bits;
+        size_t cardinality = 0;
+    };
+    map<size_t, Container> chunks;
+};
+
+// Boolean tag expression such as "business and (trip-2024 or not reimbursable)", compiled to
+// postfix so it can be evaluated over a single bitset or over whole bitmap words at a time
+class TagQuery {
+public:
+    // False with a message when the expression does not parse or names an unknown tag
+    bool parse(const string& text, const TagDictionary& dictionary, string& error) {
+        tokens.clear();
+        program.clear();
+        depth = maxDepth = nesting = 0;
+        string word;
+        auto flush = [&]() {
+            if (!word.empty()) {
+                tokens.push_back(InputValidator::toLowerCase(word));
+                word.clear();
+            }
+        };
+        for (char c : text) {
+            if (isspace(static_cast<unsigned char>(c))) {
+                flush();
+            } else if (c == '(' || c == ')' || c == '&' || c == '|' || c == '!') {
+                flush();
+                tokens.push_back(string(1, c));
+            } else {
+                word += c;
+            }
+        }
+        flush();
+        if (tokens.empty()) {
+            error = "Enter at least one tag.";
+            return false;
+        }
+        size_t position = 0;
+        if (!parseOr(position, dictionary, error)) {
+            return false;
+        }
+        if (position != tokens.size()) {
+            error = "Unexpected '" + tokens[position] + "'.";
+            return false;
+        }
+        return true;
+    }
+
+    bool matches(uint64_t tags) const {
+        uint64_t stack[64];
+        size_t depth = 0;
+        for (const Step& step : program) {
+            switch (step.op) {
+                case Op::Tag: stack[depth++] = (tags >> step.tag) & 1; break;
+                case Op::Not: stack[depth - 1] ^= 1; break;
+                case Op::And: depth--; stack[depth - 1] &= stack[depth]; break;
+                case Op::Or: depth--; stack[depth - 1] |= stack[depth]; break;
+            }
+        }
+        return depth == 1 && stack[0];
+    }
+
+    // Matching slots of one chunk as TagBitmap::CHUNK_WORDS words; index holds one bitmap per tag
+    void evaluate(const vector<TagBitmap>& index, size_t chunk, vector<uint64_t>& out) const {
+        const size_t words = TagBitmap::CHUNK_WORDS;
+        if (program.empty()) {
+            out.assign(words, 0);
+            return;
+        }
+        vector<uint64_t> stack(maxDepth * words);
+        size_t depth = 0;
+        for (const Step& step : program) {
+            if (step.op == Op::Tag) {
+                uint64_t* top = stack.data() + depth * words;
+                if (static_cast<size_t>(step.tag) < index.size()) {
+                    index[step.tag].load(chunk, top);
+                } else {
+                    fill(top, top + words, 0);
+                }
+                depth++;
+            } else if (step.op == Op::Not) {
+                uint64_t* top = stack.data() + (depth - 1) * words;
+                for (size_t i = 0; i < words; ++i) {
+                    top[i] = ~top[i];
+                }
+            } else {
+                depth--;
+                uint64_t* left = stack.data() + (depth - 1) * words;
+                const uint64_t* right = left + words;
+                if (step.op == Op::And) {
+                    for (size_t i = 0; i < words; ++i) {
+                        left[i] &= right[i];
+                    }
+                } else {
+                    for (size_t i = 0; i < words; ++i) {
+                        left[i] |= right[i];
+                    }
+                }
+            }
+        }
+        out.assign(stack.begin(), stack.begin() + words);
+    }
+
+    // Normalized form, usable as a cache key
+    string canonical() const {
+        string text;
+        for (const Step& step : program) {
+            switch (step.op) {
+                case Op::Tag: text += "t" + to_string(step.tag) + " "; break;
+                case Op::Not: text += "! "; break;
+                case Op::And: text += "& "; break;
+                case Op::Or: text += "| "; break;
+            }
+        }
+        return text;
+    }
+
+private:
+    enum class Op { Tag, And, Or, Not };
+    struct Step {
+        Op op;
+        int tag;
+    };
+    static const size_t MAX_DEPTH = 64;
+    static const size_t MAX_NESTING = 64; // parentheses and "not"s inside each other, which bounds the recursion
+
+    vector<string> tokens;
+    vector<Step> program;
+    size_t depth = 0;    // evaluation stack depth after the emitted steps
+    size_t maxDepth = 0; // so the stack can be sized once
+    size_t nesting = 0;  // parentheses and "not"s open at the current position
+
+    void emit(Op op, int tag = -1) {
+        program.push_back({op, tag});
+        if (op == Op::Tag) {
+            maxDepth = max(maxDepth, ++depth);
+        } else if (op != Op::Not) {
+            depth--;
+        }
+    }
+
+    bool parseOr(size_t& position, const TagDictionary& dictionary, string& error) {
+        if (!parseAnd(position, dictionary, error)) {
+            return false;
+        }
+        while (position < tokens.size() && (tokens[position] == "or" || tokens[position] == "|")) {
+            position++;
+            if (!parseAnd(position, dictionary, error)) {
+                return false;
+            }
+            emit(Op::Or);
+        }
+        return true;
+    }
+
+    bool parseAnd(size_t& position, const TagDictionary& dictionary, string& error) {
+        if (!parseNot(position, dictionary, error)) {
+            return false;
+        }
+        while (position < tokens.size() && (tokens[position] == "and" || tokens[position] == "&")) {
+            position++;
+            if (!parseNot(position, dictionary, error)) {
+                return false;
+            }
+            emit(Op::And);
+        }
+        return true;
+    }
+
+    bool parseNot(size_t& position, const TagDictionary& dictionary, string& error) {
+        if (position >= tokens.size()) {
+            error = "The expression ends too early.";
+            return false;
+        }
+        const string& token = tokens[position];
+        bool negated = token == "not" || token == "!";
+        if ((negated || token == "(") && nesting >= MAX_NESTING) {
+            error = "The expression is nested too deeply.";
+            return false;
+        }
+        if (negated) {
+            position++;
+            nesting++;
+            if (!parseNot(position, dictionary, error)) {
+                return false;
+            }
+            nesting--;
+            emit(Op::Not);
+            return true;
+        }
+        if (token == "(") {
+            position++;
+            nesting++;
+            if (!parseOr(position, dictionary, error)) {
+                return false;
+            }
+            nesting--;
+            if (position >= tokens.size() || tokens[position] != ")") {
+                error = "Missing ')'.";
+                return false;
+            }
+            position++;
+            return true;
+        }
+        int tag = dictionary.find(token);
+        if (tag < 0) {
+            error = "Unknown tag '" + token + "'.";
+            return false;
+        }
+        if (depth >= MAX_DEPTH) {
+            error = "The expression is too long.";
+            return false;
+        }
+        position++;
+        emit(Op::Tag, tag);
+        return true;
+    }
+};
+
+// Selects expenses for a bulk edit; bounds left at their defaults match everything
+struct ExpenseFilter {
+    int fromDay = numeric_limits<int>::min();
+    int toDay = numeric_limits<int>::max();
+    string categoryLower; // empty matches any category
+    double minAmount = 0;
+    double maxAmount = numeric_limits<double>::max();
+
+    bool matches(const Expense& expense) const {
+        if (expense.getAmount() < minAmount || expense.getAmount() > maxAmount) {
+            return false;
+        }
+        if (!categoryLower.empty() && InputValidator::toLowerCase(expense.getCategory()) != categoryLower) {
+            return false;
+        }
+        if (fromDay != numeric_limits<int>::min() || toDay != numeric_limits<int>::max()) {
+            int dayNumber;
+            if (!DateUtil::toDayNumber(expense.getDate(), dayNumber) || dayNumber < fromDay || dayNumber > toDay) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+enum class BulkAction { SetCategory, AdjustAmount, Delete };
+
+// The user's main budget: an amount per period, with a ledger of spend per period kept
+// incrementally. With rollover the unspent part of each period is carried into the next;
+// carries are settled lazily from the earliest period that changed since the last query
+class BudgetLedger {
+public:
+    struct PeriodSummary {
+        int start;
+        double budget;
+        double carriedIn;
+        double spent;
+
+        double remaining() const { return budget + carriedIn - spent; }
+    };
+
+    void configure(double newAmount, BudgetPeriod newPeriod, bool newRollover) {
+        amount = newAmount;
+        period = newPeriod;
+        rollover = newRollover;
+        markDirty(numeric_limits<int>::min());
+    }
+
+    double getAmount() const { return amount; }
+    BudgetPeriod getPeriod() const { return period; }
+    bool hasRollover() const { return rollover; }
+
+    void add(int dayNumber, double spent) {
+        int start = DateUtil::periodStart(period, dayNumber);
+        entries[start].spent += spent;
+        if (currentValid && start == current.start) {
+            current.spent += spent; // the common case: spending in the current period, O(1)
+        }
+        markDirty(start);
+    }
+
+    // Forgets all spend; the amount, period and rollover setting stay
+    void clear() {
+        entries.clear();
+        markDirty(numeric_limits<int>::min());
+    }
+
+    // Budget, carry and spend of the period holding dayNumber; O(1) when asked again for the same period
+    PeriodSummary summary(int dayNumber) const {
+        int start = DateUtil::periodStart(period, dayNumber);
+        if (currentValid && current.start == start) {
+            return current;
+        }
+        settle();
+        PeriodSummary result{start, amount, 0, 0};
+        auto found = entries.lower_bound(start);
+        if (found != entries.end() && found->first == start) {
+            result.carriedIn = found->second.carriedIn;
+            result.spent = found->second.spent;
+        } else if (found != entries.begin()) {
+            result.carriedIn = carryInto(*prev(found), start);
+        }
+        current = result;
+        currentValid = true;
+        return result;
+    }
+
+    // Every period from the first one with spending up to the one holding dayNumber
+    vector<PeriodSummary> history(int dayNumber) const {
+        vector<PeriodSummary> periods;
+        if (entries.empty()) {
+            return periods;
+        }
+        int last = DateUtil::periodStart(period, dayNumber);
+        for (int start = entries.begin()->first; start <= last; start = DateUtil::periodEnd(period, start) + 1) {
+            periods.push_back(summary(start));
+        }
+        return periods;
+    }
+
+private:
+    struct Entry {
+        double spent = 0;
+        mutable double carriedIn = 0; // settled lazily
+    };
+
+    double amount = 0;
+    BudgetPeriod period = BudgetPeriod::Monthly;
+    bool rollover = false;
+    map<int, Entry> entries; // period start day -> entry
+    mutable int dirtyFrom = numeric_limits<int>::max(); // carries from here on are stale
+    mutable PeriodSummary current{0, 0, 0, 0};          // last period asked for
+    mutable bool currentValid = false;
+
+    void markDirty(int start) {
+        dirtyFrom = min(dirtyFrom, start);
+        if (currentValid && current.start != start) {
+            currentValid = current.start < start; // earlier periods are unaffected by a later change
+        }
+    }
+
+    // Carry into the period at start from the closest earlier period with spending;
+    // the periods in between had no spending, so each adds a whole budget
+    double carryInto(const pair<const int, Entry>& previous, int start) const {
+        if (!rollover) {
+            return 0;
+        }
+        double unspent = max(0.0, amount + previous.second.carriedIn - previous.second.spent);
+        return unspent + (DateUtil::periodsBetween(period, previous.first, start) - 1) * amount;
+    }
+
+    void settle() const {
+        if (dirtyFrom == numeric_limits<int>::max()) {
+            return;
+        }
+        for (auto it = entries.lower_bound(dirtyFrom); it != entries.end(); ++it) {
+            it->second.carriedIn = it == entries.begin() ? 0 : carryInto(*prev(it), it->first);
+        }
+        dirtyFrom = numeric_limits<int>::max();
+    }
+};
+
+// Running forecast of the spend in one budget period. Each day's spend feeds an exponentially
+// weighted moving average and the sums of a least-squares line through the daily totals, so a
+// change is O(1) and a projection never rescans the history. Spend dated after the last day
+// seen waits until that day comes, so scheduled spending does not inflate today's rate
+class SpendForecast {
+public:
+    static constexpr double SMOOTHING = 0.2; // EWMA weight of the latest day
+    static const int NO_RUN_OUT = numeric_limits<int>::max();
+
+    struct Projection {
+        double dailyRate;      // expected spend tomorrow
+        double projectedSpend; // by the end of the period, spending already dated included
+        int runOutDay;         // first day the budget is used up, or NO_RUN_OUT within the period
+    };
+
+    bool covers(int periodStart, int periodEnd) const { return active && start == periodStart && end == periodEnd; }
+
+    // Starts over on the period [periodStart, periodEnd] as of today, seeded with each day's spend
+    void reset(int periodStart, int periodEnd, int today, const function<double(int)>& spendOn) {
+        clear();
+        active = true;
+        start = periodStart;
+        end = periodEnd;
+        lastDay = max(start, min(today, end));
+        for (int dayNumber = start; dayNumber <= end; ++dayNumber) {
+            double amount = spendOn(dayNumber);
+            if (amount != 0) {
+                add(dayNumber, amount);
+            }
+        }
+    }
+
+    // Spend (or a negative amount to withdraw it) on a day; days outside the period are ignored
+    void add(int dayNumber, double amount) {
+        if (!active || dayNumber < start || dayNumber > end) {
+            return;
+        }
+        if (dayNumber > lastDay) {
+            pending[dayNumber] += amount;
+        } else {
+            fold(dayNumber, amount);
+        }
+    }
+
+    // Moves the forecast on to today, folding in the spend dated up to it
+    void advance(int today) {
+        lastDay = max(lastDay, min(today, end));
+        while (!pending.empty() && pending.begin()->first <= lastDay) {
+            fold(pending.begin()->first, pending.begin()->second);
+            pending.erase(pending.begin());
+        }
+    }
+
+    // Each remaining day is expected to cost the average of the EWMA level and the fitted line
+    // at that day, never less than zero; one pass over the days left in the period
+    Projection project(double spent, double available) const {
+        double elapsed = lastDay - start + 1;
+        double level = SMOOTHING * weighted / pow(1 - SMOOTHING, end - lastDay) / (1 - pow(1 - SMOOTHING, elapsed));
+        double slope = 0, intercept = sumSpend;
+        if (elapsed > 1) {
+            double sumX = elapsed * (elapsed - 1) / 2;
+            double sumXX = (elapsed - 1) * elapsed * (2 * elapsed - 1) / 6;
+            slope = (elapsed * sumDaySpend - sumX * sumSpend) / (elapsed * sumXX - sumX * sumX);
+            intercept = (sumSpend - slope * sumX) / elapsed;
+        }
+
+        Projection result{0, spent, spent >= available ? lastDay : NO_RUN_OUT};
+        for (int ahead = 1; ahead <= end - lastDay; ++ahead) {
+            double rate = max(0.0, (level + intercept + slope * (elapsed - 1 + ahead)) / 2);
+            if (ahead == 1) {
+                result.dailyRate = rate;
+            }
+            result.projectedSpend += rate;
+            if (result.runOutDay == NO_RUN_OUT && result.projectedSpend >= available) {
+                result.runOutDay = lastDay + ahead;
+            }
+        }
+        return result;
+    }
+
+    void clear() {
+        active = false;
+        sumSpend = sumDaySpend = weighted = 0;
+        pending.clear();
+    }
+
+private:
+    bool active = false;
+    int start = 0, end = 0;
+    int lastDay = 0;         // spend up to here is folded in
+    double sumSpend = 0;     // sum of daily spend
+    double sumDaySpend = 0;  // sum of (day - start) * daily spend
+    double weighted = 0;     // sum of daily spend * (1 - SMOOTHING)^(end - day)
+    map<int, double> pending; // spend dated after lastDay
+
+    void fold(int dayNumber, double amount) {
+        sumSpend += amount;
+        sumDaySpend += (dayNumber - start) * amount;
+        weighted += amount * pow(1 - SMOOTHING, end - dayNumber);
+    }
+};
+
+// Nested category budgets such as "food > dining > coffee". An expense counts toward the budget
+// of its own category and of every ancestor, so each change walks one root-to-leaf path: O(depth)
+class CategoryBudgets {
+public:
+    struct Status {
+        string path;
+        int depth;
+        double limit;
+        BudgetPeriod period;
+        double spent; // in the current period
+    };
+
+    static constexpr double WARNING_SHARE = 0.8;
+
+    struct Setting {
+        string path;
+        double limit;
+        BudgetPeriod period;
+    };
+
+    // Spend the rows do not hold, such as recurring occurrences, for the budget at a path in a period
+    typedef function<double(const vector<string>& path, int periodStart, int periodEnd)> ExtraSpend;
+
+    // "Food > Dining>coffee" -> {"food", "dining", "coffee"}
+    static vector<string> splitPath(const string& category) {
+        vector<string> parts;
+        size_t start = 0;
+        while (start <= category.size()) {
+            size_t end = category.find('>', start);
+            if (end == string::npos) {
+                end = category.size();
+            }
+            size_t first = category.find_first_not_of(' ', start);
+            size_t last = category.find_last_not_of(' ', end - 1);
+            if (first < end && last != string::npos && last >= first) {
+                parts.push_back(InputValidator::toLowerCase(category.substr(first, last - first + 1)));
+            }
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    static string joinPath(const vector<string>& parts) {
+        string path;
+        for (const string& part : parts) {
+            path += (path.empty() ? "" : " > ") + part;
+        }
+        return path;
+    }
+
+    // Adds or replaces the budget at path; its spend starts empty and is refilled with addTo
+    bool setBudget(const string& path, double limit, BudgetPeriod period) {
+        vector<string> parts = splitPath(path);
+        if (parts.empty() || limit <= 0) {
+            return false;
+        }
+        int node = 0;
+        for (const string& part : parts) {
+            auto found = nodes[node].children.find(part);
+            if (found == nodes[node].children.end()) {
+                nodes.emplace_back(part, node);
+                found = nodes[node].children.emplace(part, static_cast<int>(nodes.size()) - 1).first;
+            }
+            node = found->second;
+        }
+        Node& budget = nodes[node];
+        budget.hasBudget = true;
+        budget.limit = limit;
+        budget.period = period;
+        budget.spent.clear();
+        budget.alerted.clear();
+        return true;
+    }
+
+    bool removeBudget(const string& path) {
+        int node = find(splitPath(path));
+        if (node <= 0 || !nodes[node].hasBudget) {
+            return false;
+        }
+        nodes[node].hasBudget = false;
+        nodes[node].spent.clear();
+        nodes[node].alerted.clear();
+        return true;
+    }
+
+    // Applies a signed amount to every budget on the category's path
+    void add(const string& category, int dayNumber, double amount) {
+        if (nodes.size() == 1) {
+            return; // no budgets at all
+        }
+        int node = 0;
+        for (const string& part : splitPath(category)) {
+            auto found = nodes[node].children.find(part);
+            if (found == nodes[node].children.end()) {
+                break;
+            }
+            node = found->second;
+            if (nodes[node].hasBudget) {
+                int start = DateUtil::periodStart(nodes[node].period, dayNumber);
+                nodes[node].spent[start] += amount;
+                changed.emplace_back(node, start);
+            }
+        }
+    }
+
+    // Counts an expense toward the budget at path only (used to fill a new budget)
+    void addTo(const string& path, const string& category, int dayNumber, double amount) {
+        vector<string> budgetParts = splitPath(path), parts = splitPath(category);
+        int node = find(budgetParts);
+        if (node > 0 && parts.size() >= budgetParts.size() && equal(budgetParts.begin(), budgetParts.end(), parts.begin())) {
+            nodes[node].spent[DateUtil::periodStart(nodes[node].period, dayNumber)] += amount;
+        }
+    }
+
+    // Marks the period holding dayNumber of every budget as touched, so the next collectAlerts
+    // checks spend that arrives without a row, e.g. a recurring occurrence coming due
+    void touchAll(int dayNumber) {
+        for (size_t node = 1; node < nodes.size(); ++node) {
+            if (nodes[node].hasBudget) {
+                changed.emplace_back(static_cast<int>(node), DateUtil::periodStart(nodes[node].period, dayNumber));
+            }
+        }
+    }
+
+    // Turns the budget periods touched since the last call into alerts for newly crossed thresholds
+    void collectAlerts(vector<string>& alerts, const ExtraSpend& extra) {
+        for (const auto& touched : changed) {
+            Node& node = nodes[touched.first];
+            if (!node.hasBudget) {
+                continue;
+            }
+            double spent = node.spent[touched.second]
+                         + extra(partsOf(touched.first), touched.second, DateUtil::periodEnd(node.period, touched.second));
+            int level = spent >= node.limit ? 2 : spent >= WARNING_SHARE * node.limit ? 1 : 0;
+            int& alerted = node.alerted[touched.second];
+            if (level > alerted) {
+                ostringstream alert;
+                alert << "'" << pathOf(touched.first) << "' "
+                      << (level == 2 ? "is over" : "has reached " + to_string(static_cast<int>(WARNING_SHARE * 100)) + "% of")
+                      << " its " << DateUtil::periodName(node.period) << " budget (" << spent << " of " << node.limit
+                      << " in " << DateUtil::periodLabel(node.period, touched.second) << ").";
+                alerts.push_back(alert.str());
+            }
+            alerted = level;
+        }
+        changed.clear();
+    }
+
+    void discardChanges() { changed.clear(); }
+
+    // Forgets all spend but keeps the budgets and the thresholds already alerted
+    void clearSpend() {
+        for (Node& node : nodes) {
+            node.spent.clear();
+        }
+        changed.clear();
+    }
+
+    // Budgets in tree order with their spend in the period holding dayNumber
+    vector<Status> list(int dayNumber, const ExtraSpend& extra) const {
+        vector<Status> result;
+        collect(0, 0, dayNumber, extra, result);
+        return result;
+    }
+
+    bool empty() const { return nodes.size() == 1; }
+
+    // Every budget without its spend, e.g. for the mutation log
+    vector<Setting> settings() const {
+        vector<Setting> result;
+        for (size_t node = 1; node < nodes.size(); ++node) {
+            if (nodes[node].hasBudget) {
+                result.push_back({pathOf(static_cast<int>(node)), nodes[node].limit, nodes[node].period});
+            }
+        }
+        return result;
+    }
+
+private:
+    struct Node {
+        string name;
+        int parent = -1;
+        map<string, int> children;
+        bool hasBudget = false;
+        double limit = 0;
+        BudgetPeriod period = BudgetPeriod::Monthly;
+        map<int, double> spent; // period start day -> spend in that period
+        map<int, int> alerted;  // period start day -> highest alert raised (1 = warning, 2 = over)
+
+        explicit Node(const string& name, int parent = -1) : name(name), parent(parent) {}
+    };
+
+    vector<Node> nodes{Node("")}; // node 0 is the root
+    vector<pair<int, int>> changed; // (node, period start) touched since the last collectAlerts
+
+    int find(const vector<string>& parts) const {
+        int node = 0;
+        for (const string& part : parts) {
+            auto found = nodes[node].children.find(part);
+            if (found == nodes[node].children.end()) {
+                return -1;
+            }
+            node = found->second;
+        }
+        return node;
+    }
+
+    vector<string> partsOf(int node) const {
+        vector<string> parts;
+        for (; node > 0; node = nodes[node].parent) {
+            parts.push_back(nodes[node].name);
+        }
+        reverse(parts.begin(), parts.end());
+        return parts;
+    }
+
+    string pathOf(int node) const {
+        return joinPath(partsOf(node));
+    }
+
+    void collect(int node, int depth, int dayNumber, const ExtraSpend& extra, vector<Status>& result) const {
+        for (const auto& child : nodes[node].children) {
+            const Node& entry = nodes[child.second];
+            if (entry.hasBudget) {
+                int start = DateUtil::periodStart(entry.period, dayNumber);
+                auto spent = entry.spent.find(start);
+                result.push_back({pathOf(child.second), depth, entry.limit, entry.period,
+                                  (spent == entry.spent.end() ? 0 : spent->second)
+                                      + extra(partsOf(child.second), start, DateUtil::periodEnd(entry.period, start))});
+            }
+            collect(child.second, depth + 1, dayNumber, extra, result);
+        }
+    }
+};
+
+// How often a recurring expense repeats
+enum class RecurrenceUnit { Days, Weeks, Months, Years };
+
+// Recurring expenses such as rent or subscriptions, kept as rules instead of rows. Occurrences are
+// only expanded inside the window a view asks for, and window totals are counted in closed form.
+// Occurrence i of a rule falls i * interval units after its start; a monthly rule started on the
+// 31st falls on the last day of shorter months
+class RecurringSchedule {
+public:
+    struct Rule {
+        int id;
+        double amount;
+        string category;
+        int startDay;
+        int endDay;        // inclusive; numeric_limits<int>::max() when open ended
+        RecurrenceUnit unit;
+        int interval;      // units between occurrences, at least 1
+    };
+
+    int add(double amount, const string& category, int startDay, int endDay, RecurrenceUnit unit, int interval) {
+        rules.push_back({++lastRuleId, amount, category, startDay, endDay, unit, max(1, interval)});
+        return lastRuleId;
+    }
+
+    bool remove(int id) {
+        auto found = find_if(rules.begin(), rules.end(), [id](const Rule& rule) { return rule.id == id; });
+        if (found == rules.end()) {
+            return false;
+        }
+        rules.erase(found);
+        return true;
+    }
+
+    const vector<Rule>& getRules() const { return rules; }
+    bool empty() const { return rules.empty(); }
+
+    // Replaces the rules with saved ones, keeping their ids
+    void restore(const vector<Rule>& saved) {
+        rules = saved;
+        for (const Rule& rule : rules) {
+            lastRuleId = max(lastRuleId, rule.id);
+        }
+    }
+
+    static long long occurrenceDay(const Rule& rule, long long index) {
+        if (rule.unit == RecurrenceUnit::Days || rule.unit == RecurrenceUnit::Weeks) {
+            return rule.startDay + index * stepDays(rule);
+        }
+        int year, month, day;
+        DateUtil::fromDayNumber(rule.startDay, year, month, day);
+        long long monthIndex = year * 12LL + month - 1 + index * stepMonths(rule);
+        year = static_cast<int>(monthIndex / 12);
+        month = static_cast<int>(monthIndex % 12) + 1;
+        return DateUtil::toDayNumber(year, month, min(day, DateUtil::daysInMonth(year, month)));
+    }
+
+    // Occurrences inside [fromDay, toDay] are the indexes [first, last); O(1)
+    static void occurrenceRange(const Rule& rule, int fromDay, int toDay, long long& first, long long& last) {
+        long long low = max(fromDay, rule.startDay);
+        long long high = min(toDay, rule.endDay);
+        if (low > high) {
+            first = last = 0;
+            return;
+        }
+        first = firstOnOrAfter(rule, low);
+        last = firstOnOrAfter(rule, high + 1);
+    }
+
+    // Total of every occurrence in [fromDay, toDay]: a count times an amount per rule
+    double total(int fromDay, int toDay) const {
+        double sum = 0;
+        forEachCount(fromDay, toDay, [&sum](const Rule& rule, long long count) { sum += count * rule.amount; });
+        return sum;
+    }
+
+    // Visits each rule with its number of occurrences in [fromDay, toDay], skipping rules with none
+    template <typename Visit>
+    void forEachCount(int fromDay, int toDay, Visit visit) const {
+        for (const Rule& rule : rules) {
+            long long first, last;
+            occurrenceRange(rule, fromDay, toDay, first, last);
+            if (last > first) {
+                visit(rule, last - first);
+            }
+        }
+    }
+
+    // Visits (rule, day number) for every occurrence in [fromDay, toDay] in the order of their
+    // (date, negated rule id) keys, merging the rules through a min-heap; nothing outside the
+    // window is generated
+    template <typename Visit>
+    void expand(int fromDay, int toDay, Visit visit) const {
+        expandWhile(fromDay, toDay, [&visit](const Rule& rule, int dayNumber) {
+            visit(rule, dayNumber);
+            return true;
+        });
+    }
+
+    // As expand, stopping as soon as visit returns false
+    template <typename Visit>
+    void expandWhile(int fromDay, int toDay, Visit visit) const {
+        struct Cursor {
+            long long dayNumber;
+            size_t rule;
+            long long index;
+            long long last;
+            bool operator>(const Cursor& other) const {
+                return dayNumber != other.dayNumber ? dayNumber > other.dayNumber : rule < other.rule; // newer rules first
+            }
+        };
+        priority_queue<Cursor, vector<Cursor>, greater<Cursor>> pending;
+        for (size_t i = 0; i < rules.size(); ++i) {
+            long long first, last;
+            occurrenceRange(rules[i], fromDay, toDay, first, last);
+            if (last > first) {
+                pending.push({occurrenceDay(rules[i], first), i, first, last});
+            }
+        }
+        while (!pending.empty()) {
+            Cursor cursor = pending.top();
+            pending.pop();
+            if (!visit(rules[cursor.rule], static_cast<int>(cursor.dayNumber))) {
+                return;
+            }
+            if (++cursor.index < cursor.last) {
+                cursor.dayNumber = occurrenceDay(rules[cursor.rule], cursor.index);
+                pending.push(cursor);
+            }
+        }
+    }
+
+    // An occurrence as a transient expense row; its id is the negated rule id
+    static DetailedExpense occurrence(const Rule& rule, int dayNumber) {
+        return DetailedExpense(-rule.id, rule.category, rule.amount, DateUtil::toString(dayNumber));
+    }
+
+    // "every 2 weeks", "every month"
+    static string describe(const Rule& rule) {
+        static const char* UNITS[] = {"day", "week", "month", "year"};
+        string unit = UNITS[static_cast<int>(rule.unit)];
+        return rule.interval == 1 ? "every " + unit : "every " + to_string(rule.interval) + " " + unit + "s";
+    }
+
+private:
+    vector<Rule> rules;
+    int lastRuleId = 0;
+
+    static long long stepDays(const Rule& rule) {
+        return rule.unit == RecurrenceUnit::Weeks ? 7LL * rule.interval : rule.interval;
+    }
+
+    static long long stepMonths(const Rule& rule) {
+        return rule.unit == RecurrenceUnit::Years ? 12LL * rule.interval : rule.interval;
+    }
+
+    // Smallest index whose occurrence is on or after dayNumber (dayNumber >= startDay)
+    static long long firstOnOrAfter(const Rule& rule, long long dayNumber) {
+        if (rule.unit == RecurrenceUnit::Days || rule.unit == RecurrenceUnit::Weeks) {
+            return (dayNumber - rule.startDay + stepDays(rule) - 1) / stepDays(rule);
+        }
+        // Month steps: estimate from the month difference, then correct by at most a step or two
+        int startYear, startMonth, startDate, year, month, day;
+        DateUtil::fromDayNumber(rule.startDay, startYear, startMonth, startDate);
+        DateUtil::fromDayNumber(static_cast<int>(dayNumber), year, month, day);
+        long long months = (year - startYear) * 12LL + month - startMonth;
+        long long index = max(0LL, months / stepMonths(rule));
+        while (index > 0 && occurrenceDay(rule, index - 1) >= dayNumber) {
+            --index;
+        }
+        while (occurrenceDay(rule, index) < dayNumber) {
+            ++index;
+        }
+        return index;
+    }
+};
+
+// An expense's values at one point in time
+struct ExpenseRow {
+    int id;
+    double amount;
+    string category;
+    string date;
+    uint64_t tags;
+    uint16_t currency;
+};
+
+struct BudgetSetting {
+    double amount;
+    BudgetPeriod period;
+    bool rollover;
+};
+
+// Fixed-width scalars in host byte order and strings as a 32-bit length and the bytes, for the
+// binary files of the expense store; the readers return false instead of reading past the end
+class ByteCodec {
+public:
+    template <typename T>
+    static void put(string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    static void putString(string& out, const string& text) {
+        put(out, static_cast<uint32_t>(text.size()));
+        out += text;
+    }
+
+    template <typename T>
+    static bool get(const char*& pos, const char* end, T& value) {
+        if (end - pos < static_cast<ptrdiff_t>(sizeof(T))) {
+            return false;
+        }
+        memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    static bool getString(const char*& pos, const char* end, string& text) {
+        uint32_t length;
+        if (!get(pos, end, length) || length > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        text.assign(pos, length);
+        pos += length;
+        return true;
+    }
+};
+
+// Timestamped history of a user's mutations with checkpoints of the full state, so the state at
+// any past instant is the nearest checkpoint before it plus the mutations logged after that.
+// A checkpoint is only taken once as many mutations as there are rows have been logged since the
+// previous one, so checkpoints cost O(1) amortized per mutation and a replay is never longer
+// than rebuilding the state from scratch
+class MutationLog {
+public:
+    static constexpr size_t MIN_CHECKPOINT_EVENTS = 1024;
+
+    struct State {
+        map<int, ExpenseRow> rows; // by id, which is insertion order
+        BudgetSetting budget;
+        vector<RecurringSchedule::Rule> rules;
+        uint16_t baseCurrency = CurrencyCode::BASE;
+        vector<CategoryBudgets::Setting> categoryBudgets;
+    };
+
+    // Milliseconds since the epoch
+    static long long now() {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // The starting state, e.g. a new account with its budget
+    void begin(State&& initial) {
+        clear();
+        bytes += stateBytes(initial);
+        checkpoints.push_back({stamp(), 0, std::move(initial)});
+    }
+
+    // Drops everything, e.g. once the log has been written to the store
+    void clear() {
+        events.clear();
+        events.shrink_to_fit();
+        checkpoints.clear();
+        checkpoints.shrink_to_fit();
+        bytes = 0;
+    }
+
+    // An added or changed expense, with its values after the change
+    void recordUpsert(const Expense& expense) {
+        Event event(stamp(), Event::Upsert);
+        event.row = {expense.getId(), expense.getAmount(), expense.getCategory(), expense.getDate(), expense.getTags(),
+                     expense.getCurrency()};
+        bytes += sizeof(Event) + rowBytes(event.row);
+        events.push_back(std::move(event));
+    }
+
+    void recordRemove(int id) {
+        Event event(stamp(), Event::Remove);
+        event.row.id = id;
+        bytes += sizeof(Event);
+        events.push_back(std::move(event));
+    }
+
+    void recordBudget(const BudgetSetting& budget) {
+        Event event(stamp(), Event::Budget);
+        event.budget = budget;
+        bytes += sizeof(Event);
+        events.push_back(std::move(event));
+    }
+
+    // Rule sets are small, so each change keeps the whole set
+    void recordRules(const vector<RecurringSchedule::Rule>& rules) {
+        Event event(stamp(), Event::Rules);
+        event.rules = make_shared<const vector<RecurringSchedule::Rule>>(rules);
+        bytes += sizeof(Event) + rulesBytes(rules);
+        events.push_back(std::move(event));
+    }
+
+    void recordBaseCurrency(uint16_t code) {
+        Event event(stamp(), Event::BaseCurrency);
+        event.row.currency = code;
+        bytes += sizeof(Event);
+        events.push_back(std::move(event));
+    }
+
+    // Like the rules, the whole set of category budgets is kept with each change
+    void recordCategoryBudgets(const vector<CategoryBudgets::Setting>& budgets) {
+        Event event(stamp(), Event::CategoryBudgetSet);
+        event.categoryBudgets = make_shared<const vector<CategoryBudgets::Setting>>(budgets);
+        bytes += sizeof(Event) + budgetsBytes(budgets);
+        events.push_back(std::move(event));
+    }
+
+    bool wantsCheckpoint(size_t rowCount) const {
+        return events.size() - checkpoints.back().eventIndex >= max(MIN_CHECKPOINT_EVENTS, rowCount);
+    }
+
+    // Due checkpoints are normally taken while the program is idle; past twice the spacing they
+    // are taken at once, so replays stay bounded when there is never any idle time
+    bool checkpointOverdue(size_t rowCount) const {
+        return events.size() - checkpoints.back().eventIndex >= 2 * max(MIN_CHECKPOINT_EVENTS, rowCount);
+    }
+
+    // state must reflect every mutation logged so far
+    void checkpoint(State&& state) {
+        bytes += stateBytes(state);
+        checkpoints.push_back({events.empty() ? stamp() : events.back().at, events.size(), std::move(state)});
+    }
+
+    // The state as of the instant at (inclusive)
+    State stateAt(long long at) const {
+        auto next = upper_bound(checkpoints.begin(), checkpoints.end(), at,
+                                [](long long instant, const Checkpoint& checkpoint) { return instant < checkpoint.at; });
+        const Checkpoint& base = next == checkpoints.begin() ? checkpoints.front() : *prev(next);
+        State state = base.state;
+        for (size_t i = base.eventIndex; i < events.size() && events[i].at <= at; ++i) {
+            const Event& event = events[i];
+            if (event.kind == Event::Upsert) {
+                state.rows[event.row.id] = event.row;
+            } else if (event.kind == Event::Remove) {
+                state.rows.erase(event.row.id);
+            } else if (event.kind == Event::Budget) {
+                state.budget = event.budget;
+            } else if (event.kind == Event::Rules) {
+                state.rules = *event.rules;
+            } else if (event.kind == Event::BaseCurrency) {
+                state.baseCurrency = event.row.currency;
+            } else {
+                state.categoryBudgets = *event.categoryBudgets;
+            }
+        }
+        return state;
+    }
+
+    long long firstInstant() const { return checkpoints.front().at; }
+    size_t size() const { return events.size(); }
+    size_t checkpointCount() const { return checkpoints.size(); }
+    bool empty() const { return checkpoints.empty(); }
+
+    // Rough heap footprint of the events and checkpoints, kept up to date as they are added
+    size_t memoryBytes() const { return bytes; }
+
+    /*
+        Binary form for the expense store: fixed-width little-endian scalars, strings as a
+        32-bit length and the bytes. Header "MLOG2", last instant, then the checkpoints (instant,
+        event index, state) and the events (instant, kind, then the row, id, budget, rule set,
+        base currency or category budget set).
+    */
+    void encode(string& out) const {
+        out.append(MAGIC, sizeof(MAGIC));
+        ByteCodec::put(out, lastInstant);
+        ByteCodec::put(out, static_cast<uint64_t>(checkpoints.size()));
+        for (const auto& checkpoint : checkpoints) {
+            ByteCodec::put(out, checkpoint.at);
+            ByteCodec::put(out, static_cast<uint64_t>(checkpoint.eventIndex));
+            putState(out, checkpoint.state);
+        }
+        ByteCodec::put(out, static_cast<uint64_t>(events.size()));
+        for (const auto& event : events) {
+            ByteCodec::put(out, event.at);
+            ByteCodec::put(out, static_cast<uint8_t>(event.kind));
+            if (event.kind == Event::Upsert) {
+                putRow(out, event.row);
+            } else if (event.kind == Event::Remove) {
+                ByteCodec::put(out, static_cast<int32_t>(event.row.id));
+            } else if (event.kind == Event::Budget) {
+                putBudget(out, event.budget);
+            } else if (event.kind == Event::Rules) {
+                putRules(out, *event.rules);
+            } else if (event.kind == Event::BaseCurrency) {
+                ByteCodec::put(out, event.row.currency);
+            } else {
+                putCategoryBudgets(out, *event.categoryBudgets);
+            }
+        }
+    }
+
+    // Replaces the log with an encoded one; false (and the log left empty) when it is corrupted
+    bool decode(const string& in) {
+        clear();
+        const char* pos = in.data();
+        const char* end = pos + in.size();
+        uint64_t checkpointCount, eventCount;
+        if (in.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        pos += sizeof(MAGIC);
+        if (!ByteCodec::get(pos, end, lastInstant) || !ByteCodec::get(pos, end, checkpointCount) || checkpointCount == 0) {
+            return false;
+        }
+        for (uint64_t i = 0; i < checkpointCount; ++i) {
+            Checkpoint checkpoint{0, 0, State()};
+            uint64_t eventIndex;
+            if (!ByteCodec::get(pos, end, checkpoint.at) || !ByteCodec::get(pos, end, eventIndex) || !getState(pos, end, checkpoint.state)) {
+                clear();
+                return false;
+            }
+            checkpoint.eventIndex = static_cast<size_t>(eventIndex);
+            bytes += stateBytes(checkpoint.state);
+            checkpoints.push_back(std::move(checkpoint));
+        }
+        if (!ByteCodec::get(pos, end, eventCount)) {
+            clear();
+            return false;
+        }
+        for (uint64_t i = 0; i < eventCount; ++i) {
+            long long at;
+            uint8_t kind;
+            if (!ByteCodec::get(pos, end, at) || !ByteCodec::get(pos, end, kind) || kind > Event::CategoryBudgetSet) {
+                clear();
+                return false;
+            }
+            Event event(at, static_cast<Event::Kind>(kind));
+            int32_t id = 0;
+            vector<RecurringSchedule::Rule> rules;
+            vector<CategoryBudgets::Setting> budgets;
+            bool ok = true;
+            if (event.kind == Event::Upsert) {
+                ok = getRow(pos, end, event.row);
+            } else if (event.kind == Event::Remove) {
+                ok = ByteCodec::get(pos, end, id);
+                event.row.id = id;
+            } else if (event.kind == Event::Budget) {
+                ok = getBudget(pos, end, event.budget);
+            } else if (event.kind == Event::Rules) {
+                ok = getRules(pos, end, rules);
+                event.rules = make_shared<const vector<RecurringSchedule::Rule>>(std::move(rules));
+            } else if (event.kind == Event::BaseCurrency) {
+                ok = ByteCodec::get(pos, end, event.row.currency) && event.row.currency < CurrencyCode::COUNT;
+            } else {
+                ok = getCategoryBudgets(pos, end, budgets);
+                event.categoryBudgets = make_shared<const vector<CategoryBudgets::Setting>>(std::move(budgets));
+            }
+            if (!ok) {
+                clear();
+                return false;
+            }
+            bytes += sizeof(Event) + rowBytes(event.row) + (event.rules ? rulesBytes(*event.rules) : 0)
+                   + (event.categoryBudgets ? budgetsBytes(*event.categoryBudgets) : 0);
+            events.push_back(std::move(event));
+        }
+        for (const auto& checkpoint : checkpoints) {
+            if (checkpoint.eventIndex > events.size()) {
+                clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr char MAGIC[5] = {'M', 'L', 'O', 'G', '2'};
+
+    struct Event {
+        enum Kind { Upsert, Remove, Budget, Rules, BaseCurrency, CategoryBudgetSet };
+
+        long long at;
+        Kind kind;
+        ExpenseRow row{0, 0, "", "", 0, CurrencyCode::BASE}; // the id of a Remove, the code of a BaseCurrency
+        BudgetSetting budget{0, BudgetPeriod::Monthly, false};
+        shared_ptr<const vector<RecurringSchedule::Rule>> rules;
+        shared_ptr<const vector<CategoryBudgets::Setting>> categoryBudgets;
+
+        Event(long long at, Kind kind) : at(at), kind(kind) {}
+    };
+
+    struct Checkpoint {
+        long long at;      // instant of the last mutation it includes
+        size_t eventIndex; // mutations before this index are included
+        State state;
+    };
+
+    vector<Event> events;
+    vector<Checkpoint> checkpoints; // ordered by time
+    long long lastInstant = 0;
+    size_t bytes = 0;
+
+    static size_t rowBytes(const ExpenseRow& row) { return row.category.capacity() + row.date.capacity(); }
+
+    static size_t rulesBytes(const vector<RecurringSchedule::Rule>& rules) {
+        size_t total = rules.capacity() * sizeof(RecurringSchedule::Rule);
+        for (const auto& rule : rules) {
+            total += rule.category.capacity();
+        }
+        return total;
+    }
+
+    static size_t budgetsBytes(const vector<CategoryBudgets::Setting>& budgets) {
+        size_t total = budgets.capacity() * sizeof(CategoryBudgets::Setting);
+        for (const auto& budget : budgets) {
+            total += budget.path.capacity();
+        }
+        return total;
+    }
+
+    // map node: the entry plus three pointers and a color word
+    static size_t stateBytes(const State& state) {
+        size_t total = sizeof(Checkpoint) + rulesBytes(state.rules) + budgetsBytes(state.categoryBudgets);
+        for (const auto& entry : state.rows) {
+            total += sizeof(pair<const int, ExpenseRow>) + 4 * sizeof(void*) + rowBytes(entry.second);
+        }
+        return total;
+    }
+
+    static void putRow(string& out, const ExpenseRow& row) {
+        ByteCodec::put(out, static_cast<int32_t>(row.id));
+        ByteCodec::put(out, row.amount);
+        ByteCodec::putString(out, row.category);
+        ByteCodec::putString(out, row.date);
+        ByteCodec::put(out, row.tags);
+        ByteCodec::put(out, row.currency);
+    }
+
+    static void putBudget(string& out, const BudgetSetting& budget) {
+        ByteCodec::put(out, budget.amount);
+        ByteCodec::put(out, static_cast<uint8_t>(budget.period));
+        ByteCodec::put(out, static_cast<uint8_t>(budget.rollover));
+    }
+
+    static void putRules(string& out, const vector<RecurringSchedule::Rule>& rules) {
+        ByteCodec::put(out, static_cast<uint32_t>(rules.size()));
+        for (const auto& rule : rules) {
+            ByteCodec::put(out, static_cast<int32_t>(rule.id));
+            ByteCodec::put(out, rule.amount);
+            ByteCodec::putString(out, rule.category);
+            ByteCodec::put(out, static_cast<int32_t>(rule.startDay));
+            ByteCodec::put(out, static_cast<int32_t>(rule.endDay));
+            ByteCodec::put(out, static_cast<uint8_t>(rule.unit));
+            ByteCodec::put(out, static_cast<int32_t>(rule.interval));
+        }
+    }
+
+    static void putCategoryBudgets(string& out, const vector<CategoryBudgets::Setting>& budgets) {
+        ByteCodec::put(out, static_cast<uint32_t>(budgets.size()));
+        for (const auto& budget : budgets) {
+            ByteCodec::putString(out, budget.path);
+            ByteCodec::put(out, budget.limit);
+            ByteCodec::put(out, static_cast<uint8_t>(budget.period));
+        }
+    }
+
+    static void putState(string& out, const State& state) {
+        putBudget(out, state.budget);
+        putRules(out, state.rules);
+        ByteCodec::put(out, state.baseCurrency);
+        putCategoryBudgets(out, state.categoryBudgets);
+        ByteCodec::put(out, static_cast<uint64_t>(state.rows.size()));
+        for (const auto& entry : state.rows) {
+            putRow(out, entry.second);
+        }
+    }
+
+    static bool getRow(const char*& pos, const char* end, ExpenseRow& row) {
+        int32_t id;
+        if (!ByteCodec::get(pos, end, id) || !ByteCodec::get(pos, end, row.amount) || !ByteCodec::getString(pos, end, row.category)
+            || !ByteCodec::getString(pos, end, row.date) || !ByteCodec::get(pos, end, row.tags) || !ByteCodec::get(pos, end, row.currency)) {
+            return false;
+        }
+        row.id = id;
+        return row.currency < CurrencyCode::COUNT;
+    }
+
+    static bool getBudget(const char*& pos, const char* end, BudgetSetting& budget) {
+        uint8_t period, rollover;
+        if (!ByteCodec::get(pos, end, budget.amount) || !ByteCodec::get(pos, end, period) || !ByteCodec::get(pos, end, rollover)
+            || period > static_cast<uint8_t>(BudgetPeriod::Yearly)) {
+            return false;
+        }
+        budget.period = static_cast<BudgetPeriod>(period);
+        budget.rollover = rollover != 0;
+        return true;
+    }
+
+    static bool getRules(const char*& pos, const char* end, vector<RecurringSchedule::Rule>& rules) {
+        uint32_t count;
+        if (!ByteCodec::get(pos, end, count) || count > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        rules.resize(count);
+        for (auto& rule : rules) {
+            int32_t id, startDay, endDay, interval;
+            uint8_t unit;
+            if (!ByteCodec::get(pos, end, id) || !ByteCodec::get(pos, end, rule.amount) || !ByteCodec::getString(pos, end, rule.category)
+                || !ByteCodec::get(pos, end, startDay) || !ByteCodec::get(pos, end, endDay) || !ByteCodec::get(pos, end, unit)
+                || !ByteCodec::get(pos, end, interval) || unit > static_cast<uint8_t>(RecurrenceUnit::Years)) {
+                return false;
+            }
+            rule.id = id;
+            rule.startDay = startDay;
+            rule.endDay = endDay;
+            rule.unit = static_cast<RecurrenceUnit>(unit);
+            rule.interval = interval;
+        }
+        return true;
+    }
+
+    static bool getCategoryBudgets(const char*& pos, const char* end, vector<CategoryBudgets::Setting>& budgets) {
+        uint32_t count;
+        if (!ByteCodec::get(pos, end, count) || count > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        budgets.resize(count);
+        for (auto& budget : budgets) {
+            uint8_t period;
+            if (!ByteCodec::getString(pos, end, budget.path) || !ByteCodec::get(pos, end, budget.limit)
+                || !ByteCodec::get(pos, end, period) || period > static_cast<uint8_t>(BudgetPeriod::Yearly)) {
+                return false;
+            }
+            budget.period = static_cast<BudgetPeriod>(period);
+        }
+        return true;
+    }
+
+    static bool getState(const char*& pos, const char* end, State& state) {
+        uint64_t rowCount;
+        if (!getBudget(pos, end, state.budget) || !getRules(pos, end, state.rules) || !ByteCodec::get(pos, end, state.baseCurrency)
+            || state.baseCurrency >= CurrencyCode::COUNT || !getCategoryBudgets(pos, end, state.categoryBudgets)
+            || !ByteCodec::get(pos, end, rowCount) || rowCount > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < rowCount; ++i) {
+            ExpenseRow row{0, 0, "", "", 0, CurrencyCode::BASE};
+            if (!getRow(pos, end, row)) {
+                return false;
+            }
+            state.rows.emplace_hint(state.rows.end(), row.id, std::move(row));
+        }
+        return true;
+    }
+
+    // Never earlier than the previous mutation, even if the clock is set back
+    long long stamp() {
+        lastInstant = max(lastInstant, now());
+        return lastInstant;
+    }
+};
+
+class User {
+private:
+    // Result of a background compaction: the live rows of a snapshot packed to the front,
+    // their new slots, and enough of the snapshot to translate an old slot into a new one
+    struct Compaction {
+        vector<shared_ptr<Expense>> rows;
+        unordered_map<int, size_t> slotById;
+        vector<uint64_t> live;     // snapshot live bits
+        vector<size_t> rankBase;   // live rows before each snapshot word
+        size_t snapshotSlots = 0;
+        vector<uint64_t> tags;     // tag bits of each packed row as of the snapshot
+        vector<TagBitmap> tagIndex;
+
+        size_t newSlot(size_t oldSlot) const {
+            uint64_t below = live[oldSlot / 64] & ((uint64_t(1) << (oldSlot % 64)) - 1);
+            return rankBase[oldSlot / 64] + BitUtil::bitCount(below);
+        }
+    };
+
+    static constexpr double COMPACT_DEAD_FRACTION = 0.25; // compact once a quarter of the slots are dead
+    static constexpr size_t COMPACT_MIN_DEAD = 1024;       // ...and there is enough to be worth a pass
+
+    string username;
+    string password;
+    vector<shared_ptr<Expense>> expenses; // slots; removed rows stay behind as tombstones until compaction
+    vector<uint64_t> liveRows;            // bit i is set while slot i holds a live expense
+    unordered_map<int, size_t> slotById;
+    size_t liveCount = 0;
+    future<Compaction> pendingCompaction;
+    vector<size_t> killedDuringCompaction; // slots removed while the compaction was running
+    vector<size_t> retaggedDuringCompaction;
+    TagDictionary tagDictionary;
+    vector<TagBitmap> tagIndex; // per tag id, the slots of the expenses carrying it
+    BudgetLedger budget;        // kept while the history is cold; it is small and cannot change then
+    bool historyLoaded; // false while the expense history lives only in the store
+    DailySpendIndex spendIndex;
+    CategoryStatsIndex categoryStats;
+    set<pair<int, int>> dateIndex; // (day number, id) of every dated expense, for keyset paging
+    CategoryMoments amountMoments;
+    CategorySearchIndex categoryNames; // categories of the expenses and recurring rules
+    map<int, ExpenseAnomaly> anomalies; // by expense id; kept while the history is cold
+    ExpenseFingerprints fingerprints;   // (date, amount, currency, category) of the dated expenses
+    CategoryBudgets categoryBudgets;
+    SpendForecast forecast; // current budget period only, re-seeded from spendIndex when it changes
+    RecurringSchedule recurring; // rules only; occurrences are never stored
+    vector<string> budgetAlerts; // raised by mutations, shown by the UI
+    int lastExpenseId = 0;
+    unsigned long long version = 0; // bumped by every mutation of expenses or budget
+    mutable ResultCache resultCache;
+    MutationLog mutations;  // for as-of queries; written to the store with the history when it goes cold
+    bool recording = true;  // off for the read-only copies made by asOf
+    int asOfDay = numeric_limits<int>::max(); // an asOf copy's day: its rates and due recurring expenses stop there
+    uint16_t baseCurrency = CurrencyCode::BASE; // every index and budget is kept in this currency
+    unsigned long long ratesVersion = 0;        // FxRates version the indexes were converted with
+
+    void bumpVersion() {
+        version++;
+        resultCache.invalidate();
+        if (!recurring.empty()) {
+            categoryBudgets.touchAll(DateUtil::today()); // occurrences come due without a mutation
+        }
+        categoryBudgets.collectAlerts(budgetAlerts, recurringSpend());
+        if (recording && mutations.checkpointOverdue(liveCount)) {
+            mutations.checkpoint(captureState());
+        }
+    }
+
+    // Recurring occurrences due by today under a category budget's path
+    CategoryBudgets::ExtraSpend recurringSpend() const {
+        return [this](const vector<string>& path, int periodStart, int periodEnd) {
+            double due = 0;
+            forEachRecurringCount(periodStart, periodEnd, [&](const RecurringSchedule::Rule& rule, long long count) {
+                vector<string> parts = CategoryBudgets::splitPath(rule.category);
+                if (parts.size() >= path.size() && equal(path.begin(), path.end(), parts.begin())) {
+                    due += count * rule.amount;
+                }
+            });
+            return due;
+        };
+    }
+
+    void logUpsert(const Expense& expense) {
+        if (recording) {
+            mutations.recordUpsert(expense);
+        }
+    }
+
+    void logBudget() {
+        if (recording) {
+            mutations.recordBudget({budget.getAmount(), budget.getPeriod(), budget.hasRollover()});
+        }
+    }
+
+    void logCategoryBudgets() {
+        if (recording) {
+            mutations.recordCategoryBudgets(categoryBudgets.settings());
+        }
+    }
+
+    // Last day whose recurring occurrences are due, and whose exchange rates are known
+    int lastDueDay() const { return min(asOfDay, DateUtil::today()); }
+
+    MutationLog::State captureState() const {
+        MutationLog::State state;
+        forEachExpense([&state](const shared_ptr<Expense>& expense) {
+            state.rows.emplace_hint(state.rows.end(), expense->getId(),
+                                    ExpenseRow{expense->getId(), expense->getAmount(), expense->getCategory(),
+                                               expense->getDate(), expense->getTags(), expense->getCurrency()});
+        });
+        state.budget = {budget.getAmount(), budget.getPeriod(), budget.hasRollover()};
+        state.rules = recurring.getRules();
+        state.baseCurrency = baseCurrency;
+        state.categoryBudgets = categoryBudgets.settings();
+        return state;
+    }
+
+    // Adds (sign = 1) or withdraws (sign = -1) an expense from the derived indexes; amount is
+    // the expense converted to the base currency
+    void indexExpense(const Expense& expense, int sign, double amount) {
+        amountMoments.add(expense.getCategory(), amount, sign);
+        categoryNames.add(expense.getCategory(), sign);
+        int dayNumber;
+        if (DateUtil::toDayNumber(expense.getDate(), dayNumber)) {
+            spendIndex.add(dayNumber, sign * amount);
+            if (sign > 0) {
+                dateIndex.emplace(dayNumber, expense.getId());
+            } else {
+                dateIndex.erase({dayNumber, expense.getId()});
+            }
+            categoryStats.add(expense.getCategory(), dayNumber, amount, sign);
+            categoryBudgets.add(expense.getCategory(), dayNumber, sign * amount);
+            budget.add(dayNumber, sign * amount);
+            forecast.add(dayNumber, sign * amount);
+            fingerprints.add(fingerprintOf(expense, dayNumber), sign);
+        }
+    }
+
+    static uint64_t fingerprintOf(const Expense& expense, int dayNumber) {
+        return ExpenseFingerprints::fingerprint(dayNumber, expense.getAmount(), expense.getCurrency(), expense.getCategory());
+    }
+
+    void indexExpense(const Expense& expense, int sign) {
+        indexExpense(expense, sign, toBase(expense));
+    }
+
+    // Scores an expense against its category before it joins the statistics, O(1)
+    void screenExpense(const Expense& expense, double amount) {
+        ExpenseAnomaly anomaly;
+        if (amountMoments.score(expense.getCategory(), amount, anomaly.zScore, anomaly.categoryMean)
+            && anomaly.zScore >= CategoryMoments::Z_THRESHOLD) {
+            anomalies[expense.getId()] = anomaly;
+        } else {
+            anomalies.erase(expense.getId());
+        }
+    }
+
+    void rebuildIndexes() {
+        spendIndex.clear();
+        categoryStats.clear();
+        dateIndex.clear();
+        fingerprints.clear();
+        forecast.clear();
+        amountMoments.clear();
+        categoryNames.clear();
+        for (const auto& rule : recurring.getRules()) {
+            categoryNames.add(rule.category, 1);
+        }
+        categoryBudgets.clearSpend();
+        budget.clear();
+        vector<shared_ptr<Expense>> rows = liveExpenses();
+        vector<double> amounts = toBase(rows);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            lastExpenseId = max(lastExpenseId, rows[i]->getId());
+            indexExpense(*rows[i], 1, amounts[i]);
+        }
+        ratesVersion = FxRates::getInstance()->getVersion();
+        categoryBudgets.discardChanges(); // reloading is not new spending
+    }
+
+    static void indexTags(vector<TagBitmap>& index, size_t slot, uint64_t tags, bool add) {
+        for (; tags; tags &= tags - 1) {
+            size_t tag = BitUtil::lowestBit(tags);
+            if (add) {
+                if (tag >= index.size()) {
+                    index.resize(tag + 1);
+                }
+                index[tag].add(slot);
+            } else if (tag < index.size()) {
+                index[tag].remove(slot);
+            }
+        }
+    }
+
+    void setLive(size_t slot) {
+        if (slot / 64 >= liveRows.size()) {
+            liveRows.resize(slot / 64 + 1, 0);
+        }
+        liveRows[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+
+    void killSlot(size_t slot) {
+        liveRows[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        indexTags(tagIndex, slot, expenses[slot]->getTags(), false);
+        slotById.erase(expenses[slot]->getId());
+        expenses[slot].reset();
+        liveCount--;
+        if (pendingCompaction.valid()) {
+            killedDuringCompaction.push_back(slot);
+        }
+    }
+
+    void appendSlot(shared_ptr<Expense> expense) {
+        size_t slot = expenses.size();
+        setLive(slot);
+        indexTags(tagIndex, slot, expense->getTags(), true);
+        slotById[expense->getId()] = slot;
+        expenses.push_back(std::move(expense));
+        liveCount++;
+    }
+
+    // Every slot of the vector is live (fresh history or a finished compaction)
+    void resetLayout(unordered_map<int, size_t>&& slots) {
+        liveCount = expenses.size();
+        liveRows.assign((liveCount + 63) / 64, ~uint64_t(0));
+        if (liveCount % 64) {
+            liveRows.back() = (uint64_t(1) << (liveCount % 64)) - 1;
+        }
+        slotById = std::move(slots);
+        tagIndex.clear();
+        for (size_t slot = 0; slot < expenses.size(); ++slot) {
+            indexTags(tagIndex, slot, expenses[slot]->getTags(), true);
+        }
+    }
+
+    static unordered_map<int, size_t> mapSlots(const vector<shared_ptr<Expense>>& rows) {
+        unordered_map<int, size_t> slots;
+        slots.reserve(rows.size());
+        for (size_t slot = 0; slot < rows.size(); ++slot) {
+            slots[rows[slot]->getId()] = slot;
+        }
+        return slots;
+    }
+
+    // Starts packing the live rows on a worker thread once enough slots are dead; the work
+    // runs on a snapshot so adds and removes can carry on meanwhile
+    void maybeCompact() {
+        size_t dead = expenses.size() - liveCount;
+        if (pendingCompaction.valid() || dead < COMPACT_MIN_DEAD
+            || dead < COMPACT_DEAD_FRACTION * expenses.size()) {
+            return;
+        }
+        killedDuringCompaction.clear();
+        retaggedDuringCompaction.clear();
+        vector<uint64_t> tags(expenses.size()); // read here; tags may change while the worker runs
+        for (size_t slot = 0; slot < expenses.size(); ++slot) {
+            tags[slot] = expenses[slot] ? expenses[slot]->getTags() : 0;
+        }
+        pendingCompaction = async(launch::async, [rows = expenses, live = liveRows, tags = std::move(tags)]() {
+            Compaction packed;
+            packed.snapshotSlots = rows.size();
+            packed.rankBase.reserve(live.size());
+            for (size_t word = 0; word < live.size(); ++word) {
+                packed.rankBase.push_back(packed.rows.size());
+                for (uint64_t bits = live[word]; bits; bits &= bits - 1) {
+                    size_t slot = word * 64 + BitUtil::lowestBit(bits);
+                    indexTags(packed.tagIndex, packed.rows.size(), tags[slot], true);
+                    packed.tags.push_back(tags[slot]);
+                    packed.rows.push_back(rows[slot]);
+                }
+            }
+            packed.slotById = mapSlots(packed.rows);
+            packed.live = std::move(live);
+            return packed;
+        });
+    }
+
+    // Swaps in a finished compaction, replaying the removes and appends made since its snapshot
+    void collectCompaction(bool wait) {
+        if (!pendingCompaction.valid()
+            || (!wait && pendingCompaction.wait_for(chrono::seconds(0)) != future_status::ready)) {
+            return;
+        }
+        Compaction packed = pendingCompaction.get();
+        vector<uint64_t> live((packed.rows.size() + 63) / 64, ~uint64_t(0));
+        if (packed.rows.size() % 64) {
+            live.back() = (uint64_t(1) << (packed.rows.size() % 64)) - 1;
+        }
+        for (size_t oldSlot : retaggedDuringCompaction) {
+            if (oldSlot < packed.snapshotSlots && expenses[oldSlot]) {
+                size_t slot = packed.newSlot(oldSlot);
+                indexTags(packed.tagIndex, slot, packed.tags[slot], false);
+                packed.tags[slot] = expenses[oldSlot]->getTags();
+                indexTags(packed.tagIndex, slot, packed.tags[slot], true);
+            }
+        }
+        retaggedDuringCompaction.clear();
+        for (size_t oldSlot : killedDuringCompaction) {
+            if (oldSlot < packed.snapshotSlots) {
+                size_t slot = packed.newSlot(oldSlot);
+                live[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+                indexTags(packed.tagIndex, slot, packed.tags[slot], false);
+                packed.slotById.erase(packed.rows[slot]->getId());
+                packed.rows[slot].reset();
+            }
+        }
+        killedDuringCompaction.clear();
+        liveRows = std::move(live);
+        for (size_t oldSlot = packed.snapshotSlots; oldSlot < expenses.size(); ++oldSlot) {
+            if (expenses[oldSlot]) {
+                setLive(packed.rows.size());
+                indexTags(packed.tagIndex, packed.rows.size(), expenses[oldSlot]->getTags(), true);
+                packed.slotById[expenses[oldSlot]->getId()] = packed.rows.size();
+                packed.rows.push_back(std::move(expenses[oldSlot]));
+            }
+        }
+        expenses = std::move(packed.rows);
+        slotById = std::move(packed.slotById);
+        tagIndex = std::move(packed.tagIndex);
+    }
+
+public:
+    User(const string& username, const string& password, double budgetAmount)
+        : username(username), password(password), historyLoaded(true) {
+        budget.configure(budgetAmount, BudgetPeriod::Monthly, false);
+        mutations.begin(captureState());
+    }
+
+    string getUsername() const { return username; }
+    bool verifyPassword(const string& inputPassword) const { return password == inputPassword; }
+    // Budget amount per period
+    void setBudget(double newBudget) {budget.configure(newBudget, budget.getPeriod(), budget.hasRollover()); logBudget(); bumpVersion();}
+    double getBudget() const { return budget.getAmount(); }
+    BudgetPeriod getBudgetPeriod() const { return budget.getPeriod(); }
+    bool hasBudgetRollover() const { return budget.hasRollover(); }
+
+    // A new period length regroups the ledger, which takes one pass over the history
+    void setBudgetPeriod(BudgetPeriod period, bool rollover) {
+        bool regroup = period != budget.getPeriod();
+        budget.configure(budget.getAmount(), period, rollover);
+        if (regroup) {
+            budget.clear();
+            forEachExpense([this](const shared_ptr<Expense>& expense) {
+                int dayNumber;
+                if (DateUtil::toDayNumber(expense->getDate(), dayNumber)) {
+                    budget.add(dayNumber, toBase(*expense));
+                }
+            });
+        }
+        logBudget();
+        bumpVersion();
+    }
+
+    // The ledger's figures for the period holding dayNumber plus the recurring occurrences due in it
+    // by dayNumber. Carries from earlier periods are settled from entered expenses only
+    BudgetLedger::PeriodSummary getBudgetSummary(int dayNumber) const {
+        BudgetLedger::PeriodSummary summary = budget.summary(dayNumber);
+        summary.spent += recurring.total(summary.start, dayNumber);
+        return summary;
+    }
+
+    // Entered expenses only; recurring occurrences are left out of every period
+    vector<BudgetLedger::PeriodSummary> getBudgetHistory(int dayNumber) const { return budget.history(dayNumber); }
+
+    // Projected spend and run-out day of the budget period holding today
+    SpendForecast::Projection getForecast(int today) {
+        int start = DateUtil::periodStart(budget.getPeriod(), today);
+        int end = DateUtil::periodEnd(budget.getPeriod(), today);
+        if (!forecast.covers(start, end)) {
+            forecast.reset(start, end, today, [this](int dayNumber) { return spendIndex.total(dayNumber, dayNumber); });
+        }
+        forecast.advance(today);
+        BudgetLedger::PeriodSummary current = getBudgetSummary(today);
+        return forecast.project(current.spent, current.budget + current.carriedIn);
+    }
+
+    // What is left of the budget of the period holding dayNumber, carry and due recurring expenses included
+    double getRemainingBudget(int dayNumber) const { return getBudgetSummary(dayNumber).remaining(); }
+
+    // Budgets, totals and statistics are all kept in the base currency; CurrencyCode::BASE
+    // leaves it unnamed, which is the reference currency of the rate table
+    uint16_t getBaseCurrency() const { return baseCurrency; }
+
+    // Every stored amount is re-converted, which takes one pass over the history
+    void setBaseCurrency(uint16_t code) {
+        baseCurrency = code;
+        if (recording) {
+            mutations.recordBaseCurrency(code);
+        }
+        if (historyLoaded) {
+            rebuildIndexes();
+        }
+        bumpVersion();
+    }
+
+    // Last quote date the conversions may use; an asOf copy never sees quotes dated after its day
+    int ratesQuotedBy() const { return asOfDay; }
+
+    // An expense's amount in the base currency at the rate of its own date
+    double toBase(const Expense& expense) const {
+        int dayNumber = 0;
+        DateUtil::toDayNumber(expense.getDate(), dayNumber);
+        return expense.getAmount() * FxRates::getInstance()->factor(expense.getCurrency(), baseCurrency, dayNumber, asOfDay);
+    }
+
+    // Converts a batch of expenses to the base currency with one pass over the rate table
+    vector<double> toBase(const vector<shared_ptr<Expense>>& rows) const {
+        vector<double> amounts(rows.size());
+        vector<uint16_t> codes(rows.size());
+        vector<int> days(rows.size(), 0);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            amounts[i] = rows[i]->getAmount();
+            codes[i] = rows[i]->getCurrency();
+            DateUtil::toDayNumber(rows[i]->getDate(), days[i]);
+        }
+        FxRates::getInstance()->toBase(baseCurrency, rows.size(), amounts.data(), codes.data(), days.data(), amounts.data(), asOfDay);
+        return amounts;
+    }
+
+    // One unit of deferred work, run while the program waits for input; false when there was none
+    bool runMaintenance() {
+        if (pendingCompaction.valid() && pendingCompaction.wait_for(chrono::seconds(0)) == future_status::ready) {
+            collectCompaction(false);
+            return true;
+        }
+        if (recording && mutations.wantsCheckpoint(liveCount)) {
+            mutations.checkpoint(captureState());
+            return true;
+        }
+        return syncRates();
+    }
+
+    // Whether the indexes were converted with the rate table now loaded
+    bool hasCurrentRates() const { return ratesVersion == FxRates::getInstance()->getVersion(); }
+
+    // Re-converts the indexes after a new rate table was loaded; false when they were current
+    bool syncRates() {
+        if (!historyLoaded || ratesVersion == FxRates::getInstance()->getVersion()) {
+            return false;
+        }
+        rebuildIndexes();
+        bumpVersion();
+        return true;
+    }
+
+    // Visits the live expenses in insertion order; dead slots are skipped a 64-bit word at a time
+    template <typename Visit>
+    void forEachExpense(Visit visit) const {
+        for (size_t word = 0; word < liveRows.size(); ++word) {
+            for (uint64_t bits = liveRows[word]; bits; bits &= bits - 1) {
+                visit(expenses[word * 64 + BitUtil::lowestBit(bits)]);
+            }
+        }
+    }
+
+    // Visits the live expenses whose tags satisfy the query; the query runs over the per-tag
+    // bitmaps a chunk at a time and is masked with the live rows word by word
+    template <typename Visit>
+    void forEachTagged(const TagQuery& query, Visit visit) const {
+        vector<uint64_t> matches;
+        for (size_t chunk = 0; chunk * TagBitmap::CHUNK_BITS < expenses.size(); ++chunk) {
+            query.evaluate(tagIndex, chunk, matches);
+            size_t firstWord = chunk * TagBitmap::CHUNK_WORDS;
+            size_t lastWord = min(liveRows.size(), firstWord + TagBitmap::CHUNK_WORDS);
+            for (size_t word = firstWord; word < lastWord; ++word) {
+                for (uint64_t bits = matches[word - firstWord] & liveRows[word]; bits; bits &= bits - 1) {
+                    visit(expenses[word * 64 + BitUtil::lowestBit(bits)]);
+                }
+            }
+        }
+    }
+
+    const TagDictionary& getTagDictionary() const { return tagDictionary; }
+    int internTag(const string& name) { return tagDictionary.intern(name); }
+
+    void setExpenseTags(Expense& expense, uint64_t tags) {
+        auto found = slotById.find(expense.getId());
+        if (found == slotById.end()) {
+            return;
+        }
+        indexTags(tagIndex, found->second, expense.getTags(), false);
+        expense.setTags(tags);
+        indexTags(tagIndex, found->second, tags, true);
+        if (pendingCompaction.valid()) {
+            retaggedDuringCompaction.push_back(found->second);
+        }
+        logUpsert(expense);
+        bumpVersion();
+    }
+
+    size_t getExpenseCount() const { return liveCount; }
+    bool hasExpenses() const { return liveCount > 0; }
+
+    shared_ptr<Expense> findExpense(int id) const {
+        auto found = slotById.find(id);
+        return found == slotById.end() ? nullptr : expenses[found->second];
+    }
+
+    // Copy of the live rows, e.g. for saving
+    vector<shared_ptr<Expense>> liveExpenses() const {
+        vector<shared_ptr<Expense>> rows;
+        rows.reserve(liveCount);
+        forEachExpense([&rows](const shared_ptr<Expense>& expense) { rows.push_back(expense); });
+        return rows;
+    }
+
+    void addExpense(shared_ptr<Expense> expense) {
+        collectCompaction(false);
+        lastExpenseId = max(lastExpenseId, expense->getId());
+        double amount = toBase(*expense);
+        screenExpense(*expense, amount);
+        indexExpense(*expense, 1, amount);
+        logUpsert(*expense);
+        appendSlot(std::move(expense));
+        bumpVersion();
+    }
+
+    // Appends a batch with a single version bump (bulk import)
+    void addExpenses(vector<shared_ptr<Expense>>&& batch) {
+        collectCompaction(false);
+        expenses.reserve(expenses.size() + batch.size());
+        slotById.reserve(slotById.size() + batch.size());
+        vector<double> amounts = toBase(batch);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            shared_ptr<Expense>& expense = batch[i];
+            lastExpenseId = max(lastExpenseId, expense->getId());
+            screenExpense(*expense, amounts[i]);
+            indexExpense(*expense, 1, amounts[i]);
+            logUpsert(*expense);
+            appendSlot(std::move(expense));
+        }
+        bumpVersion();
+    }
+
+    // Ids are never reused, even after removals
+    int nextExpenseId() const { return lastExpenseId + 1; }
+
+    // Mutations go through the user so the derived indexes stay in step
+    void modifyExpense(Expense& expense, double newAmount, uint16_t newCurrency, const string& newCategory,
+                       const string& newDate) {
+        indexExpense(expense, -1);
+        expense.setAmount(newAmount);
+        expense.setCurrency(newCurrency);
+        expense.setCategory(newCategory);
+        expense.setDate(newDate);
+        double amount = toBase(expense);
+        screenExpense(expense, amount);
+        indexExpense(expense, 1, amount);
+        logUpsert(expense);
+        bumpVersion();
+    }
+
+    // O(1): the slot is only marked dead, compaction reclaims it later
+    bool removeExpense(int id) {
+        collectCompaction(false);
+        auto found = slotById.find(id);
+        if (found == slotById.end()) {
+            return false;
+        }
+        indexExpense(*expenses[found->second], -1);
+        anomalies.erase(id);
+        if (recording) {
+            mutations.recordRemove(id);
+        }
+        killSlot(found->second);
+        bumpVersion();
+        maybeCompact();
+        return true;
+    }
+
+    // What an AdjustAmount batch would do, worked out before anything changes
+    struct BulkAdjustment {
+        size_t rows = 0;
+        size_t nonPositive = 0; // rows whose amount would drop to zero or below
+        double addedSpend = 0;  // increase in base currency, for the budget check
+    };
+
+    BulkAdjustment previewAdjustment(const ExpenseFilter& filter, double amountDelta) const {
+        BulkAdjustment preview;
+        forEachExpense([&](const shared_ptr<Expense>& expense) {
+            if (!filter.matches(*expense)) {
+                return;
+            }
+            preview.rows++;
+            if (expense->getAmount() + amountDelta <= 0) {
+                preview.nonPositive++;
+            }
+            int dayNumber = 0;
+            DateUtil::toDayNumber(expense->getDate(), dayNumber);
+            preview.addedSpend += amountDelta * FxRates::getInstance()->factor(expense->getCurrency(), baseCurrency, dayNumber, asOfDay);
+        });
+        return preview;
+    }
+
+    // Applies one action to every live expense matching the filter in a single pass;
+    // the version bump, cache invalidation and compaction check happen once for the batch
+    size_t bulkEdit(const ExpenseFilter& filter, BulkAction action, const string& newCategory, double amountDelta) {
+        collectCompaction(false);
+        size_t affected = 0;
+        for (size_t word = 0; word < liveRows.size(); ++word) {
+            for (uint64_t bits = liveRows[word]; bits; bits &= bits - 1) {
+                size_t slot = word * 64 + BitUtil::lowestBit(bits);
+                Expense& expense = *expenses[slot];
+                if (!filter.matches(expense)) {
+                    continue;
+                }
+                indexExpense(expense, -1);
+                if (action == BulkAction::Delete) {
+                    anomalies.erase(expense.getId());
+                    if (recording) {
+                        mutations.recordRemove(expense.getId());
+                    }
+                    killSlot(slot);
+                } else {
+                    if (action == BulkAction::SetCategory) {
+                        expense.setCategory(newCategory);
+                    } else {
+                        expense.setAmount(expense.getAmount() + amountDelta);
+                    }
+                    double amount = toBase(expense);
+                    screenExpense(expense, amount);
+                    indexExpense(expense, 1, amount);
+                    logUpsert(expense);
+                }
+                affected++;
+            }
+        }
+        if (affected > 0) {
+            bumpVersion();
+            maybeCompact();
+        }
+        return affected;
+    }
+
+    // Total spent between two day numbers (inclusive) in O(log days), plus the recurring
+    // expenses already due in that window, counted per rule in O(1)
+    double getSpendBetween(int fromDay, int toDay) const {
+        return spendIndex.total(fromDay, toDay) + recurring.total(fromDay, min(toDay, lastDueDay()));
+    }
+
+    // Recurring expenses show in views, report totals and the current period's budgets once due
+    int addRecurring(double amount, const string& category, int startDay, int endDay, RecurrenceUnit unit, int interval) {
+        int id = recurring.add(amount, category, startDay, endDay, unit, interval);
+        categoryNames.add(category, 1);
+        if (recording) {
+            mutations.recordRules(recurring.getRules());
+        }
+        bumpVersion();
+        return id;
+    }
+
+    bool removeRecurring(int id) {
+        auto rule = find_if(recurring.getRules().begin(), recurring.getRules().end(),
+                            [id](const RecurringSchedule::Rule& candidate) { return candidate.id == id; });
+        if (rule == recurring.getRules().end()) {
+            return false;
+        }
+        categoryNames.add(rule->category, -1);
+        recurring.remove(id);
+        if (recording) {
+            mutations.recordRules(recurring.getRules());
+        }
+        bumpVersion();
+        return true;
+    }
+
+    const RecurringSchedule& getRecurring() const { return recurring; }
+    bool hasRecurring() const { return !recurring.empty(); }
+
+    // Recurring occurrences due in [fromDay, toDay], in date order
+    template <typename Visit>
+    void forEachOccurrence(int fromDay, int toDay, Visit visit) const {
+        recurring.expand(fromDay, min(toDay, lastDueDay()), visit);
+    }
+
+    // Each recurring rule with its number of occurrences due in [fromDay, toDay]
+    template <typename Visit>
+    void forEachRecurringCount(int fromDay, int toDay, Visit visit) const {
+        recurring.forEachCount(fromDay, min(toDay, lastDueDay()), visit);
+    }
+
+    const CategoryStatsIndex& getCategoryStats() const { return categoryStats; }
+    const CategorySearchIndex& getCategoryNames() const { return categoryNames; }
+
+    // Where a row sits in (date, id) order; recurring occurrences carry the negated rule id
+    static pair<int, int> rowKey(const Expense& expense) {
+        int dayNumber = numeric_limits<int>::min();
+        DateUtil::toDayNumber(expense.getDate(), dayNumber);
+        return {dayNumber, expense.getId()};
+    }
+
+    // Up to limit matching rows strictly after the cursor in (date, id) order and no later than
+    // toDay, due recurring occurrences included. Both sources are entered at the cursor, so a page
+    // costs the same however deep it is
+    template <typename Match>
+    vector<shared_ptr<Expense>> pageAfter(const pair<int, int>& cursor, int toDay, size_t limit, Match matches) const {
+        vector<shared_ptr<Expense>> page;
+        auto next = dateIndex.upper_bound(cursor);
+        auto takeRowsBefore = [&](const pair<int, int>& key) {
+            for (; page.size() < limit && next != dateIndex.end() && next->first <= toDay && *next < key; ++next) {
+                shared_ptr<Expense> expense = expenses[slotById.at(next->second)];
+                if (matches(*expense)) {
+                    page.push_back(expense);
+                }
+            }
+        };
+        recurring.expandWhile(cursor.first, min(toDay, lastDueDay()), [&](const RecurringSchedule::Rule& rule, int dayNumber) {
+            if (make_pair(dayNumber, -rule.id) <= cursor) {
+                return true; // same day as the cursor, already shown
+            }
+            DetailedExpense occurrence = RecurringSchedule::occurrence(rule, dayNumber);
+            if (!matches(occurrence)) {
+                return true;
+            }
+            takeRowsBefore(rowKey(occurrence));
+            if (page.size() < limit) {
+                page.push_back(make_shared<DetailedExpense>(occurrence));
+            }
+            return page.size() < limit;
+        });
+        takeRowsBefore({numeric_limits<int>::max(), numeric_limits<int>::max()});
+        return page;
+    }
+
+    // Recorded expenses with the same date, amount, currency and category; O(1)
+    size_t countDuplicates(const Expense& expense) const {
+        int dayNumber;
+        return DateUtil::toDayNumber(expense.getDate(), dayNumber) ? fingerprints.count(fingerprintOf(expense, dayNumber)) : 0;
+    }
+
+    size_t countDuplicates(uint64_t fingerprint) const { return fingerprints.count(fingerprint); }
+
+    // Trades filter memory against how often a new expense needs an exact lookup
+    void setDuplicateFalsePositiveRate(double rate) { fingerprints.configure(rate); }
+
+    // Expenses flagged as unusual for their category, by id
+    const map<int, ExpenseAnomaly>& getAnomalies() const { return anomalies; }
+
+    const ExpenseAnomaly* findAnomaly(int id) const {
+        auto found = anomalies.find(id);
+        return found == anomalies.end() ? nullptr : &found->second;
+    }
+
+    // Adds or replaces a nested category budget; its current spend is summed once here
+    bool setCategoryBudget(const string& path, double limit, BudgetPeriod period) {
+        if (!categoryBudgets.setBudget(path, limit, period)) {
+            return false;
+        }
+        forEachExpense([&](const shared_ptr<Expense>& expense) {
+            int dayNumber;
+            if (DateUtil::toDayNumber(expense->getDate(), dayNumber)) {
+                categoryBudgets.addTo(path, expense->getCategory(), dayNumber, toBase(*expense));
+            }
+        });
+        logCategoryBudgets();
+        bumpVersion();
+        return true;
+    }
+
+    bool removeCategoryBudget(const string& path) {
+        if (!categoryBudgets.removeBudget(path)) {
+            return false;
+        }
+        logCategoryBudgets();
+        bumpVersion();
+        return true;
+    }
+
+    const CategoryBudgets& getCategoryBudgets() const { return categoryBudgets; }
+
+    // Category budgets with their spend in the period holding dayNumber, due recurring expenses included
+    vector<CategoryBudgets::Status> listCategoryBudgets(int dayNumber) const {
+        return categoryBudgets.list(dayNumber, recurringSpend());
+    }
+
+    // Budget threshold alerts raised since the last call
+    vector<string> takeBudgetAlerts() {
+        vector<string> alerts;
+        alerts.swap(budgetAlerts);
+        return alerts;
+    }
+
+    // The account as it stood at a past instant (milliseconds since the epoch): the log is replayed
+    // from the nearest checkpoint into a fresh read-only user, so every view and report runs on it unchanged.
+    // It converts with the rates quoted by that day, in the base currency of the time
+    unique_ptr<User> asOf(long long instant) const {
+        MutationLog::State state = mutations.stateAt(instant);
+        auto past = make_unique<User>(username, password, state.budget.amount);
+        past->recording = false;
+        past->asOfDay = DateUtil::dayOf(static_cast<time_t>(instant / 1000));
+        past->baseCurrency = state.baseCurrency;
+        past->budget.configure(state.budget.amount, state.budget.period, state.budget.rollover);
+        for (const auto& setting : state.categoryBudgets) {
+            past->categoryBudgets.setBudget(setting.path, setting.limit, setting.period);
+        }
+        past->tagDictionary = tagDictionary;
+        past->recurring.restore(state.rules);
+        for (const auto& rule : state.rules) {
+            past->categoryNames.add(rule.category, 1);
+        }
+        vector<shared_ptr<Expense>> rows;
+        rows.reserve(state.rows.size());
+        for (const auto& entry : state.rows) {
+            const ExpenseRow& row = entry.second;
+            auto expense = make_shared<DetailedExpense>(row.id, row.category, row.amount, row.date);
+            expense->setTags(row.tags);
+            expense->setCurrency(row.currency);
+            rows.push_back(std::move(expense));
+        }
+        past->addExpenses(std::move(rows));
+        return past;
+    }
+
+    const MutationLog& getMutationLog() const { return mutations; }
+
+    unsigned long long getVersion() const { return version; }
+    ResultCache& getResultCache() const { return resultCache; }
+
+    // Lazy loading: the history is swapped in/out by the AccountManager
+    bool isHistoryLoaded() const { return historyLoaded; }
+
+    // encodedLog is the mutation log saved with the history; when it is missing or corrupted
+    // the log restarts from the loaded state
+    void loadHistory(vector<shared_ptr<Expense>>&& history, const string& encodedLog) {
+        collectCompaction(true);
+        expenses = std::move(history);
+        resetLayout(mapSlots(expenses));
+        historyLoaded = true;
+        rebuildIndexes();
+        if (!mutations.decode(encodedLog)) {
+            mutations.begin(captureState());
+        }
+        bumpVersion();
+    }
+
+    string encodeMutationLog() const {
+        string encoded;
+        mutations.encode(encoded);
+        return encoded;
+    }
+
+    // Drops the history and the mutation log; save both to the store first
+    vector<shared_ptr<Expense>> unloadHistory() {
+        collectCompaction(true);
+        vector<shared_ptr<Expense>> history = liveExpenses();
+        expenses.clear();
+        expenses.shrink_to_fit();
+        resetLayout(unordered_map<int, size_t>());
+        historyLoaded = false;
+        spendIndex.clear();
+        categoryStats.clear();
+        dateIndex.clear();
+        fingerprints.clear();
+        forecast.clear();
+        categoryBudgets.clearSpend();
+        resultCache.invalidate();
+        mutations.clear();
+        return history;
+    }
+
+    // Rough estimate of the heap memory held by the resident history
+    size_t estimateHistoryBytes() const {
+        size_t bytes = expenses.capacity() * sizeof(shared_ptr<Expense>) + spendIndex.memoryBytes()
+                     + resultCache.memoryBytes() + liveRows.capacity() * sizeof(uint64_t)
+                     + slotById.size() * (sizeof(pair<int, size_t>) + 2 * sizeof(void*))
+                     + dateIndex.size() * (sizeof(pair<int, int>) + 4 * sizeof(void*))
+                     + fingerprints.memoryBytes() + mutations.memoryBytes();
+        for (const auto& tag : tagIndex) {
+            bytes += tag.memoryBytes();
+        }
+        forEachExpense([&bytes](const shared_ptr<Expense>& expense) {
+            // object + shared_ptr control block + string payloads
+            bytes += sizeof(DetailedExpense) + 2 * sizeof(void*)
+                   + expense->getCategory().capacity() + expense->getDate().capacity();
+        });
+        return bytes;
+    }
+
+    void displayExpenses() const {
+        if (!hasExpenses()) {
+            cout << "No expenses to display." << endl;
+            return;
+        }
+        cout << "Expenses for user: " << username << endl;
+        forEachExpense([](const shared_ptr<Expense>& expense) { expense->displayExpense(); });
+    }
+};
+
+// Persisted store for the expense histories of users that are not resident
+class ExpenseStore {
+public:
+    using Visitor = function<void(const shared_ptr<Expense>&)>;
+
+    virtual void save(const string& username, const vector<shared_ptr<Expense>>& expenses) = 0;
+    // Visits the stored expenses that may fall in [fromDay, toDay]; false if nothing is stored
+    virtual bool scan(const string& username, int fromDay, int toDay, const Visitor& visit) const = 0;
+    // The user's MutationLog in its encoded form; loadLog is false if none is stored
+    virtual void saveLog(const string& username, const string& encoded) = 0;
+    virtual bool loadLog(const string& username, string& encoded) const = 0;
+    // Every ExpenseGroup, encoded together; loadGroups is false if none are stored
+    virtual void saveGroups(const string& encoded) = 0;
+    virtual bool loadGroups(string& encoded) const = 0;
+    virtual void discardGroups() = 0;
+    // Deletes whatever is stored for the user
+    virtual void discard(const string& username) = 0;
+
+    bool load(const string& username, vector<shared_ptr<Expense>>& expenses) const {
+        return scan(username, numeric_limits<int>::min(), numeric_limits<int>::max(),
+                    [&expenses](const shared_ptr<Expense>& expense) { expenses.push_back(expense); });
+    }
+
+    virtual ~ExpenseStore() = default;
+};
+
+/*
+    One compact binary file per user, written as blocks of up to BLOCK_ROWS expenses:
+        block  = count, zigzag(minDay), maxDay - minDay, payloadBytes, payload
+        payload = category dictionary (size, then length-prefixed names), then per row:
+                  zigzag(id delta), zigzag(day delta), zigzag(cents) << 4 | flags, category index
+    Flags mark an amount that is not a whole number of cents (raw 8-byte double follows),
+    a date whose text does not round-trip through its day number (raw text follows),
+    tagged expenses (the tag bitset follows as a varint; ids are the user's TagDictionary)
+    and expenses in a named currency (the CurrencyCode follows the tags as a varint).
+    Readers use the block header to skip whole blocks outside a date range. Rows whose date does
+    not parse repeat the previous row's day and stay out of the block's range; a block of only
+    such rows has the range [0, 0].
+*/
+class FileExpenseStore : public ExpenseStore {
+private:
+    static const size_t BLOCK_ROWS = 128;
+    static const uint64_t RAW_AMOUNT = 1;
+    static const uint64_t RAW_DATE = 2;
+    static const uint64_t HAS_TAGS = 4;
+    static const uint64_t HAS_CURRENCY = 8;
+    static const int FLAG_BITS = 4;
+    string directory;
+
+    string pathFor(const string& username) const {
+        return directory + "expenses_" + username + ".dat";
+    }
+
+    string logPathFor(const string& username) const {
+        return directory + "mutations_" + username + ".dat";
+    }
+
+    string groupsPath() const {
+        return directory + "groups.dat";
+    }
+
+    static void writeFile(const string& path, const string& bytes, const string& what) {
+        ofstream out(path, ios::binary | ios::trunc);
+        if (!out.write(bytes.data(), static_cast<streamsize>(bytes.size()))) {
+            throw std::runtime_error("Unable to write " + what + ".");
+        }
+    }
+
+    static bool readFile(const string& path, string& bytes) {
+        ifstream in(path, ios::binary);
+        if (!in) {
+            return false;
+        }
+        bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        return true;
+    }
+
+    static uint64_t zigzag(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    static int64_t unzigzag(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    static void putVarint(string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    static void putString(string& out, const string& text) {
+        putVarint(out, text.size());
+        out += text;
+    }
+
+    static bool getVarint(const char*& pos, const char* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; pos < end && shift < 64; shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(*pos++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool getVarint(istream& in, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            int byte = in.get();
+            if (byte == EOF) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool getString(const char*& pos, const char* end, string& text) {
+        uint64_t length;
+        if (!getVarint(pos, end, length) || length > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        text.assign(pos, static_cast<size_t>(length));
+        pos += length;
+        return true;
+    }
+
+    static void encodeBlock(string& out, const vector<shared_ptr<Expense>>& expenses, size_t begin, size_t end) {
+        int minDay = numeric_limits<int>::max(), maxDay = numeric_limits<int>::min();
+        unordered_map<string, uint64_t> dictionary;
+        vector<const string*> names;
+        for (size_t i = begin; i < end; ++i) {
+            int dayNumber;
+            if (DateUtil::toDayNumber(expenses[i]->getDate(), dayNumber)) {
+                minDay = min(minDay, dayNumber);
+                maxDay = max(maxDay, dayNumber);
+            }
+            if (dictionary.emplace(expenses[i]->getCategory(), names.size()).second) {
+                names.push_back(&expenses[i]->getCategory());
+            }
+        }
+        if (minDay > maxDay) {
+            minDay = maxDay = 0;
+        }
+
+        string payload;
+        putVarint(payload, names.size());
+        for (const string* name : names) {
+            putString(payload, *name);
+        }
+        int64_t previousId = 0, previousDay = minDay;
+        for (size_t i = begin; i < end; ++i) {
+            const Expense& expense = *expenses[i];
+            int dayNumber = static_cast<int>(previousDay);
+            bool dated = DateUtil::toDayNumber(expense.getDate(), dayNumber);
+            putVarint(payload, zigzag(expense.getId() - previousId));
+            putVarint(payload, zigzag(dayNumber - previousDay));
+            previousId = expense.getId();
+            previousDay = dayNumber;
+
+            double amount = expense.getAmount();
+            int64_t cents = llround(amount * 100);
+            uint64_t flags = 0;
+            if (static_cast<double>(cents) / 100 != amount) {
+                flags |= RAW_AMOUNT;
+                cents = 0;
+            }
+            if (!dated || DateUtil::toString(dayNumber) != expense.getDate()) {
+                flags |= RAW_DATE;
+            }
+            if (expense.getTags()) {
+                flags |= HAS_TAGS;
+            }
+            if (expense.getCurrency() != CurrencyCode::BASE) {
+                flags |= HAS_CURRENCY;
+            }
+            putVarint(payload, zigzag(cents) << FLAG_BITS | flags);
+            if (flags & RAW_AMOUNT) {
+                char raw[sizeof(double)];
+                memcpy(raw, &amount, sizeof(double));
+                payload.append(raw, sizeof(double));
+            }
+            if (flags & RAW_DATE) {
+                putString(payload, expense.getDate());
+            }
+            if (flags & HAS_TAGS) {
+                putVarint(payload, expense.getTags());
+            }
+            if (flags & HAS_CURRENCY) {
+                putVarint(payload, expense.getCurrency());
+            }
+            putVarint(payload, dictionary[expense.getCategory()]);
+        }
+
+        putVarint(out, end - begin);
+        putVarint(out, zigzag(minDay));
+        putVarint(out, static_cast<uint64_t>(static_cast<int64_t>(maxDay) - minDay));
+        putVarint(out, payload.size());
+        out += payload;
+    }
+
+    static bool decodeBlock(const string& payload, uint64_t count, int64_t minDay, const Visitor& visit) {
+        const char* pos = payload.data();
+        const char* end = pos + payload.size();
+        uint64_t dictionarySize;
+        if (!getVarint(pos, end, dictionarySize) || dictionarySize > payload.size()) {
+            return false;
+        }
+        vector<string> names(static_cast<size_t>(dictionarySize));
+        for (auto& name : names) {
+            if (!getString(pos, end, name)) {
+                return false;
+            }
+        }
+        int64_t id = 0, dayNumber = minDay;
+        for (uint64_t row = 0; row < count; ++row) {
+            uint64_t idDelta, dayDelta, amountField, categoryIndex;
+            if (!getVarint(pos, end, idDelta) || !getVarint(pos, end, dayDelta) || !getVarint(pos, end, amountField)) {
+                return false;
+            }
+            id += unzigzag(idDelta);
+            dayNumber += unzigzag(dayDelta);
+            double amount = static_cast<double>(unzigzag(amountField >> FLAG_BITS)) / 100;
+            if (amountField & RAW_AMOUNT) {
+                if (end - pos < static_cast<ptrdiff_t>(sizeof(double))) {
+                    return false;
+                }
+                memcpy(&amount, pos, sizeof(double));
+                pos += sizeof(double);
+            }
+            string date;
+            if (amountField & RAW_DATE) {
+                if (!getString(pos, end, date)) {
+                    return false;
+                }
+            } else {
+                date = DateUtil::toString(static_cast<int>(dayNumber));
+            }
+            uint64_t tags = 0;
+            if ((amountField & HAS_TAGS) && !getVarint(pos, end, tags)) {
+                return false;
+            }
+            uint64_t currency = CurrencyCode::BASE;
+            if ((amountField & HAS_CURRENCY) && (!getVarint(pos, end, currency) || currency >= CurrencyCode::COUNT)) {
+                return false;
+            }
+            if (!getVarint(pos, end, categoryIndex) || categoryIndex >= names.size()) {
+                return false;
+            }
+            auto expense = make_shared<DetailedExpense>(static_cast<int>(id), names[categoryIndex], amount, date);
+            expense->setTags(tags);
+            expense->setCurrency(static_cast<uint16_t>(currency));
+            visit(expense);
+        }
+        return true;
+    }
+
+public:
+    explicit FileExpenseStore(const string& directory = "") : directory(directory) {}
+
+    void save(const string& username, const vector<shared_ptr<Expense>>& expenses) override {
+        string encoded;
+        for (size_t begin = 0; begin < expenses.size(); begin += BLOCK_ROWS) {
+            encodeBlock(encoded, expenses, begin, min(expenses.size(), begin + BLOCK_ROWS));
+        }
+        ofstream out(pathFor(username), ios::binary | ios::trunc);
+        if (!out.write(encoded.data(), static_cast<streamsize>(encoded.size()))) {
+            throw std::runtime_error("Unable to write the expense history of " + username + ".");
+        }
+    }
+
+    void saveLog(const string& username, const string& encoded) override {
+        writeFile(logPathFor(username), encoded, "the mutation log of " + username);
+    }
+
+    bool loadLog(const string& username, string& encoded) const override {
+        return readFile(logPathFor(username), encoded);
+    }
+
+    void saveGroups(const string& encoded) override {
+        writeFile(groupsPath(), encoded, "the shared expense groups");
+    }
+
+    bool loadGroups(string& encoded) const override {
+        return readFile(groupsPath(), encoded);
+    }
+
+    void discardGroups() override {
+        remove(groupsPath().c_str());
+    }
+
+    void discard(const string& username) override {
+        remove(pathFor(username).c_str());
+        remove(logPathFor(username).c_str());
+    }
+
+    bool scan(const string& username, int fromDay, int toDay, const Visitor& visit) const override {
+        ifstream in(pathFor(username), ios::binary);
+        if (!in) {
+            return false;
+        }
+        uint64_t count, minField, span, payloadBytes;
+        string payload;
+        while (getVarint(in, count) && getVarint(in, minField) && getVarint(in, span) && getVarint(in, payloadBytes)) {
+            int64_t minDay = unzigzag(minField);
+            int64_t maxDay = minDay + static_cast<int64_t>(span);
+            if (maxDay < fromDay || minDay > toDay) {
+                in.seekg(static_cast<streamoff>(payloadBytes), ios::cur); // whole block is out of range
+                continue;
+            }
+            payload.resize(static_cast<size_t>(payloadBytes));
+            if (!in.read(&payload[0], static_cast<streamsize>(payloadBytes))
+                || !decodeBlock(payload, count, minDay, visit)) {
+                throw std::runtime_error("The stored expense history of " + username + " is corrupted.");
+            }
+        }
+        return true;
+    }
+};
+
+// Minimal FlatBuffers encoder for Arrow IPC metadata. The buffer is written front to back:
+// FlatBuffers offsets always point forward, so a parent is written with placeholder offsets
+// that are linked once each child has been placed after it. Scalars are copied in host byte
+// order, which is little-endian on every platform this builds for
+class FlatBufferWriter {
+public:
+    struct Field {
+        int id;
+        int size;       // bytes: 1, 2, 4 or 8; offsets are 4
+        uint64_t value; // unused for offsets
+        bool offset;
+    };
+
+    static Field scalar(int id, int size, uint64_t value) { return {id, size, value, false}; }
+    static Field offset(int id) { return {id, 4, 0, true}; }
+
+    FlatBufferWriter() { put<uint32_t>(0); } // root offset, linked to the first table
+
+    // Writes a table's vtable and body; positions receives where each field landed, by id
+    size_t table(const vector<Field>& fields, vector<size_t>& positions) {
+        int slots = 0;
+        size_t maxAlign = 4;
+        for (const auto& field : fields) {
+            slots = max(slots, field.id + 1);
+            maxAlign = max(maxAlign, static_cast<size_t>(field.size));
+        }
+        vector<Field> ordered(fields);
+        stable_sort(ordered.begin(), ordered.end(), [](const Field& a, const Field& b) { return a.size > b.size; });
+        vector<uint16_t> fieldOffsets(static_cast<size_t>(slots), 0);
+        size_t size = 4; // the table starts with the offset back to its vtable
+        for (const auto& field : ordered) {
+            size = (size + field.size - 1) / field.size * field.size;
+            fieldOffsets[field.id] = static_cast<uint16_t>(size);
+            size += field.size;
+        }
+
+        align(2);
+        size_t vtable = buffer.size();
+        put<uint16_t>(static_cast<uint16_t>(4 + 2 * slots));
+        put<uint16_t>(static_cast<uint16_t>(size));
+        for (uint16_t fieldOffset : fieldOffsets) {
+            put<uint16_t>(fieldOffset);
+        }
+        align(maxAlign);
+        size_t table = buffer.size();
+        buffer.append(size, '\0');
+        patch<int32_t>(table, static_cast<int32_t>(table - vtable));
+        positions.assign(static_cast<size_t>(slots), 0);
+        for (const auto& field : fields) {
+            positions[field.id] = table + fieldOffsets[field.id];
+            if (!field.offset) {
+                memcpy(&buffer[positions[field.id]], &field.value, static_cast<size_t>(field.size));
+            }
+        }
+        if (!rootLinked) {
+            link(0, table);
+            rootLinked = true;
+        }
+        return table;
+    }
+
+    size_t string(const std::string& text) {
+        align(4);
+        size_t position = put<uint32_t>(static_cast<uint32_t>(text.size()));
+        buffer += text;
+        buffer += '\0';
+        return position;
+    }
+
+    // Vector of fixed-size structs made of longs, e.g. Arrow FieldNode and Buffer
+    size_t structs(const void* data, size_t count, size_t elementBytes) {
+        align(4);
+        while ((buffer.size() + 4) % 8) {
+            buffer += '\0';
+        }
+        size_t position = put<uint32_t>(static_cast<uint32_t>(count));
+        buffer.append(static_cast<const char*>(data), count * elementBytes);
+        return position;
+    }
+
+    // Vector of offsets to tables; slots receives the positions to link
+    size_t offsets(size_t count, vector<size_t>& slots) {
+        align(4);
+        size_t position = put<uint32_t>(static_cast<uint32_t>(count));
+        slots.clear();
+        for (size_t i = 0; i < count; ++i) {
+            slots.push_back(put<uint32_t>(0));
+        }
+        return position;
+    }
+
+    void link(size_t from, size_t target) { patch<uint32_t>(from, static_cast<uint32_t>(target - from)); }
+
+    const std::string& bytes() const { return buffer; }
+
+private:
+    std::string buffer;
+    bool rootLinked = false;
+
+    void align(size_t bytes) {
+        while (buffer.size() % bytes) {
+            buffer += '\0';
+        }
+    }
+
+    template <typename T>
+    size_t put(T value) {
+        align(sizeof(T));
+        size_t position = buffer.size();
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        return position;
+    }
+
+    template <typename T>
+    void patch(size_t position, T value) {
+        memcpy(&buffer[position], &value, sizeof(T));
+    }
+};
+
+/*
+    Columnar export in the Arrow IPC streaming format (readable with pyarrow.ipc.open_stream,
+    arrow::ipc::RecordBatchStreamReader and friends), with no dependency on the Arrow libraries:
+        user      dictionary<int32, utf8>
+        id        int32
+        date      date32 (days since 1970-01-01; null when the stored text is not a date)
+        category  dictionary<int32, utf8>
+        amount    int64, in cents of the expense's own currency
+        currency  dictionary<int32, utf8> (the owner's base code, or empty when unnamed)
+    Rows are gathered into one contiguous vector per column, dictionaries are sent once up
+    front, and each record batch of up to BATCH_ROWS rows is written straight from slices of
+    the column vectors.
+*/
+class ArrowExporter {
+public:
+    static const size_t BATCH_ROWS = 1 << 16;
+
+    // Following rows belong to this user
+    void beginUser(const string& username, uint16_t baseCurrency) {
+        currentUser = users.intern(username);
+        currentBase = baseCurrency;
+    }
+
+    void add(const Expense& expense) {
+        int dayNumber = 0;
+        bool dated = DateUtil::toDayNumber(expense.getDate(), dayNumber);
+        user.push_back(currentUser);
+        id.push_back(expense.getId());
+        day.push_back(dayNumber);
+        if (!dated) {
+            undated.push_back(id.size() - 1);
+        }
+        category.push_back(categories.intern(expense.getCategory()));
+        cents.push_back(llround(expense.getAmount() * 100));
+        uint16_t code = expense.getCurrency() == CurrencyCode::BASE ? currentBase : expense.getCurrency();
+        currency.push_back(currencies.intern(CurrencyCode::toString(code)));
+    }
+
+    size_t rowCount() const { return id.size(); }
+
+    // false when the file cannot be written
+    bool write(const string& path, size_t& bytesWritten) const {
+        ofstream out(path, ios::binary | ios::trunc);
+        if (!out) {
+            return false;
+        }
+        writeMessage(out, schemaMessage(), {});
+        writeDictionary(out, USER_DICTIONARY, users);
+        writeDictionary(out, CATEGORY_DICTIONARY, categories);
+        writeDictionary(out, CURRENCY_DICTIONARY, currencies);
+        for (size_t begin = 0; begin < rowCount() || begin == 0; begin += BATCH_ROWS) {
+            writeBatch(out, begin, min(rowCount(), begin + BATCH_ROWS));
+        }
+        const uint32_t END_OF_STREAM[2] = {0xFFFFFFFF, 0};
+        out.write(reinterpret_cast<const char*>(END_OF_STREAM), sizeof(END_OF_STREAM));
+        bytesWritten = static_cast<size_t>(out.tellp());
+        return static_cast<bool>(out);
+    }
+
+private:
+    // Arrow flatbuffer enum values
+    static const int METADATA_V5 = 4;
+    static const int HEADER_SCHEMA = 1, HEADER_DICTIONARY_BATCH = 2, HEADER_RECORD_BATCH = 3;
+    static const int TYPE_INT = 2, TYPE_UTF8 = 5, TYPE_DATE = 8;
+    static const int USER_DICTIONARY = 0, CATEGORY_DICTIONARY = 1, CURRENCY_DICTIONARY = 2;
+
+    struct Dictionary {
+        unordered_map<string, int32_t> indexOf;
+        vector<int32_t> offsets{0}; // utf8 column layout: value i is data[offsets[i], offsets[i + 1])
+        string data;
+
+        int32_t intern(const string& value) {
+            auto found = indexOf.emplace(value, static_cast<int32_t>(offsets.size() - 1));
+            if (found.second) {
+                data += value;
+                offsets.push_back(static_cast<int32_t>(data.size()));
+            }
+            return found.first->second;
+        }
+
+        size_t size() const { return offsets.size() - 1; }
+    };
+
+    struct FieldNode {
+        int64_t length;
+        int64_t nullCount;
+    };
+
+    struct BufferSpec {
+        int64_t offset;
+        int64_t length;
+    };
+
+    struct Body {
+        vector<pair<const void*, size_t>> buffers;
+        vector<FieldNode> nodes;
+    };
+
+    vector<int32_t> user, id, day, category, currency;
+    vector<int64_t> cents;
+    vector<size_t> undated; // rows whose date is null, ascending
+    Dictionary users, categories, currencies;
+    int32_t currentUser = 0;
+    uint16_t currentBase = CurrencyCode::BASE;
+
+    static size_t padded(size_t bytes) { return (bytes + 7) / 8 * 8; }
+
+    // Continuation marker, metadata length, metadata padded to 8 bytes, then the body buffers
+    static void writeMessage(ostream& out, const string& metadata, const vector<pair<const void*, size_t>>& body) {
+        static const char PADDING[8] = {0};
+        uint32_t prefix[2] = {0xFFFFFFFF, static_cast<uint32_t>(padded(metadata.size()))};
+        out.write(reinterpret_cast<const char*>(prefix), sizeof(prefix));
+        out.write(metadata.data(), static_cast<streamsize>(metadata.size()));
+        out.write(PADDING, static_cast<streamsize>(padded(metadata.size()) - metadata.size()));
+        for (const auto& buffer : body) {
+            out.write(static_cast<const char*>(buffer.first), static_cast<streamsize>(buffer.second));
+            out.write(PADDING, static_cast<streamsize>(padded(buffer.second) - buffer.second));
+        }
+    }
+
+    // Message table with its header table's fields; returns the header field position to link
+    static size_t beginMessage(FlatBufferWriter& writer, int headerType, int64_t bodyLength) {
+        vector<size_t> fields;
+        writer.table({FlatBufferWriter::scalar(0, 2, METADATA_V5), FlatBufferWriter::scalar(1, 1, headerType),
+                      FlatBufferWriter::offset(2), FlatBufferWriter::scalar(3, 8, static_cast<uint64_t>(bodyLength))},
+                     fields);
+        return fields[2];
+    }
+
+    static size_t intType(FlatBufferWriter& writer, int bitWidth) {
+        vector<size_t> fields;
+        return writer.table({FlatBufferWriter::scalar(0, 4, static_cast<uint64_t>(bitWidth)), FlatBufferWriter::scalar(1, 1, 1)}, fields);
+    }
+
+    static void field(FlatBufferWriter& writer, size_t slot, const string& name, int type, int bitWidth, int dictionaryId) {
+        vector<size_t> fields;
+        vector<FlatBufferWriter::Field> layout = {FlatBufferWriter::offset(0), FlatBufferWriter::scalar(1, 1, 1),
+                                                  FlatBufferWriter::scalar(2, 1, static_cast<uint64_t>(type)),
+                                                  FlatBufferWriter::offset(3), FlatBufferWriter::offset(5)};
+        if (dictionaryId >= 0) {
+            layout.push_back(FlatBufferWriter::offset(4));
+        }
+        writer.link(slot, writer.table(layout, fields));
+        writer.link(fields[0], writer.string(name));
+        vector<size_t> typeFields;
+        if (type == TYPE_INT) {
+            writer.link(fields[3], intType(writer, bitWidth));
+        } else if (type == TYPE_DATE) {
+            writer.link(fields[3], writer.table({FlatBufferWriter::scalar(0, 2, 0)}, typeFields)); // DateUnit.DAY
+        } else {
+            writer.link(fields[3], writer.table({}, typeFields));
+        }
+        if (dictionaryId >= 0) {
+            vector<size_t> encoding;
+            writer.link(fields[4], writer.table({FlatBufferWriter::scalar(0, 8, static_cast<uint64_t>(dictionaryId)),
+                                                 FlatBufferWriter::offset(1)}, encoding));
+            writer.link(encoding[1], intType(writer, 32));
+        }
+        vector<size_t> none;
+        writer.link(fields[5], writer.offsets(0, none));
+    }
+
+    static string schemaMessage() {
+        FlatBufferWriter writer;
+        size_t header = beginMessage(writer, HEADER_SCHEMA, 0);
+        vector<size_t> fields, slots;
+        writer.link(header, writer.table({FlatBufferWriter::scalar(0, 2, 0), FlatBufferWriter::offset(1)}, fields));
+        writer.link(fields[1], writer.offsets(6, slots));
+        field(writer, slots[0], "user", TYPE_UTF8, 0, USER_DICTIONARY);
+        field(writer, slots[1], "id", TYPE_INT, 32, -1);
+        field(writer, slots[2], "date", TYPE_DATE, 0, -1);
+        field(writer, slots[3], "category", TYPE_UTF8, 0, CATEGORY_DICTIONARY);
+        field(writer, slots[4], "amount", TYPE_INT, 64, -1);
+        field(writer, slots[5], "currency", TYPE_UTF8, 0, CURRENCY_DICTIONARY);
+        return writer.bytes();
+    }
+
+    // RecordBatch table describing a body; the buffers are laid out back to back, 8-byte aligned
+    static void recordBatch(FlatBufferWriter& writer, size_t slot, int64_t length, const Body& body) {
+        vector<BufferSpec> specs;
+        int64_t offset = 0;
+        for (const auto& buffer : body.buffers) {
+            specs.push_back({offset, static_cast<int64_t>(buffer.second)});
+            offset += static_cast<int64_t>(padded(buffer.second));
+        }
+        vector<size_t> fields;
+        writer.link(slot, writer.table({FlatBufferWriter::scalar(0, 8, static_cast<uint64_t>(length)),
+                                        FlatBufferWriter::offset(1), FlatBufferWriter::offset(2)}, fields));
+        writer.link(fields[1], writer.structs(body.nodes.data(), body.nodes.size(), sizeof(FieldNode)));
+        writer.link(fields[2], writer.structs(specs.data(), specs.size(), sizeof(BufferSpec)));
+    }
+
+    static int64_t bodyLength(const Body& body) {
+        int64_t length = 0;
+        for (const auto& buffer : body.buffers) {
+            length += static_cast<int64_t>(padded(buffer.second));
+        }
+        return length;
+    }
+
+    static void writeDictionary(ostream& out, int dictionaryId, const Dictionary& dictionary) {
+        Body body;
+        body.nodes.push_back({static_cast<int64_t>(dictionary.size()), 0});
+        body.buffers = {{nullptr, 0},
+                        {dictionary.offsets.data(), dictionary.offsets.size() * sizeof(int32_t)},
+                        {dictionary.data.data(), dictionary.data.size()}};
+        FlatBufferWriter writer;
+        size_t header = beginMessage(writer, HEADER_DICTIONARY_BATCH, bodyLength(body));
+        vector<size_t> fields;
+        writer.link(header, writer.table({FlatBufferWriter::scalar(0, 8, static_cast<uint64_t>(dictionaryId)),
+                                          FlatBufferWriter::offset(1)}, fields));
+        recordBatch(writer, fields[1], static_cast<int64_t>(dictionary.size()), body);
+        writeMessage(out, writer.bytes(), body.buffers);
+    }
+
+    void writeBatch(ostream& out, size_t begin, size_t end) const {
+        size_t rows = end - begin;
+        // Only the date column can hold nulls; its validity bitmap is built per batch when needed
+        auto firstNull = lower_bound(undated.begin(), undated.end(), begin);
+        auto lastNull = lower_bound(undated.begin(), undated.end(), end);
+        vector<uint8_t> dateValidity;
+        if (firstNull != lastNull) {
+            dateValidity.assign((rows + 7) / 8, 0xFF);
+            for (auto row = firstNull; row != lastNull; ++row) {
+                dateValidity[(*row - begin) / 8] &= static_cast<uint8_t>(~(1 << ((*row - begin) % 8)));
+            }
+        }
+
+        Body body;
+        auto column = [&](const void* values, size_t valueBytes, const vector<uint8_t>& validity, int64_t nulls) {
+            body.nodes.push_back({static_cast<int64_t>(rows), nulls});
+            body.buffers.emplace_back(validity.data(), validity.size());
+            body.buffers.emplace_back(values, rows * valueBytes);
+        };
+        const vector<uint8_t> allValid;
+        column(user.data() + begin, sizeof(int32_t), allValid, 0);
+        column(id.data() + begin, sizeof(int32_t), allValid, 0);
+        column(day.data() + begin, sizeof(int32_t), dateValidity, lastNull - firstNull);
+        column(category.data() + begin, sizeof(int32_t), allValid, 0);
+        column(cents.data() + begin, sizeof(int64_t), allValid, 0);
+        column(currency.data() + begin, sizeof(int32_t), allValid, 0);
+
+        FlatBufferWriter writer;
+        size_t header = beginMessage(writer, HEADER_RECORD_BATCH, bodyLength(body));
+        recordBatch(writer, header, static_cast<int64_t>(rows), body);
+        writeMessage(out, writer.bytes(), body.buffers);
+    }
+};
+
+class BudgetManager {
+private:
+    User& user; // Reference to the User object
+
+public:
+    explicit BudgetManager(User& user) : user(user) {}
+
+    double getBudget() const {
+        return user.getBudget();
+    }
+
+    void updateBudget(double updatedBudget) {
+        if (updatedBudget < 0) {
+            cout << "\n> Error: Budget cannot be negative!" << endl;
+            return;
+        }
+        user.setBudget(updatedBudget);
+        cout << "> Successfully changed the budget!" << endl;
+        cout << "\nCURRENT BUDGET: " << user.getBudget() << endl;
+    }
+
+    // Left in the current budget period, from the ledger
+    double getRemainingBudget() const {
+        return user.getRemainingBudget(DateUtil::today());
+    }
+
+    void manageBudgetPrompt() {
+        while (true) {
+            system("cls");
+            cout << "================================================" << endl;
+            cout << "              MANAGE BUDGET                     " << endl;
+            cout << "================================================" << endl;
+
+            int today = DateUtil::today();
+            BudgetLedger::PeriodSummary current = user.getBudgetSummary(today);
+            cout << "\nBUDGET: " << user.getBudget() << " " << DateUtil::periodName(user.getBudgetPeriod())
+                 << (user.hasBudgetRollover() ? ", unspent amounts roll over" : "") << endl;
+            if (current.carriedIn > 0) {
+                cout << "CARRIED OVER: " << current.carriedIn << endl;
+            }
+            cout << "SPENT (" << DateUtil::periodLabel(user.getBudgetPeriod(), today) << "): " << current.spent << endl;
+            cout << "CURRENT BUDGET: " << current.remaining() << endl;
+            SpendForecast::Projection forecast = user.getForecast(today);
+            cout << "PROJECTED SPEND: " << forecast.projectedSpend << " (about " << forecast.dailyRate << " a day)" << endl;
+            if (user.getBudget() > 0) {
+                cout << "RUNS OUT: " << (forecast.runOutDay == SpendForecast::NO_RUN_OUT ? "not this period"
+                                                                                        : DateUtil::toString(forecast.runOutDay)) << endl;
+            }
+
+            cout << "\n1 - Change the budget amount\n";
+            cout << "2 - Change the budget period and rollover\n";
+            cout << "3 - View the budget ledger\n";
+            cout << "4 - Category budgets\n";
+            cout << "5 - Base currency and exchange rates\n";
+            cout << "6 - Back to main menu\n";
+            cout << "CHOICE: ";
+            int choice;
+            while (!(cin >> choice) || choice < 1 || choice > 6) {
+                cin.clear();
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                cout << "Invalid choice. Please try again: ";
+            }
+
+            if (choice == 1) {
+                double newBudget;
+                cout << "\n> Input the amount of the new budget: ";
+                while (!(cin >> newBudget) || newBudget < 0) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid input! Please enter a positive value: ";
+                }
+                updateBudget(newBudget);
+            } else if (choice == 2) {
+                cout << "\nPERIOD (1 - Weekly, 2 - Monthly, 3 - Yearly): ";
+                int period;
+                while (!(cin >> period) || period < 1 || period > 3) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid choice. Please try again: ";
+                }
+                char rollover;
+                do {
+                    cout << "> Carry unspent amounts into the next period? (Y/N): ";
+                    cin >> rollover;
+                } while (tolower(rollover) != 'y' && tolower(rollover) != 'n');
+                user.setBudgetPeriod(static_cast<BudgetPeriod>(period - 1), tolower(rollover) == 'y');
+                cout << "\n> Successfully updated the budget!" << endl;
+            } else if (choice == 3) {
+                printLedger(today);
+            } else if (choice == 4) {
+                manageCategoryBudgets();
+                continue;
+            } else if (choice == 5) {
+                manageCurrency();
+            } else {
+                return;
+            }
+            cout << "> Press any key to continue ...";
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cin.get();
+        }
+    }
+
+    // Past periods come straight from the ledger; nothing is rescanned
+    void printLedger(int today) const {
+        const size_t SHOWN = 12;
+        auto periods = user.getBudgetHistory(today);
+        cout << "\n-------------------------------------------------------\n";
+        cout << "PERIOD\t\t\tBUDGET\tCARRIED\tSPENT\tLEFT\n";
+        cout << "-------------------------------------------------------\n";
+        for (size_t i = periods.size() > SHOWN ? periods.size() - SHOWN : 0; i < periods.size(); ++i) {
+            const auto& period = periods[i];
+            cout << left << setw(20) << DateUtil::periodLabel(user.getBudgetPeriod(), period.start) << right << "\t"
+                 << period.budget << "\t" << period.carriedIn << "\t" << period.spent << "\t" << period.remaining() << endl;
+        }
+        if (periods.empty()) {
+            cout << "> No expenses recorded yet.\n";
+        } else if (user.hasRecurring()) {
+            cout << "> Entered expenses only; recurring expenses count toward the current period's budget.\n";
+        }
+    }
+
+    // Budgets and totals are shown in the base currency; foreign expenses are converted at the
+    // rate of their own date from a rate table loaded from a local file
+    void manageCurrency() {
+        FxRates* rates = FxRates::getInstance();
+        string base = CurrencyCode::toString(user.getBaseCurrency());
+        cout << "\nBASE CURRENCY: " << (base.empty() ? "(unnamed)" : base) << endl;
+        cout << "RATE TABLE: " << rates->currencyCount() << " currencies" << endl;
+        cout << "\n1 - Change the base currency\n";
+        cout << "2 - Load exchange rates (date,code,rate per line)\n";
+        cout << "3 - Back\n";
+        cout << "CHOICE: ";
+        int choice;
+        while (!(cin >> choice) || choice < 1 || choice > 3) {
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cout << "Invalid choice. Please try again: ";
+        }
+
+        if (choice == 1) {
+            string input;
+            uint16_t code = CurrencyCode::BASE;
+            cout << "\nBASE CURRENCY (e.g. PHP, '-' to leave it unnamed): ";
+            cin >> input;
+            while (input != "-" && !CurrencyCode::parse(input, code)) {
+                cout << "Error: Currency must be a three-letter code.\nPlease try again: ";
+                cin >> input;
+            }
+            user.setBaseCurrency(code);
+            cout << "\n> Successfully changed the base currency!" << endl;
+        } else if (choice == 2) {
+            string path;
+            cout << "\nRATES FILE PATH: ";
+            cin >> path;
+            size_t loaded = 0;
+            vector<string> errors;
+            if (!rates->load(path, loaded, errors)) {
+                cout << "> Could not open " << path << "." << endl;
+            } else {
+                user.syncRates();
+                cout << "\n> Loaded " << loaded << " rates for " << rates->currencyCount() << " currencies." << endl;
+                for (size_t i = 0; i < errors.size() && i < 10; ++i) {
+                    cout << "  " << errors[i] << endl;
+                }
+                if (errors.size() > 10) {
+                    cout << "  ... and " << errors.size() - 10 << " more rejected lines." << endl;
+                }
+            }
+        }
+    }
+
+    // Nested budgets such as "food > dining > coffee", each with its own limit and period
+    void manageCategoryBudgets() {
+        while (true) {
+            system("cls");
+            cout << "================================================" << endl;
+            cout << "              CATEGORY BUDGETS                  " << endl;
+            cout << "================================================" << endl;
+
+            auto budgets = user.listCategoryBudgets(DateUtil::today());
+            if (budgets.empty()) {
+                cout << "\n> No category budgets yet." << endl;
+            } else {
+                cout << "\n-------------------------------------------------------\n";
+                cout << "CATEGORY\t\tPERIOD\tSPENT\tLIMIT\tUSED\n";
+                cout << "-------------------------------------------------------\n";
+                for (const auto& budget : budgets) {
+                    size_t separator = budget.path.rfind("> ");
+                    string name = string(2 * budget.depth, ' ')
+                                + (separator == string::npos ? budget.path : budget.path.substr(separator + 2));
+                    cout << left << setw(16) << name << right << "\t"
+                         << DateUtil::periodName(budget.period) << "\t"
+                         << budget.spent << "\t" << budget.limit << "\t"
+                         << static_cast<int>(100 * budget.spent / budget.limit) << "%" << endl;
+                }
+            }
+
+            cout << "\n1 - Set a budget\n";
+            cout << "2 - Remove a budget\n";
+            cout << "3 - Back\n";
+            cout << "CHOICE: ";
+            int choice;
+            while (!(cin >> choice) || choice < 1 || choice > 3) {
+                cin.clear();
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                cout << "Invalid choice. Please try again: ";
+            }
+            if (choice == 3) {
+                return;
+            }
+
+            string path;
+            cout << "\nCATEGORY (e.g. food > dining > coffee): ";
+            cin >> ws;
+            getline(cin, path);
+            if (choice == 1) {
+                double limit;
+                cout << "LIMIT: ";
+                while (!(cin >> limit) || limit <= 0) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid input! Please enter a positive value: ";
+                }
+                cout << "PERIOD (1 - Weekly, 2 - Monthly, 3 - Yearly): ";
+                int period;
+                while (!(cin >> period) || period < 1 || period > 3) {
+                    cin.clear();
+                    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                    cout << "Invalid choice. Please try again: ";
+                }
+                if (user.setCategoryBudget(path, limit, static_cast<BudgetPeriod>(period - 1))) {
+                    cout << "\n> Budget saved for '" << CategoryBudgets::joinPath(CategoryBudgets::splitPath(path)) << "'." << endl;
+                } else {
+                    cout << "\n> Error: Please enter a category." << endl;
+                }
+            } else if (user.removeCategoryBudget(path)) {
+                cout << "\n> Budget removed." << endl;
+            } else {
+                cout << "\n> No budget is set for that category." << endl;
+            }
+            cout << "> Press any key to continue ...";
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            cin.get();
+        }
+    }
+};
+
+// ANSI escape sequences for redrawing single lines of the screen in place
+class Terminal {
+public:
+    // Windows consoles only interpret escape sequences once asked to
+    static void enableEscapes() {
+#ifdef _WIN32
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (GetConsoleMode(console, &mode)) {
+            SetConsoleMode(console, mode | 0x0004); // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        }
+#endif
+    }
+
+    static string clearScreen() { return "\x1b[2J\x1b[H"; }
+
+    // Moves to the start of a screen row (1-based) and erases it
+    static string rewriteLine(int row) { return "\x1b[" + to_string(row) + ";1H\x1b[2K"; }
+
+    // Whether a key press or line is waiting, without blocking
+    static bool inputWaiting() {
+#ifdef _WIN32
+        return WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE), 0) == WAIT_OBJECT_0;
+#else
+        pollfd console{fileno(stdin), POLLIN, 0};
+        return poll(&console, 1, 0) > 0;
+#endif
+    }
+
+    // Called by prompts about to read a password, so session traces leave the answer out
+    static void expectSecret() { secretPending() = true; }
+
+    // Whether the line being read answers a password prompt; clears the mark
+    static bool takeSecret() {
+        bool pending = secretPending();
+        secretPending() = false;
+        return pending;
+    }
+
+private:
+    static bool& secretPending() {
+        static bool pending = false;
+        return pending;
+    }
+};
+
+/*
+    Background work for the time spent waiting on the user. The menus stay plain blocking code;
+    instead, cin reads through IdleInput, which runs background steps one at a time for as long
+    as no input is waiting and only then blocks on the console. Work comes in two kinds:
+        tasks   - one-off jobs, called step by step until they return false
+        sources - standing checks such as per-user maintenance, called whenever the loop is idle
+                  and returning true only when they found something to do
+    Steps should take a few milliseconds at most, as a key press waits for the current one.
+*/
+class IdleLoop {
+public:
+    using Step = function<bool()>;
+
+    static IdleLoop* getInstance() {
+        static IdleLoop instance;
+        return &instance;
+    }
+
+    void post(Step task) { tasks.push_back(std::move(task)); }
+    void addSource(Step source) { sources.push_back(std::move(source)); }
+
+    // Runs one step, tasks first in round robin; false when nothing had work to do
+    bool runStep() {
+        if (!tasks.empty()) {
+            Step task = std::move(tasks.front());
+            tasks.pop_front();
+            if (task()) {
+                tasks.push_back(std::move(task));
+            }
+            return true;
+        }
+        for (size_t tried = 0; tried < sources.size(); ++tried) {
+            nextSource = (nextSource + 1) % sources.size();
+            if (sources[nextSource]()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t pendingTasks() const { return tasks.size(); }
+
+private:
+    deque<Step> tasks;
+    vector<Step> sources;
+    size_t nextSource = 0;
+
+    IdleLoop() = default;
+};
+
+// Line-at-a-time reader over the console that lets the IdleLoop run until input arrives
+class IdleInput : public streambuf {
+private:
+    streambuf* source;
+    string line;
+
+protected:
+    int_type underflow() override {
+        while (source->in_avail() <= 0 && !Terminal::inputWaiting() && IdleLoop::getInstance()->runStep()) {
+        }
+        line.clear();
+        int_type c;
+        while ((c = source->sbumpc()) != traits_type::eof() && c != '\n') {
+            line += traits_type::to_char_type(c);
+        }
+        if (c == traits_type::eof() && line.empty()) {
+            return traits_type::eof();
+        }
+        line += '\n';
+        setg(&line[0], &line[0], &line[0] + line.size());
+        return traits_type::to_int_type(line[0]);
+    }
+
+public:
+    explicit IdleInput(streambuf* source) : source(source) {}
+};
+
+// Strategy
+class ExpenseViewStrategy {
+public: 
+    // Prompt for the view's options (month, category, ...) before it is displayed; false when canceled
+    virtual bool selectOptions(const User&) { return true; }
+
+    // Whether an expense belongs to this view
+    virtual bool matches(const Expense&) const { return true; }
+
+    // Inclusive day-number window holding every match; false when the view is not date bounded
+    virtual bool getDateRange(int&, int&) const { return false; }
+
+    // Normalized description of the query for the result cache; empty when not cacheable
+    virtual string cacheKey() const { return ""; }
+
+    virtual void viewExpenses(const User& user, double& totalExpenses, ostream& out) const = 0; // abstraction
+    virtual ~ExpenseViewStrategy() {}
+
+    // Column titles and one line per row, for the pager
+    virtual string pageColumns() const { return "ID\tAMOUNT\tCATEGORY\tDATE"; }
+
+    virtual string pageRow(const User& user, const Expense& expense) const {
+        ostringstream line;
+        line << setw(5) << rowId(expense) << "\t" << setw(7) << user.toBase(expense) << "\t"
+             << setw(10) << expense.getCategory() << "\t" << expense.getDate() << originalAmount(user, expense);
+        return line.str();
+    }
+
+    // Amounts are listed in the base currency; a foreign expense is followed by what was paid
+    static string originalAmount(const User& user, const Expense& expense) {
+        if (expense.getCurrency() == CurrencyCode::BASE || expense.getCurrency() == user.getBaseCurrency()) {
+            return "";
+        }
+        ostringstream paid;
+        paid << "  (" << expense.getAmount() << " " << CurrencyCode::toString(expense.getCurrency()) << ")";
+        return paid.str();
+    }
+
+    // Recurring occurrences carry the negated rule id and are listed as R<rule id>
+    static string rowId(const Expense& expense) {
+        return expense.getId() < 0 ? "R" + to_string(-expense.getId()) : to_string(expense.getId());
+    }
+
+protected:
+    static bool dayInRange(const Expense& expense, int fromDay, int toDay) {
+        int dayNumber;
+        return DateUtil::toDayNumber(expense.getDate(), dayNumber) && dayNumber >= fromDay && dayNumber <= toDay;
+    }
+
+    // The matching expenses and the matching recurring occurrences, merged in (date, id) order,
+    // each with its amount in the base currency. The result set is converted in one batch.
+    // Occurrences are only generated inside the view's date window, or up to today for undated views
+    void forEachRow(const User& user, const function<void(const Expense&, double)>& visit) const {
+        typedef pair<int, const Expense*> Row;
+        vector<Row> rows;
+        user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+            if (matches(*expense)) {
+                int dayNumber = numeric_limits<int>::min();
+                DateUtil::toDayNumber(expense->getDate(), dayNumber);
+                rows.emplace_back(dayNumber, expense.get());
+            }
+        });
+        stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.first < b.first; });
+
+        vector<double> amounts(rows.size());
+        vector<uint16_t> codes(rows.size());
+        vector<int> days(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            amounts[i] = rows[i].second->getAmount();
+            codes[i] = rows[i].second->getCurrency();
+            days[i] = rows[i].first;
+        }
+        FxRates::getInstance()->toBase(user.getBaseCurrency(), rows.size(), amounts.data(), codes.data(), days.data(), amounts.data(),
+                                       user.ratesQuotedBy());
+
+        int fromDay = numeric_limits<int>::min(), toDay = numeric_limits<int>::max();
+        getDateRange(fromDay, toDay);
+        size_t next = 0;
+        user.forEachOccurrence(fromDay, toDay, [&](const RecurringSchedule::Rule& rule, int dayNumber) {
+            DetailedExpense occurrence = RecurringSchedule::occurrence(rule, dayNumber);
+            if (!matches(occurrence)) {
+                return;
+            }
+            for (; next < rows.size() && rows[next].first < dayNumber; ++next) {
+                visit(*rows[next].second, amounts[next]);
+            }
+            visit(occurrence, occurrence.getAmount());
+        });
+        for (; next < rows.size(); ++next) {
+            visit(*rows[next].second, amounts[next]);
+        }
+    }
+};
+
+class WeeklyViewStrategy : public ExpenseViewStrategy {
+public:
+	bool isSameWeek(const std::tm& date1, const std::tm& date2) {
+    auto time1 = std::mktime(const_cast<std::tm*>(&date1));
+    auto time2 = std::mktime(const_cast<std::tm*>(&date2));
+    const int SECONDS_IN_A_WEEK = 7 * 24 * 60 * 60;
+
+    return std::abs(std::difftime(time1, time2)) < SECONDS_IN_A_WEEK &&
+           date1.tm_wday <= date2.tm_wday; // Ensure they're in the same week
+	}
+
+    // The past week is today and the six days before it
+    bool getDateRange(int& fromDay, int& toDay) const override {
+        fromDay = DateUtil::today() - 6;
+        toDay = numeric_limits<int>::max();
+        return true;
+    }
+
+    bool matches(const Expense& expense) const override {
+        int fromDay, toDay;
+        getDateRange(fromDay, toDay);
+        return dayInRange(expense, fromDay, toDay);
+    }
+
+    string cacheKey() const override { return "weekly:" + to_string(DateUtil::today()); }
+
+    void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        out << "\n> Viewing expenses for the past week:\n";
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+        out << "-------------------------------------------------------\n";
+
+        bool found = false; // To track if any expenses were found
+        forEachRow(user, [&](const Expense& expense, double amount) {
+            out << setw(5) << rowId(expense) << "\t"
+                 << setw(7) << amount << "\t"
+                 << setw(10) << expense.getCategory() << "\t"
+                 << expense.getDate() << originalAmount(user, expense) << endl;
+            totalExpenses += amount;
+            found = true;
+        });
+
+        if (!found) {
+            out << "> No expenses made in the past week.\n";
+        }
+    }
+};
+
+class MonthlyViewStrategy : public ExpenseViewStrategy {
+private:
+    int month = 1;
+
+    static int currentYear() {
+        time_t now = time(nullptr);
+        tm currentDate = *localtime(&now);
+        return currentDate.tm_year + 1900;
+    }
+
+public:
+    explicit MonthlyViewStrategy(int month = 1) : month(month) {}
+
+	bool isSameMonth(const std::tm& date1, const std::tm& date2) {
+    return date1.tm_year == date2.tm_year && date1.tm_mon == date2.tm_mon;
+	}
+
+    bool selectOptions(const User&) override {
+        cout << "\n> Please enter the month (#) you want your expenses to be viewed (1 - 12): ";
+        cin >> month;
+
+        while (month < 1 || month > 12) {
+            cout << "Invalid month! Please enter a valid month (1 - 12): ";
+            cin >> month;
+        }
+        return true;
+    }
+
+    bool getDateRange(int& fromDay, int& toDay) const override {
+        int year = currentYear();
+        fromDay = DateUtil::toDayNumber(year, month, 1);
+        toDay = (month == 12 ? DateUtil::toDayNumber(year + 1, 1, 1) : DateUtil::toDayNumber(year, month + 1, 1)) - 1;
+        return true;
+    }
+
+    bool matches(const Expense& expense) const override {
+        int fromDay, toDay;
+        getDateRange(fromDay, toDay);
+        return dayInRange(expense, fromDay, toDay);
+    }
+
+    string cacheKey() const override { return "monthly:" + to_string(currentYear()) + "-" + to_string(month); }
+
+    void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        int year = currentYear();
+
+        out << "\n> Viewing expenses for the selected month of the current year (" << year << "):\n";
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+        out << "-------------------------------------------------------\n";
+
+        bool found = false;
+        forEachRow(user, [&](const Expense& expense, double amount) {
+            out << setw(5) << rowId(expense) << "\t"
+                 << setw(7) << amount << "\t"
+                 << setw(10) << expense.getCategory() << "\t"
+                 << expense.getDate() << originalAmount(user, expense) << endl;
+            totalExpenses += amount;
+            found = true;
+        });
+
+        if (!found) {
+            out << "> No expenses made for this month in " << year << ".\n";
+        }
+    }
+};
+
+class YearlyViewStrategy : public ExpenseViewStrategy {
+public:
+	bool isSameYear(const std::tm& date1, const std::tm& date2) {
+    return date1.tm_year == date2.tm_year;
+	}
+
+    bool getDateRange(int& fromDay, int& toDay) const override {
+        time_t now = time(nullptr);
+        int year = localtime(&now)->tm_year + 1900;
+        fromDay = DateUtil::toDayNumber(year, 1, 1);
+        toDay = DateUtil::toDayNumber(year, 12, 31);
+        return true;
+    }
+
+    bool matches(const Expense& expense) const override {
+        int fromDay, toDay;
+        getDateRange(fromDay, toDay);
+        return dayInRange(expense, fromDay, toDay);
+    }
+
+    string cacheKey() const override {
+        int fromDay, toDay;
+        getDateRange(fromDay, toDay);
+        return "yearly:" + to_string(fromDay);
+    }
+
+    void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        out << "\n> Viewing expenses for the current year:\n";
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+        out << "-------------------------------------------------------\n";
+
+        bool found = false;
+        forEachRow(user, [&](const Expense& expense, double amount) {
+            out << setw(5) << rowId(expense) << "\t"
+                 << setw(7) << amount << "\t"
+                 << setw(10) << expense.getCategory() << "\t"
+                 << expense.getDate() << originalAmount(user, expense) << endl;
+            totalExpenses += amount;
+            found = true;
+        });
+
+        if (!found) {
+            out << "> No expenses made for this year.\n";
+        }
+    }
+};
+
+class CategoryViewStrategy : public ExpenseViewStrategy {
+private:
+    string categoryLower;
+
+public:
+    // The typed name is matched fuzzily, so part of a name or a typo still finds the category.
+    // 'x' or a blank line cancels
+    bool selectOptions(const User& user) override {
+        const size_t SHOWN = 5;
+        cout << "\n> You have " << user.getCategoryNames().size() << " categories.\n";
+        cout << "> Please input the category you wanted the expenses to be viewed (part of the name is enough).\n";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        while (true) {
+            string query;
+            cout << "CATEGORY ('x' to cancel): ";
+            if (!getline(cin, query) || query.find_first_not_of(' ') == string::npos || query == "x" || query == "X") {
+                return false;
+            }
+            vector<CategorySearchIndex::Match> matches = user.getCategoryNames().search(query, SHOWN);
+            if (matches.empty()) {
+                cout << "> No similar category found. Please try again.\n";
+                continue;
+            }
+            if (matches[0].score == 1 || matches.size() == 1) {
+                categoryLower = matches[0].key;
+                return true;
+            }
+
+            cout << "\n> Closest categories:\n";
+            for (size_t i = 0; i < matches.size(); ++i) {
+                cout << i + 1 << " - " << matches[i].name << " (" << matches[i].expenseCount << ")\n";
+            }
+            cout << "> Press Enter for '" << matches[0].name << "', choose 1 - " << matches.size() << ", or 0 to search again: ";
+            string choice;
+            getline(cin, choice);
+            size_t picked = choice.empty() ? 1 : static_cast<size_t>(atoi(choice.c_str()));
+            if (picked >= 1 && picked <= matches.size()) {
+                categoryLower = matches[picked - 1].key;
+                return true;
+            }
+        }
+    }
+
+    bool matches(const Expense& expense) const override {
+        return InputValidator::toLowerCase(expense.getCategory()) == categoryLower;
+    }
+
+    string cacheKey() const override { return "category:" + categoryLower; }
+
+    void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        bool categoryFound = false;
+
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+        out << "-------------------------------------------------------\n";
+
+        forEachRow(user, [&](const Expense& expense, double amount) {
+            out << rowId(expense) << "\t"
+                 << amount << "\t"
+                 << expense.getCategory() << "\t"
+                 << expense.getDate() << originalAmount(user, expense) << endl;
+            totalExpenses += amount;
+            categoryFound = true;
+        });
+
+        if (!categoryFound) {
+            out << "\n> No expenses found in this category.\n";
+        }
+    }
+};
+
+// Expenses whose tags satisfy a boolean expression, e.g. "business and not reimbursable"
+class TagViewStrategy : public ExpenseViewStrategy {
+private:
+    TagQuery query;
+
+public:
+    bool selectOptions(const User& user) override {
+        const TagDictionary& tags = user.getTagDictionary();
+        if (tags.size() == 0) {
+            cout << "\n> You have not tagged any expenses yet.\n";
+            return true;
+        }
+        cout << "\n> Your tags: " << tags.describe(~uint64_t(0)) << endl;
+        cout << "> Combine them with and, or, not and parentheses.\n";
+        while (true) {
+            string text, error;
+            cout << "TAG QUERY: ";
+            cin >> ws;
+            getline(cin, text);
+            if (query.parse(text, tags, error)) {
+                return true;
+            }
+            cout << "Error: " << error << "\nPlease try again.\n";
+        }
+    }
+
+    bool matches(const Expense& expense) const override {
+        return query.matches(expense.getTags());
+    }
+
+    string cacheKey() const override { return "tags:" + query.canonical(); }
+
+    string pageColumns() const override { return "ID\tAMOUNT\tCATEGORY\tDATE\t\tTAGS"; }
+
+    string pageRow(const User& user, const Expense& expense) const override {
+        return ExpenseViewStrategy::pageRow(user, expense) + "\t" + user.getTagDictionary().describe(expense.getTags());
+    }
+
+    void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        bool found = false;
+
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\t\tTAGS\n";
+        out << "-------------------------------------------------------\n";
+
+        user.forEachTagged(query, [&](const shared_ptr<Expense>& expense) {
+            double amount = user.toBase(*expense);
+            out << expense->getId() << "\t"
+                << setw(7) << amount << "\t"
+                << setw(10) << expense->getCategory() << "\t"
+                << expense->getDate() << "\t"
+                << user.getTagDictionary().describe(expense->getTags()) << originalAmount(user, *expense) << endl;
+            totalExpenses += amount;
+            found = true;
+        });
+
+        if (!found) {
+            out << "\n> No expenses match these tags.\n";
+        }
+    }
+};
+
+class AllViewStrategy : public ExpenseViewStrategy {
+    
+    string cacheKey() const override { return "all"; }
+
+	void viewExpenses(const User& user, double& totalExpenses, ostream& out) const override {
+        out << "\n-------------------------------------------------------\n";
+        out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+        out << "-------------------------------------------------------\n";
+        //displayExpense()
+		forEachRow(user, [&](const Expense& expense, double amount) {
+            out << rowId(expense) << "\t"
+                 << setw(7) << amount << "\t"
+                 << setw(10) << expense.getCategory() << "\t"
+                 << expense.getDate() << originalAmount(user, expense) << endl;
+                 totalExpenses += amount; // Accumulate total for all expenses
+        });
+    }
+
+};
+
+// Blocking queue with a fixed capacity; producers wait when it is full (backpressure)
+template <typename T>
+class BoundedQueue {
+private:
+    deque<T> items;
+    size_t capacity;
+    bool closed = false;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(max<size_t>(1, capacity)) {}
+
+    void push(T item) {
+        unique_lock<mutex> guard(lock);
+        notFull.wait(guard, [&] { return items.size() < capacity || closed; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(T& item) {
+        unique_lock<mutex> guard(lock);
+        notEmpty.wait(guard, [&] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+// Outcome of a bulk import
+struct ImportResult {
+    size_t imported = 0;
+    size_t rejected = 0;
+    size_t duplicates = 0; // rows already recorded (or repeated in the file); skipped or imported as asked
+    vector<string> errors; // first few rejected lines with their reason
+    size_t workers = 0;
+    double elapsedMs = 0;
+    bool opened = false;
+};
+
+/*
+    Pipelined CSV import (amount,category,date per line, optionally followed by ,currency):
+        reader  - one thread reads large chunks cut on line boundaries
+        parsers - N threads validate and convert the lines of a chunk in parallel
+        writer  - the calling thread commits chunks in file order, assigning ids in batches
+    Queues between the stages are bounded, and the reader stops reading ahead once
+    MAX_IN_FLIGHT chunks are waiting to be committed.
+*/
+class ExpenseImporter {
+private:
+    static const size_t CHUNK_BYTES = 1 << 20;
+    static const size_t MAX_IN_FLIGHT = 16;
+    static const size_t MAX_ERRORS = 10;
+
+    struct Chunk {
+        size_t sequence = 0;
+        string text;
+    };
+
+    struct ParsedRow {
+        double amount;
+        string category;
+        string date;
+        uint16_t currency;
+        uint64_t fingerprint; // hashed by the parsers, so the writer only probes
+    };
+
+    struct ParsedChunk {
+        size_t sequence = 0;
+        size_t lineCount = 0;
+        vector<ParsedRow> rows;
+        size_t rejected = 0;
+        vector<pair<size_t, string>> errors; // line within the chunk, reason
+    };
+
+    // Same rules as adding an expense by hand; reports problems as a message instead of throwing
+    static const char* parseLine(string_view line, double budget, uint16_t baseCurrency, int today, ParsedChunk& parsed) {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        // A trailing three-letter field is the currency; categories may hold commas, dates never do
+        uint16_t currency = CurrencyCode::BASE;
+        size_t lastComma = line.rfind(',');
+        if (lastComma != string_view::npos && line.size() - lastComma == 4
+            && CurrencyCode::parse(string(line.substr(lastComma + 1)), currency)) {
+            line = line.substr(0, lastComma);
+        }
+        size_t firstComma = line.find(',');
+        lastComma = line.rfind(',');
+        if (firstComma == string_view::npos || firstComma == lastComma) {
+            return "Expected amount,category,date[,currency].";
+        }
+        string_view category = line.substr(firstComma + 1, lastComma - firstComma - 1);
+        string_view date = line.substr(lastComma + 1);
+
+        double amount;
+        int dayNumber;
+        ParseError error = InputValidator::parseAmount(line.substr(0, firstComma), amount);
+        if (error != ParseError::None) {
+            return InputValidator::describe(error);
+        }
+        if (category.empty()) {
+            return "Input cannot be empty.";
+        }
+        error = DateUtil::parse(date, dayNumber);
+        if (error != ParseError::None) {
+            return InputValidator::describe(error);
+        }
+        if (dayNumber > today) {
+            return "Date cannot be in the future.";
+        }
+        if (amount * FxRates::getInstance()->factor(currency, baseCurrency, dayNumber) > budget) {
+            return "Insufficient Budget! Cannot exceed the available budget.";
+        }
+        parsed.rows.push_back({amount, string(category), string(date), currency,
+                               ExpenseFingerprints::fingerprint(dayNumber, amount, currency, category)});
+        return nullptr;
+    }
+
+    static ParsedChunk parseChunk(const Chunk& chunk, double budget, uint16_t baseCurrency, int today) {
+        ParsedChunk parsed;
+        parsed.sequence = chunk.sequence;
+        string_view text(chunk.text);
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == string_view::npos) {
+                end = text.size();
+            }
+            string_view line = text.substr(start, end - start);
+            start = end + 1;
+            parsed.lineCount++;
+
+            bool header = chunk.sequence == 0 && parsed.lineCount == 1 && line.size() >= 6
+                          && InputValidator::toLowerCase(string(line.substr(0, 6))) == "amount";
+            if (header || line.empty() || line == "\r") {
+                continue;
+            }
+            const char* error = parseLine(line, budget, baseCurrency, today, parsed);
+            if (error) {
+                parsed.rejected++;
+                if (parsed.errors.size() < MAX_ERRORS) {
+                    parsed.errors.emplace_back(parsed.lineCount, error);
+                }
+            }
+        }
+        return parsed;
+    }
+
+public:
+    // With skipDuplicates, rows matching a recorded expense or an earlier row of the file are
+    // left out; otherwise they are imported and only counted
+    static ImportResult importFile(User& user, const string& path, bool skipDuplicates = false,
+                                   size_t workerCount = thread::hardware_concurrency()) {
+        ImportResult result;
+        auto started = chrono::steady_clock::now();
+        ifstream in(path, ios::binary);
+        if (!in) {
+            return result;
+        }
+        result.opened = true;
+        result.workers = workerCount = max<size_t>(1, workerCount);
+
+        const int today = DateUtil::today();
+        const double budget = user.getBudget();
+        const uint16_t baseCurrency = user.getBaseCurrency();
+
+        BoundedQueue<Chunk> chunks(2 * workerCount);
+        BoundedQueue<ParsedChunk> parsedChunks(2 * workerCount);
+        mutex windowLock;
+        condition_variable windowOpen;
+        size_t committed = 0; // chunks handed to the user so far
+        bool finished = false;
+
+        thread reader([&] {
+            string carry;
+            vector<char> buffer(CHUNK_BYTES);
+            size_t sequence = 0;
+            while (true) {
+                {
+                    unique_lock<mutex> guard(windowLock);
+                    windowOpen.wait(guard, [&] { return sequence - committed < MAX_IN_FLIGHT || finished; });
+                    if (finished) {
+                        break;
+                    }
+                }
+                in.read(buffer.data(), static_cast<streamsize>(buffer.size()));
+                size_t got = static_cast<size_t>(in.gcount());
+                if (got == 0) {
+                    if (!carry.empty()) {
+                        chunks.push({sequence, std::move(carry)});
+                    }
+                    break;
+                }
+                carry.append(buffer.data(), got);
+                size_t lastNewline = carry.rfind('\n');
+                if (lastNewline == string::npos) {
+                    continue; // keep reading until a whole line is available
+                }
+                Chunk chunk;
+                chunk.sequence = sequence++;
+                chunk.text.swap(carry);
+                carry.assign(chunk.text, lastNewline + 1, string::npos);
+                chunk.text.resize(lastNewline + 1);
+                chunks.push(std::move(chunk));
+            }
+            chunks.close();
+        });
+
+        vector<thread> parsers;
+        for (size_t i = 0; i < workerCount; ++i) {
+            parsers.emplace_back([&] {
+                Chunk chunk;
+                while (chunks.pop(chunk)) {
+                    parsedChunks.push(parseChunk(chunk, budget, baseCurrency, today));
+                }
+            });
+        }
+        thread closer([&] {
+            for (auto& parser : parsers) {
+                parser.join();
+            }
+            parsedChunks.close();
+        });
+
+        // Single writer: reorder by sequence, then assign ids and commit one batch per chunk
+        map<size_t, ParsedChunk> pending;
+        size_t nextSequence = 0, lineBase = 0;
+        ParsedChunk parsed;
+        unordered_set<uint64_t> inChunk; // rows of the chunk being committed are not indexed yet
+        while (parsedChunks.pop(parsed)) {
+            pending.emplace(parsed.sequence, std::move(parsed));
+            for (auto it = pending.find(nextSequence); it != pending.end(); it = pending.find(nextSequence)) {
+                ParsedChunk& ready = it->second;
+                vector<shared_ptr<Expense>> batch;
+                batch.reserve(ready.rows.size());
+                inChunk.clear();
+                for (auto& row : ready.rows) {
+                    bool duplicate = !inChunk.insert(row.fingerprint).second || user.countDuplicates(row.fingerprint) > 0;
+                    if (duplicate) {
+                        result.duplicates++;
+                        if (skipDuplicates) {
+                            continue;
+                        }
+                    }
+                    batch.push_back(make_shared<DetailedExpense>(user.nextExpenseId() + static_cast<int>(batch.size()),
+                                                                 row.category, row.amount, row.date));
+                    batch.back()->setCurrency(row.currency);
+                }
+                result.imported += batch.size();
+                user.addExpenses(std::move(batch));
+                result.rejected += ready.rejected;
+                for (const auto& error : ready.errors) {
+                    if (result.errors.size() < MAX_ERRORS) {
+                        result.errors.push_back("Line " + to_string(lineBase + error.first) + ": " + error.second);
+                    }
+                }
+                lineBase += ready.lineCount;
+                pending.erase(it);
+                nextSequence++;
+                {
+                    lock_guard<mutex> guard(windowLock);
+                    committed = nextSequence;
+                }
+                windowOpen.notify_all();
+            }
+        }
+        {
+            lock_guard<mutex> guard(windowLock);
+            finished = true; // lets the reader exit if it is still waiting
+        }
+        windowOpen.notify_all();
+        reader.join();
+        closer.join();
+
+        result.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return result;
+    }
+};
+
+class ExpenseManager { 
+private:
+    list<shared_ptr<Expense>> expenses; 
+	shared_ptr<ExpenseViewStrategy> viewStrategy; 
+    string expenseId;
+    double amount;
+    double totalExpenses;
+
+public:
+	
+	void addExpense(User& user, BudgetManager& budgetManager) {
+	    while (addExpenseOnce(user, budgetManager)) {
+	    }
+	}
+
+	// One pass of the flow; true when the user asked to add another expense
+	bool addExpenseOnce(User& user, BudgetManager& budgetManager) { 
+    system("cls"); // Clear the screen
+    string menuTitle = "ADD EXPENSE";
+    printHeader(menuTitle);
+    cout << "> Please enter the following expense details to add." << endl;
+    cout << "> Input 'x' to cancel anytime." << endl;
+
+    cout << "CURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
+
+    string amountInput, category, date;
+    double amount;
+    uint16_t currency = CurrencyCode::BASE;
+
+    try {
+        // Loop until valid expense amount is entered
+        while (true) {
+            cout << "\nAMOUNT: ";
+            cin >> amountInput;
+            if (amountInput == "x" || amountInput == "X") {
+                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                return false;
+            }
+
+            try {
+                amount = InputValidator::toAmount(amountInput); // Validate and convert in one pass
+                if (!promptCurrency("CURRENCY (e.g. USD, '-' for your base currency): ", currency)) {
+                    cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                    return false;
+                }
+                // The date is not known yet, so the budget check uses today's rate
+                double baseAmount = amount * FxRates::getInstance()->factor(currency, user.getBaseCurrency(), DateUtil::today());
+                if (baseAmount > budgetManager.getBudget()) {
+                    throw std::invalid_argument("Insufficient Budget! Cannot exceed the available budget.");
+                }
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+            }
+        }
+
+        // Loop until valid category is entered; the whole line is read so nested paths keep their spaces
+        while (true) {
+            cout << "CATEGORY (e.g. food > dining > coffee): ";
+            cin >> ws;
+            getline(cin, category);
+            if (category == "x" || category == "X") {
+                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                return false;
+            }
+
+            try {
+                InputValidator::validateCategory(category);
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+            }
+        }
+
+        // Loop until valid date is entered
+        while (true) {
+            cout << "DATE (YYYY-MM-DD): ";
+            cin >> date;
+            if (date == "x" || date == "X") {
+                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                return false;
+            }
+
+            try {
+                int dayNumber = InputValidator::toDayNumber(date);
+
+                // Check if date is in the future
+                if (dayNumber > DateUtil::today()) {
+                    throw std::invalid_argument("Date cannot be in the future.");
+                }
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+            }
+        }
+
+        // Optional labels on top of the category, e.g. business,trip-2024
+        uint64_t tags = 0;
+        while (true) {
+            string tagInput, error;
+            cout << "TAGS (comma separated, '-' for none): ";
+            cin >> tagInput;
+            if (tagInput == "x" || tagInput == "X") {
+                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                return false;
+            }
+            if (parseTags(user, tagInput, tags, error)) {
+                break;
+            }
+            cout << "Error: " << error << "\nPlease try again.\n";
+        }
+
+        // Generate ID and add the expense
+        int id = user.nextExpenseId();
+        auto newExpense = make_shared<DetailedExpense>(id, category, amount, date);
+        newExpense->setTags(tags);
+        newExpense->setCurrency(currency);
+        if (size_t duplicates = user.countDuplicates(*newExpense)) {
+            char confirm;
+            cout << "\n> " << duplicates << " expense(s) with the same date, amount and category are already recorded." << endl;
+            do {
+                cout << "> Add it anyway? (Y/N): ";
+                cin >> confirm;
+            } while (tolower(confirm) != 'y' && tolower(confirm) != 'n');
+            if (tolower(confirm) == 'n') {
+                cout << "> Operation canceled. Redirecting to main menu..." << endl;
+                return false;
+            }
+        }
+        user.addExpense(newExpense);
+
+        // Display success message
+        cout << "\n> Expense added successfully!\n" << endl;
+        cout << "EXPENSE ID: " << id << endl;
+        cout << "AMOUNT: " << user.toBase(*newExpense) << ExpenseViewStrategy::originalAmount(user, *newExpense) << endl;
+        cout << "CATEGORY: " << category << endl;
+        cout << "DATE: " << date << endl;
+        if (tags) {
+            cout << "TAGS: " << user.getTagDictionary().describe(tags) << endl;
+        }
+        printAnomaly(user, *newExpense);
+        cout << "\nREMAINING BUDGET: " << budgetManager.getRemainingBudget() << endl;
+        printBudgetAlerts(user);
+
+    } catch (const std::exception& e) {
+        // Handle validation or other errors
+        cout << "Error: " << e.what() << endl;
+        cout << "> Redirecting to the main menu..." << endl;
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+        return false;
+    }
+
+    // Prompt to add another expense
+    char choice;
+    do {
+	    cout << "\n> Add another expense? (Y/N): ";
+	    cin >> choice;
+	    if (tolower(choice) != 'y' && tolower(choice) != 'n') {
+			cout << "Invalid Answer!\n";
+		}
+	    if (tolower(choice) == 'y') {
+	        return true;
+	    }
+	} while (tolower(choice) != 'y' && tolower(choice) != 'n');
+	
+	if(tolower(choice) == 'n') {
+        cout << endl << "> Redirecting to the main menu ..." << endl;
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+	}
+    return false;
+}
+	
+	void setViewStrategy(const shared_ptr<ExpenseViewStrategy>& strategy) {
+        viewStrategy = strategy;
+    }
+	
+	// False when the user canceled, in which case there is nothing to display
+	bool handleExpensesView(const User& user) {
+	    int choice;
+	    char cancelChoice;
+	
+	    do {
+	        cout << "> Select display type to view your expenses:" << endl;
+	        cout << "> Input 'x' to cancel anytime." << endl;
+	        cout << "1 - Category\n";
+	        cout << "2 - Weekly\n";
+	        cout << "3 - Monthly\n";
+	        cout << "4 - Yearly\n";
+	        cout << "5 - View All\n";
+	        cout << "6 - Tags\n";
+	        cout << "CHOICE: ";
+	
+	        string input;
+	        cin >> input;
+	
+	        // Check if the user entered 'x' or 'X' to cancel
+	        if (input == "x" || input == "X") {
+	            return false;  // Exit if 'x' is chosen
+	        }
+	
+	        // Try to convert the input to an integer
+	        try {
+	            choice = stoi(input); // Convert input to integer
+	        } catch (const invalid_argument&) {
+	            cout << "Invalid choice! Please enter a number between 1 and 6.\n";
+	            continue; // Skip to the next loop iteration
+	        }
+	
+	        switch (choice) {
+	            case 1:
+	                setViewStrategy(make_shared<CategoryViewStrategy>());
+	                break;
+	            case 2:
+	                setViewStrategy(make_shared<WeeklyViewStrategy>());
+	                break;
+	            case 3:
+	                setViewStrategy(make_shared<MonthlyViewStrategy>());
+	                break;
+	            case 4:
+	                setViewStrategy(make_shared<YearlyViewStrategy>());
+	                break;
+	            case 5:
+	                setViewStrategy(make_shared<AllViewStrategy>());
+	                break;
+	            case 6:
+	                setViewStrategy(make_shared<TagViewStrategy>());
+	                break;
+	            default:
+	                cout << "Invalid choice! Please select a valid option.\n";
+	                continue; // Go back to the top of the loop
+	        }
+	
+	        // If a valid choice was made, ask for its options
+	        return viewStrategy->selectOptions(user);
+	    } while (true);
+	}
+
+
+	// Shows the view a page at a time. Pages are fetched by keyset from the last row shown, and
+	// only the screen lines that differ from the previous page are rewritten
+	void pageExpenses(const User& user) {
+	    const size_t PAGE_SIZE = 15;
+	    const string PROMPT = "> N - next page, P - previous page, Q - done: ";
+
+	    int fromDay = numeric_limits<int>::min(), toDay = numeric_limits<int>::max();
+	    viewStrategy->getDateRange(fromDay, toDay);
+	    auto matches = [this](const Expense& expense) { return viewStrategy->matches(expense); };
+
+	    ostringstream header;
+	    printHeader("VIEW EXPENSE", header);
+	    header << "\n-------------------------------------------------------\n";
+	    header << viewStrategy->pageColumns() << "\n";
+	    header << "-------------------------------------------------------\n";
+	    const string headerText = header.str();
+	    const int FIRST_ROW = static_cast<int>(std::count(headerText.begin(), headerText.end(), '\n')) + 1; // screen row of the first expense line
+	    Terminal::enableEscapes();
+	    cout << Terminal::clearScreen() << headerText;
+
+	    vector<pair<int, int>> previousPages; // cursor each earlier page started from
+	    pair<int, int> cursor(fromDay, numeric_limits<int>::min()); // rows strictly after it
+	    vector<string> shown(PAGE_SIZE + 2, "\x01"); // lines on screen; nothing matches the sentinel at first
+	    while (true) {
+	        auto page = user.pageAfter(cursor, toDay, PAGE_SIZE + 1, matches); // one extra row tells if a next page exists
+	        bool hasNext = page.size() > PAGE_SIZE;
+	        page.resize(min(page.size(), PAGE_SIZE));
+
+	        vector<string> lines(PAGE_SIZE + 2);
+	        for (size_t i = 0; i < page.size(); ++i) {
+	            lines[i] = viewStrategy->pageRow(user, *page[i]);
+	        }
+	        if (page.empty()) {
+	            lines[0] = previousPages.empty() ? "> No expenses found for this view." : "> No more expenses.";
+	        }
+	        lines[PAGE_SIZE] = "-------------------------------------------------------";
+	        lines[PAGE_SIZE + 1] = "PAGE " + to_string(previousPages.size() + 1) + (hasNext ? "" : " (last)");
+
+	        ostringstream frame;
+	        for (size_t i = 0; i < lines.size(); ++i) {
+	            if (lines[i] != shown[i]) {
+	                frame << Terminal::rewriteLine(FIRST_ROW + static_cast<int>(i)) << lines[i];
+	                shown[i] = lines[i];
+	            }
+	        }
+	        int promptRow = FIRST_ROW + static_cast<int>(lines.size()) + 1;
+	        frame << Terminal::rewriteLine(promptRow + 1) << Terminal::rewriteLine(promptRow) << PROMPT; // the last answer echoed below
+	        cout << frame.str() << flush;
+
+	        string command;
+	        if (!(cin >> command) || tolower(command[0]) == 'q' || tolower(command[0]) == 'x') {
+	            cout << Terminal::rewriteLine(promptRow + 1);
+	            return;
+	        }
+	        if (tolower(command[0]) == 'n' && hasNext) {
+	            previousPages.push_back(cursor);
+	            cursor = User::rowKey(*page.back());
+	        } else if (tolower(command[0]) == 'p' && !previousPages.empty()) {
+	            cursor = previousPages.back();
+	            previousPages.pop_back();
+	        }
+	    }
+	}
+
+	void expensesView(const User& user, double& totalExpenses) {
+        if (!viewStrategy) {
+            cout << "No view strategy selected!\n";
+            return;
+        }
+        string key = viewStrategy->cacheKey();
+        if (key.empty()) {
+            viewStrategy->viewExpenses(user, totalExpenses, cout);
+            return;
+        }
+        cachedRender(user, "view:" + key, totalExpenses, [&](ostream& out, double& total) {
+            viewStrategy->viewExpenses(user, total, out);
+        });
+    }
+
+    // Replays a rendered result from the user's cache, or renders and caches it
+    void cachedRender(const User& user, const string& queryKey, double& totalExpenses,
+                      const function<void(ostream&, double&)>& render) {
+        ResultCache& cache = user.getResultCache();
+        string key = user.hasRecurring() ? queryKey + "@" + to_string(DateUtil::today()) : queryKey; // occurrences come due daily
+        string output;
+        double total = 0;
+        if (!cache.lookup(key, user.getVersion(), output, total)) {
+            ostringstream rendered;
+            render(rendered, total);
+            output = rendered.str();
+            cache.store(key, user.getVersion(), output, total);
+        }
+        cout << output;
+        totalExpenses += total;
+    }
+
+	void viewExpenses(User& user) {
+	    while (viewExpensesOnce(user)) {
+	    }
+	}
+
+	// One pass of the flow; true when the user asked to view in another display type
+	bool viewExpensesOnce(User& user) {
+    int choice;
+    string menuTitle = "VIEW EXPENSE";
+    system("cls");
+    	// header
+        printHeader(menuTitle); 
+		
+		if (!user.hasExpenses() && !user.hasRecurring()) {
+			cout << "> You do not have any expense entries yet." << endl;
+			cout << "> Redirecting to main menu." << endl;
+			cout << "> Press any key to continue ...";
+			cin.ignore(numeric_limits<streamsize>::max(), '\n');
+			cin.get();
+			return false;
+		}   
+		    
+		// Let the user select a strategy
+	    if (!handleExpensesView(user)) {
+	        return false;
+	    }
+	
+	    // Page through the selected strategy's rows
+	    pageExpenses(user);
+
+		char viewChoice;
+	    do {
+	        cout << "\n> View in another display type? (Y/N): ";
+	        cin >> viewChoice;
+	    } while (tolower(viewChoice) != 'y' && tolower(viewChoice) != 'n');  // Loop until valid input
+	
+	    if (tolower(viewChoice) == 'y') {
+	        return true;
+	    } else {
+	        cout << endl << "> Redirecting to the main menu ..." << endl;
+	        cout << "> Press any key to continue ...";
+	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	        cin.get();
+	    }
+	    return false;
+	}
+
+
+	void modifyExpense(User& user, BudgetManager& budgetManager) {
+	    while (modifyExpenseOnce(user, budgetManager)) {
+	    }
+	}
+
+	// One pass of the flow; true when the user asked to modify another expense
+	bool modifyExpenseOnce(User& user, BudgetManager& budgetManager) {	
+    string menuTitle = "MODIFY EXPENSE";
+    system("cls");
+    printHeader(menuTitle);
+    
+    if (!user.hasExpenses()) {
+        cout << "> You do not have any expense entries yet." << endl;
+        cout << "> Redirecting to the main menu..." << endl;
+        system("pause");
+        return false;
+    }
+    
+    if (!handleExpensesView(user)) {
+        return false;
+    }
+    expensesView(user, totalExpenses);
+
+    int id;
+    cout << "\n> Input expense ID to modify (or '0' to cancel): ";
+    cin >> id;
+
+    if (id == 0) {
+        return false;
+    }
+
+    // Locate the expense by its id
+    shared_ptr<Expense> expense = user.findExpense(id);
+
+    if (!expense) {
+        cout << "> Expense ID not found. Returning to main menu..." << endl;
+        system("pause");
+        return false;
+    }
+
+    // Display current details
+    cout << "\nCurrent Details:" << endl;
+    cout << "ID: " << expense->getId() << endl;
+    cout << "Amount: " << expense->getAmount() << endl;
+    cout << "Currency: " << currencyName(user, expense->getCurrency()) << endl;
+    cout << "Category: " << expense->getCategory() << endl;
+    cout << "Date: " << expense->getDate() << endl;
+    cout << "Tags: " << user.getTagDictionary().describe(expense->getTags()) << endl;
+
+    // Modify expense fields
+    double newAmount = expense->getAmount();
+    uint16_t newCurrency = expense->getCurrency();
+    string newCategory = expense->getCategory();
+    string newDate = expense->getDate();
+
+    cout << "\nEnter new details (leave blank to retain current value):" << endl;
+
+    // Loop until valid amount is entered
+    string amountInput;
     cout << "New Amount: ";
     cin.ignore(); // Clear input buffer
     getline(cin, amountInput);
     if (!amountInput.empty()) {
         while (true) {
-            try {
-                InputValidator::validateIsNumeric(amountInput);
-                newAmount = stod(amountInput); // Convert validated input to double
-                if (newAmount > budgetManager.getRemainingBudget()) {
-                    throw std::invalid_argument("Insufficient Budget! Cannot exceed the available budget.");
+            try {
+                newAmount = InputValidator::toAmount(amountInput); // Validate and convert in one pass
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+                cout << "New Amount: ";
+                getline(cin, amountInput);
+                if (amountInput.empty()) break;
+            }
+        }
+    }
+
+    // Blank keeps the current currency, '-' switches to the base currency
+    string currencyInput;
+    cout << "New Currency (e.g. USD, '-' for your base currency): ";
+    getline(cin, currencyInput);
+    while (!currencyInput.empty()) {
+        if (currencyInput == "-") {
+            newCurrency = CurrencyCode::BASE;
+            break;
+        }
+        if (CurrencyCode::parse(currencyInput, newCurrency)) {
+            break;
+        }
+        cout << "Error: Currency must be a three-letter code.\nPlease try again.\n";
+        cout << "New Currency (e.g. USD, '-' for your base currency): ";
+        getline(cin, currencyInput);
+    }
+    if ((newAmount != expense->getAmount() || newCurrency != expense->getCurrency())
+        && newAmount * FxRates::getInstance()->factor(newCurrency, user.getBaseCurrency(), DateUtil::today())
+               > budgetManager.getRemainingBudget()) {
+        cout << "Error: Insufficient Budget! Cannot exceed the available budget. Keeping the current amount.\n";
+        newAmount = expense->getAmount();
+        newCurrency = expense->getCurrency();
+    }
+
+    // Loop until valid category is entered
+    string categoryInput;
+    cout << "New Category: ";
+    getline(cin, categoryInput);
+    if (!categoryInput.empty()) {
+        while (true) {
+            try {
+                InputValidator::validateCategory(categoryInput);
+                newCategory = categoryInput;
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+                cout << "New Category: ";
+                getline(cin, categoryInput);
+                if (categoryInput.empty()) break;
+            }
+        }
+    }
+
+    // Loop until valid date is entered
+    string dateInput;
+    cout << "New Date (YYYY-MM-DD): ";
+    getline(cin, dateInput);
+    if (!dateInput.empty()) {
+        while (true) {
+            try {
+                int dayNumber = InputValidator::toDayNumber(dateInput);
+
+                // Check if date is in the future
+                if (dayNumber > DateUtil::today()) {
+                    throw std::invalid_argument("Date cannot be in the future.");
+                }
+
+                newDate = dateInput;
+                break; // Exit loop on valid input
+            } catch (const std::exception& e) {
+                cout << "Error: " << e.what() << "\nPlease try again.\n";
+                cout << "New Date (YYYY-MM-DD): ";
+                getline(cin, dateInput);
+                if (dateInput.empty()) break;
+            }
+        }
+    }
+
+    // Tags: blank keeps the current ones, '-' clears them
+    uint64_t newTags = expense->getTags();
+    string tagInput;
+    cout << "New Tags (comma separated, '-' for none): ";
+    getline(cin, tagInput);
+    while (!tagInput.empty()) {
+        string error;
+        if (parseTags(user, tagInput, newTags, error)) {
+            break;
+        }
+        newTags = expense->getTags();
+        cout << "Error: " << error << "\nPlease try again.\n";
+        cout << "New Tags (comma separated, '-' for none): ";
+        getline(cin, tagInput);
+    }
+
+    // Update expense details
+    user.modifyExpense(*expense, newAmount, newCurrency, newCategory, newDate);
+    if (newTags != expense->getTags()) {
+        user.setExpenseTags(*expense, newTags);
+    }
+
+    cout << "\n> Expense modified successfully!" << endl;
+    cout << "Updated Details:" << endl;
+    cout << "Amount: " << expense->getAmount() << endl;
+    cout << "Currency: " << currencyName(user, expense->getCurrency()) << endl;
+    cout << "Category: " << expense->getCategory() << endl;
+    cout << "Date: " << expense->getDate() << endl;
+    cout << "Tags: " << user.getTagDictionary().describe(expense->getTags()) << endl;
+    printAnomaly(user, *expense);
+    printBudgetAlerts(user);
+
+    // Display current budget
+
+    // Prompt for additional modifications
+    char modChoice;
+    do {
+        cout << "\n> Modify another expense? (Y/N): ";
+        cin >> modChoice;
+        if (tolower(modChoice) != 'y' && tolower(modChoice) != 'n') {
+            cout << "Invalid Answer!\n";
+        }
+        if (tolower(modChoice) == 'y') {
+            return true;
+        }
+    } while (tolower(modChoice) != 'y' && tolower(modChoice) != 'n');
+    
+    if(tolower(modChoice) == 'n') {
+        cout << endl << "> Redirecting to the main menu ..." << endl;
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+    }
+    return false;
+}
+
+    void removeExpense(User& user, BudgetManager& budgetManager) {
+        while (removeExpenseOnce(user, budgetManager)) {
+        }
+    }
+
+    // One pass of the flow; true when the user asked to remove another expense
+    bool removeExpenseOnce(User& user, BudgetManager& budgetManager) {
+    	system("cls");
+    	int choice;
+    	string menuTitle = "REMOVE EXPENSE";
+        printHeader(menuTitle);
+
+		if (!user.hasExpenses()) {
+        cout << "\n> You do not have any expense entries yet." << endl;
+        cout << "> Redirecting to the main menu..." << endl;
+        system("pause");
+        return false;
+    	}
+	    
+		if (!handleExpensesView(user)) {
+		    return false;
+		}
+		expensesView(user, totalExpenses);
+
+ 		// Prompt for ID
+	    int expenseIdToDelete;
+	    cout << "\n> Enter the ID of the expense you want to delete (or '0' to cancel): ";
+	    cin >> expenseIdToDelete;
+	    
+	    if (expenseIdToDelete == 0) {
+	        return false;
+	    }
+	
+	    // Locate the expense by its id
+	    shared_ptr<Expense> expense = user.findExpense(expenseIdToDelete);
+	
+	    if (!expense) {
+	        cout << "\n> Expense ID not found. Returning to main menu..." << endl;
+	        system("pause");
+	        return false;
+	    }
+	
+	    // Display the expense details
+	    cout << "\nExpense Details:" << endl;
+	    cout << "ID: " << expense->getId() << endl;
+	    cout << "Amount: " << expense->getAmount() << endl;
+	    cout << "Category: " << expense->getCategory() << endl;
+	    cout << "Date: " << expense->getDate() << endl;
+	
+	    // Confirm deletion
+	    char deleteChoice;
+	    cout << "\n> Delete this expense? (Y/N): ";
+	    cin >> deleteChoice;
+	
+	    if (tolower(deleteChoice) == 'y') {
+	        user.removeExpense(expenseIdToDelete);
+	        cout << "\n> Expense deleted successfully!" << endl;
+	    } else {
+	        cout << "\n> Deletion canceled." << endl;
+	    }
+	
+	    // Display current budget
+	    cout << "\nCURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
+	
+	    // Prompt for additional deletions
+	    char delChoice;
+	    do {
+		    cout << "\n> Delete another expense? (Y/N): ";
+		    cin >> delChoice;
+		    if (tolower(delChoice) != 'y' && tolower(delChoice) != 'n') {
+				cout << "Invalid Answer!\n";
+			}
+		    if (tolower(delChoice) == 'y') {
+		        return true;
+		    }
+		} while (tolower(delChoice) != 'y' && tolower(delChoice) != 'n');
+		
+		if(tolower(delChoice) == 'n') {
+	        cout << endl << "\n> Redirecting to the main menu ..." << endl;
+	        cout << "> Press any key to continue ...";
+	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	        cin.get();
+		}
+	    return false;
+	}
+
+    // Changes or deletes every expense matching a filter in one pass
+    void bulkEditExpenses(User& user, BudgetManager& budgetManager) {
+        system("cls");
+        string menuTitle = "BULK EDIT EXPENSES";
+        printHeader(menuTitle);
+
+        if (!user.hasExpenses()) {
+            cout << "> You do not have any expense entries yet." << endl;
+            cout << "> Redirecting to the main menu..." << endl;
+            system("pause");
+            return;
+        }
+        cout << "> Select the expenses to change." << endl;
+        cout << "> Input 'x' to cancel anytime." << endl;
+
+        ExpenseFilter filter;
+        string category;
+        cout << "\nCATEGORY (or '*' for any): ";
+        cin >> category;
+        if (category == "x" || category == "X") {
+            return;
+        }
+        if (category != "*") {
+            filter.categoryLower = InputValidator::toLowerCase(category);
+        }
+        if (askYesNo("> Limit to a date range? (Y/N): ")
+            && (!promptDate("FROM (YYYY-MM-DD): ", filter.fromDay) || !promptDate("TO (YYYY-MM-DD): ", filter.toDay))) {
+            return;
+        }
+        if (askYesNo("> Limit to an amount range? (Y/N): ")
+            && (!promptAmount("MIN AMOUNT: ", filter.minAmount) || !promptAmount("MAX AMOUNT: ", filter.maxAmount))) {
+            return;
+        }
+
+        cout << "\n> Select the action to apply:" << endl;
+        cout << "1 - Set category\n";
+        cout << "2 - Adjust amount\n";
+        cout << "3 - Delete\n";
+        cout << "CHOICE: ";
+        int choice;
+        UserInterface::validateNumericInput(choice, 1, 3);
+
+        BulkAction action = BulkAction::Delete;
+        string newCategory;
+        double amountDelta = 0;
+        if (choice == 1) {
+            action = BulkAction::SetCategory;
+            while (true) {
+                cout << "NEW CATEGORY: ";
+                cin >> newCategory;
+                if (newCategory == "x" || newCategory == "X") {
+                    return;
+                }
+                try {
+                    InputValidator::validateCategory(newCategory);
+                    break;
+                } catch (const std::exception& e) {
+                    cout << "Error: " << e.what() << "\nPlease try again.\n";
+                }
+            }
+        } else if (choice == 2) {
+            action = BulkAction::AdjustAmount;
+            while (true) {
+                string input;
+                cout << "ADJUST BY (e.g. 5 or -5): ";
+                cin >> input;
+                if (input == "x" || input == "X") {
+                    return;
+                }
+                bool negative = !input.empty() && input[0] == '-';
+                try {
+                    amountDelta = InputValidator::toAmount(negative ? input.substr(1) : input);
+                    if (negative) {
+                        amountDelta = -amountDelta;
+                    }
+                    break;
+                } catch (const std::exception& e) {
+                    cout << "Error: " << e.what() << "\nPlease try again.\n";
+                }
+            }
+            // The same checks as modifying one expense, for the whole batch or none of it
+            User::BulkAdjustment preview = user.previewAdjustment(filter, amountDelta);
+            string refusal;
+            if (preview.nonPositive > 0) {
+                refusal = to_string(preview.nonPositive) + " expense(s) would no longer have a positive amount.";
+            } else if (preview.addedSpend > 0 && preview.addedSpend > budgetManager.getRemainingBudget()) {
+                refusal = "Insufficient Budget! Cannot exceed the available budget.";
+            }
+            if (!refusal.empty()) {
+                cout << "\nError: " << refusal << " No expenses were changed." << endl;
+                system("pause");
+                return;
+            }
+        } else if (!askYesNo("> Delete every matching expense? (Y/N): ")) {
+            cout << "\n> Deletion canceled." << endl;
+            system("pause");
+            return;
+        }
+
+        size_t affected = user.bulkEdit(filter, action, newCategory, amountDelta);
+        cout << "\n> " << affected << " expense(s) " << (action == BulkAction::Delete ? "deleted." : "updated.") << endl;
+        cout << "\nREMAINING BUDGET: " << budgetManager.getRemainingBudget() << endl;
+        printBudgetAlerts(user);
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+    }
+
+    // Rules for expenses that repeat, e.g. rent on the 1st of every month
+    void manageRecurringExpenses(User& user) {
+        while (true) {
+            system("cls");
+            string menuTitle = "RECURRING EXPENSES";
+            printHeader(menuTitle);
+
+            const auto& rules = user.getRecurring().getRules();
+            int today = DateUtil::today();
+            int monthStart = DateUtil::periodStart(BudgetPeriod::Monthly, today);
+            cout << "\n-------------------------------------------------------------------------\n";
+            cout << "ID\tAMOUNT\tCATEGORY\tREPEATS\t\t\tFROM\t\tUNTIL\n";
+            cout << "-------------------------------------------------------------------------\n";
+            for (const auto& rule : rules) {
+                cout << "R" << rule.id << "\t"
+                     << setw(7) << rule.amount << "\t"
+                     << setw(10) << rule.category << "\t"
+                     << left << setw(20) << RecurringSchedule::describe(rule) << right << "\t"
+                     << DateUtil::toString(rule.startDay) << "\t"
+                     << (rule.endDay == numeric_limits<int>::max() ? "-" : DateUtil::toString(rule.endDay)) << endl;
+            }
+            if (rules.empty()) {
+                cout << "> No recurring expenses yet.\n";
+            } else {
+                cout << "\nDUE THIS MONTH SO FAR: " << user.getRecurring().total(monthStart, today) << endl;
+            }
+
+            cout << "\n1 - Add a recurring expense\n";
+            cout << "2 - Remove a recurring expense\n";
+            cout << "3 - Back to main menu\n";
+            cout << "CHOICE: ";
+            int choice;
+            UserInterface::validateNumericInput(choice, 1, 3);
+            if (choice == 3) {
+                return;
+            }
+
+            cout << "> Input 'x' to cancel." << endl;
+            if (choice == 1) {
+                double amount;
+                string category;
+                int startDay, endDay = numeric_limits<int>::max();
+                if (!promptAmount("\nAMOUNT: ", amount)) {
+                    continue;
+                }
+                cout << "CATEGORY: ";
+                cin >> category;
+                if (category == "x" || category == "X") {
+                    continue;
+                }
+                if (!promptDate("FIRST DATE (YYYY-MM-DD): ", startDay)) {
+                    continue;
+                }
+                cout << "REPEATS (1 - Daily, 2 - Weekly, 3 - Monthly, 4 - Yearly): ";
+                int unit, interval;
+                UserInterface::validateNumericInput(unit, 1, 4);
+                cout << "EVERY HOW MANY (1 - 365): ";
+                UserInterface::validateNumericInput(interval, 1, 365);
+                if (askYesNo("> Does it end? (Y/N): ")) {
+                    if (!promptDate("LAST DATE (YYYY-MM-DD): ", endDay)) {
+                        continue;
+                    }
+                    if (endDay < startDay) {
+                        cout << "\n> Error: The last date is before the first one." << endl;
+                        system("pause");
+                        continue;
+                    }
+                }
+                int id = user.addRecurring(amount, category, startDay, endDay, static_cast<RecurrenceUnit>(unit - 1), interval);
+                cout << "\n> Recurring expense R" << id << " added. It shows in views and reports as it comes due." << endl;
+            } else {
+                string input;
+                cout << "\nRULE ID (e.g. R1): ";
+                cin >> input;
+                if (input == "x" || input == "X") {
+                    continue;
+                }
+                int id = 0;
+                try {
+                    id = stoi(input[0] == 'R' || input[0] == 'r' ? input.substr(1) : input);
+                } catch (const std::exception&) {
+                    // not a number; no rule has id 0
+                }
+                if (user.removeRecurring(id)) {
+                    cout << "\n> Recurring expense R" << id << " removed." << endl;
+                } else {
+                    cout << "\n> No recurring expense with that ID." << endl;
+                }
+            }
+            system("pause");
+        }
+    }
+
+    void importExpenses(User& user, BudgetManager& budgetManager) {
+        system("cls");
+        string menuTitle = "IMPORT EXPENSES";
+        printHeader(menuTitle);
+        cout << "> Each line of the file must read: amount,category,date (YYYY-MM-DD), optionally followed by a currency code." << endl;
+        cout << "> Input 'x' to cancel." << endl;
+
+        string path;
+        cout << "\nFILE PATH: ";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        getline(cin, path);
+        if (path == "x" || path == "X") {
+            cout << "> Operation canceled. Redirecting to main menu..." << endl;
+            system("pause");
+            return;
+        }
+
+        char skip;
+        do {
+            cout << "> Skip expenses that are already recorded? (Y/N): ";
+            cin >> skip;
+        } while (tolower(skip) != 'y' && tolower(skip) != 'n');
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+        size_t flaggedBefore = user.getAnomalies().size();
+        ImportResult result = ExpenseImporter::importFile(user, path, tolower(skip) == 'y');
+        if (!result.opened) {
+            cout << "\n> Error: Unable to open '" << path << "'." << endl;
+        } else {
+            cout << "\n> Imported " << result.imported << " expense(s), rejected " << result.rejected
+                 << " line(s) in " << result.elapsedMs << " ms using " << result.workers << " parser thread(s)." << endl;
+            for (const auto& error : result.errors) {
+                cout << "  " << error << endl;
+            }
+            if (result.rejected > result.errors.size()) {
+                cout << "  ..." << endl;
+            }
+            if (result.duplicates > 0) {
+                cout << "> " << result.duplicates << " line(s) matched an expense already recorded"
+                     << (tolower(skip) == 'y' ? " and were skipped." : "; they were imported anyway.") << endl;
+            }
+            if (user.getAnomalies().size() > flaggedBefore) {
+                cout << "> " << user.getAnomalies().size() - flaggedBefore
+                     << " imported expense(s) look unusual for their category; see the unusual expenses report." << endl;
+            }
+            cout << "\nREMAINING BUDGET: " << budgetManager.getRemainingBudget() << endl;
+            printBudgetAlerts(user);
+        }
+        cout << "> Press any key to continue ...";
+        cin.get();
+    }
+
+    void checkBudget(const User& user) const {}
+	
+    void generateReport(User& user, BudgetManager& budgetManager) {
+        while (generateReportOnce(user, budgetManager)) {
+        }
+    }
+
+    // One pass of the flow; true when the user asked to generate another report
+    bool generateReportOnce(User& user, BudgetManager& budgetManager){ 
+    	system("cls");
+    	string menuTitle = "EXPENSE REPORT";
+        printHeader(menuTitle);
+        
+        if (!user.hasExpenses() && !user.hasRecurring()) {
+        cout << "\n> You do not have any expense entries yet." << endl;
+        cout << "> Redirecting to main menu." << endl;
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+        return false;
+    	}
+    
+	    int reportType = selectReportType(true);
+	    if (reportType == 0) {
+	        return false;
+	    }
+
+	    if (reportType == 7) {
+	        reportAsOf(user);
+	    } else if (reportType == 8) {
+	        exportExpenses(user);
+	    } else {
+	        runReport(user, reportType);
+	    }
+	    cout << "CURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
+
+	    ResultCacheStats cacheStats = user.getResultCache().getStats();
+	    cout << "\n> Report cache: " << fixed << setprecision(1) << cacheStats.hitRate() << "% hit rate ("
+	         << cacheStats.hits << " hits, " << cacheStats.misses << " misses), "
+	         << cacheStats.entries << " entries, " << (cacheStats.bytes + 1023) / 1024 << " of "
+	         << cacheStats.capacity / 1024 << " KB" << defaultfloat << setprecision(6) << endl;
+	    
+	    char mainChoice;
+	    do {
+		    cout << "\n> Return to main menu? (Y/N): ";
+	    	cin >> mainChoice;
+		    if (tolower(mainChoice) != 'y' && tolower(mainChoice) != 'n') {
+				cout << "\n> Invalid Answer!\n";
+			}
+		    if (tolower(mainChoice) == 'n') {
+		    	return true;
+		    }
+		} while (tolower(mainChoice) != 'y' && tolower(mainChoice) != 'n');
+		
+		if(tolower(mainChoice) == 'y') {
+	        cout << endl << "\n> Redirecting to the main menu ..." << endl;
+	        cout << "> Press any key to continue ...";
+	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+	        cin.get();
+		}
+	    return false;
+	}
+
+    void runReport(const User& user, int reportType) {
+	    if (reportType == 1) {
+		    // Display filtered expenses and calculate total
+		    double totalExpenses = 0;
+		    
+		    // Call expensesView and calculate total expenses
+		    if (handleExpensesView(user)) {
+		        expensesView(user, totalExpenses);
+		        cout << "\nTOTAL EXPENSE: " << totalExpenses << endl;
+		    }
+	    } else if (reportType == 2) {
+	        reportDateRange(user);
+	    } else if (reportType == 3) {
+	        reportLargestExpenses(user);
+	    } else if (reportType == 4) {
+	        reportCategoryPercentiles(user);
+	    } else if (reportType == 5) {
+	        reportTopCategories(user);
+	    } else if (reportType == 6) {
+	        reportAnomalies(user);
+	    }
+    }
+
+    // Any other report run on the data as it stood at a past moment
+    void reportAsOf(const User& user) {
+        long long instant;
+        int dayNumber;
+        if (!promptInstant("AS OF (YYYY-MM-DD, or YYYY-MM-DD HH:MM): ", instant, dayNumber)) {
+            return;
+        }
+        unique_ptr<User> past = user.asOf(instant);
+        cout << "\n> As of then you had " << past->getExpenseCount() << " expense(s) and "
+             << past->getRemainingBudget(dayNumber) << " left of your " << DateUtil::periodName(past->getBudgetPeriod())
+             << " budget of " << past->getBudget() << ".\n" << endl;
+
+        int reportType = selectReportType(false);
+        if (reportType != 0) {
+            runReport(*past, reportType);
+        }
+    }
+
+    // Writes the user's expenses as an Arrow IPC stream for offline analysis
+    void exportExpenses(const User& user) {
+        string path;
+        cout << "\nEXPORT FILE (e.g. expenses.arrow): ";
+        cin >> path;
+        if (path == "x" || path == "X") {
+            return;
+        }
+        auto started = chrono::steady_clock::now();
+        ArrowExporter exporter;
+        exporter.beginUser(user.getUsername(), user.getBaseCurrency());
+        user.forEachExpense([&exporter](const shared_ptr<Expense>& expense) { exporter.add(*expense); });
+        size_t bytes = 0;
+        if (!exporter.write(path, bytes)) {
+            cout << "\n> Could not write " << path << "." << endl;
+            return;
+        }
+        cout << "\n> Exported " << exporter.rowCount() << " expense(s) to " << path << " (" << (bytes + 1023) / 1024
+             << " KB) in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count()
+             << " ms.\n" << endl;
+    }
+
+    // Total between any two dates, answered from the user's daily spend index
+    void reportDateRange(const User& user) {
+        int fromDay, toDay;
+        if (!promptDate("FROM DATE (YYYY-MM-DD): ", fromDay) || !promptDate("TO DATE (YYYY-MM-DD): ", toDay)) {
+            return;
+        }
+        if (fromDay > toDay) {
+            swap(fromDay, toDay);
+        }
+        cout << "\n> Total spent from " << DateUtil::toString(fromDay) << " to " << DateUtil::toString(toDay) << ":" << endl;
+        cout << "\nTOTAL EXPENSE: " << user.getSpendBetween(fromDay, toDay) << endl;
+    }
+
+    // Largest N expenses of a period, kept in a bounded min-heap instead of sorting everything
+    void reportLargestExpenses(const User& user) {
+        int count, fromDay, toDay;
+        cout << "\n> How many expenses to list (1 - 100): ";
+        UserInterface::validateNumericInput(count, 1, 100);
+        selectReportPeriod(fromDay, toDay);
+
+        double unused = 0;
+        string key = "report:largest:" + to_string(count) + ":" + to_string(fromDay) + ":" + to_string(toDay);
+        cachedRender(user, key, unused, [&](ostream& out, double&) {
+            typedef pair<double, const Expense*> Entry;
+            priority_queue<Entry, vector<Entry>, greater<Entry>> largest;
+            auto offer = [&](double amount, const Expense* expense) {
+                if (static_cast<int>(largest.size()) < count) {
+                    largest.emplace(amount, expense);
+                } else if (amount > largest.top().first) {
+                    largest.pop();
+                    largest.emplace(amount, expense);
+                }
+            };
+
+            // Rows are converted to the base currency a chunk at a time, so memory stays bounded
+            // however many fall in the period
+            const size_t CHUNK_ROWS = 4096;
+            vector<shared_ptr<Expense>> chunk;
+            chunk.reserve(CHUNK_ROWS);
+            auto flush = [&]() {
+                vector<double> amounts = user.toBase(chunk);
+                for (size_t i = 0; i < chunk.size(); ++i) {
+                    offer(amounts[i], chunk[i].get());
+                }
+                chunk.clear();
+            };
+            user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+                int dayNumber;
+                if (DateUtil::toDayNumber(expense->getDate(), dayNumber) && dayNumber >= fromDay && dayNumber <= toDay) {
+                    chunk.push_back(expense);
+                    if (chunk.size() == CHUNK_ROWS) {
+                        flush();
+                    }
+                }
+            });
+            flush();
+
+            // A rule's occurrences all have the same amount, so only its latest `count` can place
+            vector<DetailedExpense> occurrences;
+            user.forEachRecurringCount(fromDay, toDay, [&](const RecurringSchedule::Rule& rule, long long due) {
+                long long first, last;
+                RecurringSchedule::occurrenceRange(rule, fromDay, min(toDay, DateUtil::today()), first, last);
+                for (long long index = last - min<long long>(due, count); index < last; ++index) {
+                    occurrences.push_back(RecurringSchedule::occurrence(rule, static_cast<int>(RecurringSchedule::occurrenceDay(rule, index))));
+                }
+            });
+            for (const DetailedExpense& occurrence : occurrences) {
+                offer(occurrence.getAmount(), &occurrence);
+            }
+
+            vector<Entry> rows;
+            while (!largest.empty()) {
+                rows.push_back(largest.top());
+                largest.pop();
+            }
+            out << "\n-------------------------------------------------------\n";
+            out << "ID\tAMOUNT\tCATEGORY\tDATE\n";
+            out << "-------------------------------------------------------\n";
+            for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+                out << setw(5) << ExpenseViewStrategy::rowId(*it->second) << "\t"
+                    << setw(7) << it->first << "\t"
+                    << setw(10) << it->second->getCategory() << "\t"
+                    << it->second->getDate() << ExpenseViewStrategy::originalAmount(user, *it->second) << endl;
+            }
+            if (rows.empty()) {
+                out << "> No expenses made in this period.\n";
+            }
+        });
+    }
+
+    // Median and p90 expense per category, merged from the monthly sketches
+    void reportCategoryPercentiles(const User& user) {
+        int fromDay, toDay;
+        selectReportPeriod(fromDay, toDay);
+
+        double unused = 0;
+        string key = "report:percentiles:" + to_string(fromDay) + ":" + to_string(toDay);
+        cachedRender(user, key, unused, [&](ostream& out, double&) {
+            auto sketches = user.getCategoryStats().sketches(CategoryStatsIndex::monthKeyOf(fromDay),
+                                                             CategoryStatsIndex::monthKeyOf(toDay));
+            user.forEachRecurringCount(fromDay, toDay, [&](const RecurringSchedule::Rule& rule, long long due) {
+                sketches[InputValidator::toLowerCase(rule.category)].add(rule.amount, due);
+            });
+
+            out << "\n-------------------------------------------------------\n";
+            out << "CATEGORY\tCOUNT\tMEDIAN\tP90\n";
+            out << "-------------------------------------------------------\n";
+            for (const auto& category : sketches) {
+                out << setw(10) << user.getCategoryNames().displayName(category.first) << "\t"
+                    << category.second.count() << "\t"
+                    << category.second.quantile(0.5) << "\t"
+                    << category.second.quantile(0.9) << endl;
+            }
+            if (sketches.empty()) {
+                out << "> No expenses made in this period.\n";
+            }
+        });
+    }
+
+    // Categories with the highest spend in a period, selected with a bounded heap
+    void reportTopCategories(const User& user) {
+        int count, fromDay, toDay;
+        cout << "\n> How many categories to list (1 - 100): ";
+        UserInterface::validateNumericInput(count, 1, 100);
+        selectReportPeriod(fromDay, toDay);
+
+        double unused = 0;
+        string key = "report:top:" + to_string(count) + ":" + to_string(fromDay) + ":" + to_string(toDay);
+        cachedRender(user, key, unused, [&](ostream& out, double&) {
+            typedef pair<double, string> Entry;
+            priority_queue<Entry, vector<Entry>, greater<Entry>> top;
+            unordered_map<string, double> totals;
+            for (auto& category : user.getCategoryStats().totals(CategoryStatsIndex::monthKeyOf(fromDay),
+                                                                 CategoryStatsIndex::monthKeyOf(toDay))) {
+                totals[category.first] += category.second;
+            }
+            user.forEachRecurringCount(fromDay, toDay, [&](const RecurringSchedule::Rule& rule, long long due) {
+                totals[InputValidator::toLowerCase(rule.category)] += due * rule.amount;
+            });
+            for (auto& category : totals) {
+                top.emplace(category.second, category.first);
+                if (static_cast<int>(top.size()) > count) {
+                    top.pop();
+                }
+            }
+
+            vector<Entry> rows;
+            while (!top.empty()) {
+                rows.push_back(top.top());
+                top.pop();
+            }
+            out << "\n---------------------------------\n";
+            out << "CATEGORY\tTOTAL\n";
+            out << "---------------------------------\n";
+            for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+                out << setw(10) << user.getCategoryNames().displayName(it->second) << "\t" << it->first << endl;
+            }
+            if (rows.empty()) {
+                out << "> No expenses made in this period.\n";
+            }
+        });
+    }
+
+    // Expenses flagged on entry or change, most unusual first; nothing is recomputed here
+    void reportAnomalies(const User& user) {
+        double unused = 0;
+        cachedRender(user, "report:anomalies", unused, [&](ostream& out, double&) {
+            vector<pair<const ExpenseAnomaly*, shared_ptr<Expense>>> rows;
+            for (const auto& flagged : user.getAnomalies()) {
+                if (auto expense = user.findExpense(flagged.first)) {
+                    rows.emplace_back(&flagged.second, expense);
+                }
+            }
+            sort(rows.begin(), rows.end(), [](const pair<const ExpenseAnomaly*, shared_ptr<Expense>>& a,
+                                               const pair<const ExpenseAnomaly*, shared_ptr<Expense>>& b) {
+                return a.first->zScore > b.first->zScore;
+            });
+
+            out << "\n> Expenses at least " << CategoryMoments::Z_THRESHOLD
+                << " standard deviations above their category's average when entered:\n";
+            out << "\n-----------------------------------------------------------------------\n";
+            out << "ID\tAMOUNT\tCATEGORY\tDATE\t\tAVERAGE\tZ-SCORE\n";
+            out << "-----------------------------------------------------------------------\n";
+            for (const auto& row : rows) {
+                out << setw(5) << row.second->getId() << "\t"
+                    << setw(7) << user.toBase(*row.second) << "\t"
+                    << setw(10) << row.second->getCategory() << "\t"
+                    << row.second->getDate() << "\t"
+                    << fixed << setprecision(2) << row.first->categoryMean << "\t"
+                    << setprecision(1) << row.first->zScore << defaultfloat << setprecision(6) << endl;
+            }
+            if (rows.empty()) {
+                out << "> No unusual expenses found.\n";
+            }
+        });
+    }
+
+//------------------ HELPER FUNCTIONS ----------------------
+
+	// Month-aligned report periods as an inclusive day-number window
+	void selectReportPeriod(int& fromDay, int& toDay) const {
+	    cout << "\n> Select the period:" << endl;
+	    cout << "1 - This month\n";
+	    cout << "2 - This year\n";
+	    cout << "3 - All time\n";
+	    cout << "CHOICE: ";
+	    int period;
+	    UserInterface::validateNumericInput(period, 1, 3);
+
+	    int year, month, day;
+	    DateUtil::fromDayNumber(DateUtil::today(), year, month, day);
+	    if (period == 1) {
+	        fromDay = DateUtil::toDayNumber(year, month, 1);
+	        toDay = (month == 12 ? DateUtil::toDayNumber(year + 1, 1, 1) : DateUtil::toDayNumber(year, month + 1, 1)) - 1;
+	    } else if (period == 2) {
+	        fromDay = DateUtil::toDayNumber(year, 1, 1);
+	        toDay = DateUtil::toDayNumber(year, 12, 31);
+	    } else {
+	        fromDay = DateUtil::toDayNumber(0, 1, 1);
+	        toDay = DateUtil::toDayNumber(9999, 12, 31);
+	    }
+	}
+
+	// Returns the chosen report type, or 0 when canceled
+	int selectReportType(bool allowAsOf) const {
+	    const char lastType = allowAsOf ? '8' : '6';
+	    while (true) {
+	        cout << "> Select the type of report to generate:" << endl;
+	        cout << "> Input 'x' to cancel anytime." << endl;
+	        cout << "1 - Expenses by display type\n";
+	        cout << "2 - Total between two dates\n";
+	        cout << "3 - Largest expenses\n";
+	        cout << "4 - Median and P90 expense per category\n";
+	        cout << "5 - Top categories by spend\n";
+	        cout << "6 - Unusual expenses\n";
+	        if (allowAsOf) {
+	            cout << "7 - Any of the above as of a past date\n";
+	            cout << "8 - Export all expenses to an Arrow file\n";
+	        }
+	        cout << "CHOICE: ";
+
+	        string input;
+	        cin >> input;
+	        if (input == "x" || input == "X") {
+	            return 0;
+	        }
+	        if (input.size() == 1 && input[0] >= '1' && input[0] <= lastType) {
+	            return input[0] - '0';
+	        }
+	        cout << "Invalid choice! Please enter a number between 1 and " << lastType << ".\n";
+	    }
+	}
+
+	// Reads a YYYY-MM-DD date as a day number; false when canceled with 'x'
+	bool promptDate(const string& label, int& dayNumber) const {
+	    while (true) {
+	        string date;
+	        cout << label;
+	        cin >> date;
+	        if (date == "x" || date == "X") {
+	            return false;
+	        }
+	        try {
+	            dayNumber = InputValidator::toDayNumber(date);
+	            return true;
+	        } catch (const std::exception& e) {
+	            cout << "Error: " << e.what() << "\nPlease try again.\n";
+	        }
+	    }
+	}
+
+	// Reads a local date, optionally with a time, as the last millisecond it covers; false when canceled with 'x'
+	bool promptInstant(const string& label, long long& instant, int& dayNumber) const {
+	    while (true) {
+	        string input;
+	        cout << label;
+	        cin >> ws;
+	        getline(cin, input);
+	        if (input == "x" || input == "X") {
+	            return false;
+	        }
+	        int hour = 23, minute = 59;
+	        bool timeValid = input.size() == 10
+	            || (input.size() == 16 && input[10] == ' ' && input[13] == ':' && sscanf(input.c_str() + 11, "%d:%d", &hour, &minute) == 2
+	                && hour >= 0 && hour < 24 && minute >= 0 && minute < 60);
+	        try {
+	            if (!timeValid) {
+	                throw std::invalid_argument("Time must be written as HH:MM.");
+	            }
+	            dayNumber = InputValidator::toDayNumber(input.substr(0, 10));
+	            int year, month, day;
+	            DateUtil::fromDayNumber(dayNumber, year, month, day);
+	            tm local = {};
+	            local.tm_year = year - 1900;
+	            local.tm_mon = month - 1;
+	            local.tm_mday = day;
+	            local.tm_hour = hour;
+	            local.tm_min = minute;
+	            local.tm_sec = 59;
+	            local.tm_isdst = -1;
+	            instant = static_cast<long long>(mktime(&local)) * 1000 + 999;
+	            return true;
+	        } catch (const std::exception& e) {
+	            cout << "Error: " << e.what() << "\nPlease try again.\n";
+	        }
+	    }
+	}
+
+	// Reads a non-negative amount; false when canceled with 'x'
+	bool promptAmount(const string& label, double& amount) const {
+	    while (true) {
+	        string input;
+	        cout << label;
+	        cin >> input;
+	        if (input == "x" || input == "X") {
+	            return false;
+	        }
+	        try {
+	            amount = InputValidator::toAmount(input);
+	            return true;
+	        } catch (const std::exception& e) {
+	            cout << "Error: " << e.what() << "\nPlease try again.\n";
+	        }
+	    }
+	}
+
+	// A three-letter currency code, '-' for the base currency; false when canceled
+	bool promptCurrency(const string& label, uint16_t& currency) const {
+	    while (true) {
+	        string input;
+	        cout << label;
+	        cin >> input;
+	        if (input == "x" || input == "X") {
+	            return false;
+	        }
+	        if (input == "-") {
+	            currency = CurrencyCode::BASE;
+	            return true;
+	        }
+	        if (CurrencyCode::parse(input, currency)) {
+	            return true;
+	        }
+	        cout << "Error: Currency must be a three-letter code.\nPlease try again.\n";
+	    }
+	}
+
+	string currencyName(const User& user, uint16_t currency) const {
+	    string name = CurrencyCode::toString(currency == CurrencyCode::BASE ? user.getBaseCurrency() : currency);
+	    return name.empty() ? "base" : name;
+	}
+
+	// Interns a comma separated tag list ('-' for none) into a tag bitset
+	bool parseTags(User& user, const string& input, uint64_t& tags, string& error) const {
+	    tags = 0;
+	    if (input == "-") {
+	        return true;
+	    }
+	    stringstream list(input);
+	    string name;
+	    while (getline(list, name, ',')) {
+	        if (name.empty()) {
+	            continue;
+	        }
+	        if (!TagDictionary::isValidName(name)) {
+	            error = "Tags can only contain letters, numbers, '-' and '_', and cannot be and, or or not.";
+	            return false;
+	        }
+	        int tag = user.internTag(name);
+	        if (tag < 0) {
+	            error = "No more than " + to_string(TagDictionary::MAX_TAGS) + " different tags are supported.";
+	            return false;
+	        }
+	        tags |= uint64_t(1) << tag;
+	    }
+	    return true;
+	}
+
+	// Warns when the expense was flagged as far above its category's usual amount
+	void printAnomaly(const User& user, const Expense& expense) const {
+	    const ExpenseAnomaly* anomaly = user.findAnomaly(expense.getId());
+	    if (anomaly) {
+	        cout << "> WARNING: This is " << fixed << setprecision(1) << anomaly->zScore
+	             << " standard deviations above your usual " << expense.getCategory() << " expense (average "
+	             << setprecision(2) << anomaly->categoryMean << ")." << defaultfloat << setprecision(6) << endl;
+	    }
+	}
+
+	// Shows the budget thresholds crossed by the last change
+	void printBudgetAlerts(User& user) const {
+	    for (const string& alert : user.takeBudgetAlerts()) {
+	        cout << "> ALERT: " << alert << endl;
+	    }
+	}
+
+	bool askYesNo(const string& question) const {
+	    char answer;
+	    do {
+	        cout << question;
+	        cin >> answer;
+	    } while (tolower(answer) != 'y' && tolower(answer) != 'n');
+	    return tolower(answer) == 'y';
+	}
+
+	void printHeader(const string& menuTitle, ostream& out = cout) const {
+    out << "================================================" << endl;
+    out << "           " << menuTitle << "                  " << endl;
+    out << "================================================" << endl;
+	}	
+};
+
+// Fixed set of worker threads; each owns a deque of index ranges and steals from the others when idle
+class WorkStealingPool {
+private:
+    typedef pair<size_t, size_t> Range; // [begin, end)
+    struct WorkQueue {
+        mutex lock;
+        deque<Range> ranges;
+    };
+
+    vector<unique_ptr<WorkQueue>> queues;
+    vector<thread> threads;
+    mutex jobLock;
+    condition_variable jobReady;
+    condition_variable jobDone;
+    const function<void(size_t, size_t, size_t)>* body = nullptr;
+    atomic<size_t> remainingRanges;
+    size_t generation = 0;
+    size_t busyWorkers = 0;
+    bool stopping = false;
+
+    // Own work is taken LIFO from the back, stolen work FIFO from the front of a victim
+    bool takeRange(size_t worker, Range& range) {
+        {
+            lock_guard<mutex> guard(queues[worker]->lock);
+            if (!queues[worker]->ranges.empty()) {
+                range = queues[worker]->ranges.back();
+                queues[worker]->ranges.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkQueue& victim = *queues[(worker + offset) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.ranges.empty()) {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t worker) {
+        size_t seenGeneration = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(jobLock);
+                jobReady.wait(guard, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
                 }
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
-                cout << "New Amount: ";
-                getline(cin, amountInput);
-                if (amountInput.empty()) break;
+                seenGeneration = generation;
+                busyWorkers++;
+            }
+            Range range;
+            while (remainingRanges.load() > 0 && takeRange(worker, range)) {
+                (*body)(range.first, range.second, worker);
+                remainingRanges--;
+            }
+            lock_guard<mutex> guard(jobLock);
+            if (--busyWorkers == 0) {
+                jobDone.notify_all();
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t workerCount = thread::hardware_concurrency())
+        : remainingRanges(0) {
+        workerCount = max<size_t>(1, workerCount);
+        for (size_t i = 0; i < workerCount; ++i) {
+            queues.emplace_back(new WorkQueue());
+        }
+        for (size_t i = 0; i < workerCount; ++i) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            lock_guard<mutex> guard(jobLock);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (auto& worker : threads) {
+            worker.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t size() const { return threads.size(); }
+
+    // Runs work(begin, end, worker) over [0, count) in ranges of at most grain; blocks until done
+    void parallelFor(size_t count, size_t grain, const function<void(size_t, size_t, size_t)>& work) {
+        if (count == 0) {
+            return;
+        }
+        grain = max<size_t>(1, grain);
+        size_t rangeCount = (count + grain - 1) / grain;
+        unique_lock<mutex> guard(jobLock);
+        body = &work;
+        remainingRanges = rangeCount;
+        // Seed each worker with a contiguous share; imbalance is evened out by stealing
+        for (size_t i = 0; i < rangeCount; ++i) {
+            WorkQueue& owner = *queues[i * queues.size() / rangeCount];
+            lock_guard<mutex> queueGuard(owner.lock);
+            owner.ranges.emplace_back(i * grain, min(count, (i + 1) * grain));
+        }
+        generation++;
+        jobReady.notify_all();
+        jobDone.wait(guard, [&] { return remainingRanges.load() == 0 && busyWorkers == 0; });
+        body = nullptr;
+    }
+};
+
+// Expenses shared by a group of users. Every shared expense credits its payer the full amount
+// and debits each participant an equal share, in whole cents, so the members' net balances
+// always sum to zero and are kept up to date on each change instead of being recomputed
+class ExpenseGroup {
+public:
+    struct SharedExpense {
+        int id;
+        uint32_t payer;
+        long long cents;
+        string category;
+        int dayNumber;
+        vector<uint32_t> participants; // empty: the first memberCount members, i.e. everyone at the time
+        uint32_t memberCount;
+    };
+
+    struct Transfer {
+        string from;
+        string to;
+        long long cents;
+    };
+
+    explicit ExpenseGroup(const string& name) : name(name) {}
+
+    const string& getName() const { return name; }
+    const vector<string>& getMembers() const { return members; }
+    bool isMember(const string& username) const { return memberIndex.count(username) > 0; }
+
+    // false when already a member
+    bool addMember(const string& username) {
+        if (!memberIndex.emplace(username, static_cast<uint32_t>(members.size())).second) {
+            return false;
+        }
+        members.push_back(username);
+        balances.push_back(0);
+        return true;
+    }
+
+    // Splits an expense paid by payer among the participants, everyone when there are none;
+    // a participant named twice is counted once. Returns its id, or 0 when the payer or a
+    // participant is not a member
+    int addExpense(const string& payer, double amount, const string& category, int dayNumber,
+                   const vector<string>& participants) {
+        auto paidBy = memberIndex.find(payer);
+        if (paidBy == memberIndex.end()) {
+            return 0;
+        }
+        SharedExpense expense{++lastId, paidBy->second, llround(amount * 100), category, dayNumber, {},
+                              static_cast<uint32_t>(members.size())};
+        for (const auto& participant : participants) {
+            auto found = memberIndex.find(participant);
+            if (found == memberIndex.end()) {
+                --lastId;
+                return 0;
+            }
+            if (find(expense.participants.begin(), expense.participants.end(), found->second)
+                == expense.participants.end()) {
+                expense.participants.push_back(found->second);
+            }
+        }
+        apply(expense, 1);
+        expenses.emplace(lastId, move(expense));
+        return lastId;
+    }
+
+    // Withdraws a shared expense from every balance it touched; only its payer may remove it
+    bool removeExpense(int id, const string& by) {
+        auto found = expenses.find(id);
+        if (found == expenses.end() || members[found->second.payer] != by) {
+            return false;
+        }
+        apply(found->second, -1);
+        expenses.erase(found);
+        return true;
+    }
+
+    // Money handed from one member to another outside any expense, e.g. settling up;
+    // false when either is not a member, they are the same member or the amount is not positive
+    bool recordPayment(const string& from, const string& to, long long cents) {
+        auto payer = memberIndex.find(from);
+        auto payee = memberIndex.find(to);
+        if (payer == memberIndex.end() || payee == memberIndex.end() || payer == payee || cents <= 0) {
+            return false;
+        }
+        balances[payer->second] += cents;
+        balances[payee->second] -= cents;
+        return true;
+    }
+
+    // Net balance in cents, O(1): positive when the member is owed money, negative when they owe
+    long long getBalance(const string& username) const {
+        auto found = memberIndex.find(username);
+        return found == memberIndex.end() ? 0 : balances[found->second];
+    }
+
+    const map<int, SharedExpense>& getExpenses() const { return expenses; }
+
+    /*
+        Transfers that bring every balance to zero. Finding the fewest transfers is NP-hard (it
+        amounts to splitting the balances into as many zero-sum subsets as possible), so:
+            1. a creditor and a debtor with exactly opposite balances settle in one transfer
+            2. the rest is matched greedily, largest debtor paying largest creditor through two
+               heaps; each transfer clears at least one of them, so at most n - 1 transfers
+        O(n log n) in the number of members with a balance.
+    */
+    vector<Transfer> settlementPlan() const {
+        vector<Transfer> plan;
+        typedef pair<long long, uint32_t> Owed; // cents, member
+        unordered_map<long long, vector<uint32_t>> debtorsByAmount;
+        for (uint32_t member = 0; member < balances.size(); ++member) {
+            if (balances[member] < 0) {
+                debtorsByAmount[-balances[member]].push_back(member);
+            }
+        }
+        priority_queue<Owed> creditors, debtors;
+        for (uint32_t member = 0; member < balances.size(); ++member) {
+            if (balances[member] <= 0) {
+                continue;
+            }
+            auto match = debtorsByAmount.find(balances[member]);
+            if (match != debtorsByAmount.end() && !match->second.empty()) {
+                plan.push_back({members[match->second.back()], members[member], balances[member]});
+                match->second.pop_back();
+            } else {
+                creditors.emplace(balances[member], member);
+            }
+        }
+        for (const auto& amount : debtorsByAmount) {
+            for (uint32_t member : amount.second) {
+                debtors.emplace(amount.first, member);
+            }
+        }
+
+        while (!creditors.empty() && !debtors.empty()) {
+            Owed creditor = creditors.top(), debtor = debtors.top();
+            creditors.pop();
+            debtors.pop();
+            long long cents = min(creditor.first, debtor.first);
+            plan.push_back({members[debtor.second], members[creditor.second], cents});
+            if (creditor.first > cents) {
+                creditors.emplace(creditor.first - cents, creditor.second);
+            }
+            if (debtor.first > cents) {
+                debtors.emplace(debtor.first - cents, debtor.second);
+            }
+        }
+        return plan;
+    }
+
+    /*
+        Binary form for the expense store, with ByteCodec scalars: the name, the members with
+        their balances, the last id, then each expense (id, payer, cents, category, day, member
+        count, participants). Balances are stored rather than replayed, since recorded payments
+        only ever change the balances.
+    */
+    void encode(string& out) const {
+        ByteCodec::putString(out, name);
+        ByteCodec::put(out, static_cast<uint32_t>(members.size()));
+        for (size_t member = 0; member < members.size(); ++member) {
+            ByteCodec::putString(out, members[member]);
+            ByteCodec::put(out, static_cast<int64_t>(balances[member]));
+        }
+        ByteCodec::put(out, static_cast<int32_t>(lastId));
+        ByteCodec::put(out, static_cast<uint32_t>(expenses.size()));
+        for (const auto& entry : expenses) {
+            const SharedExpense& expense = entry.second;
+            ByteCodec::put(out, static_cast<int32_t>(expense.id));
+            ByteCodec::put(out, expense.payer);
+            ByteCodec::put(out, static_cast<int64_t>(expense.cents));
+            ByteCodec::putString(out, expense.category);
+            ByteCodec::put(out, static_cast<int32_t>(expense.dayNumber));
+            ByteCodec::put(out, expense.memberCount);
+            ByteCodec::put(out, static_cast<uint32_t>(expense.participants.size()));
+            for (uint32_t participant : expense.participants) {
+                ByteCodec::put(out, participant);
             }
         }
     }
 
-    // Loop until valid category is entered
-    string categoryInput;
-    cout << "New Category: ";
-    getline(cin, categoryInput);
-    if (!categoryInput.empty()) {
-        while (true) {
-            try {
-                InputValidator::validateNotEmpty(categoryInput);
-                // Ensure category doesn't contain numbers or symbols
-                for (char c : categoryInput) {
-                    if (!isalnum(c) && c != ' ') {
-                        throw std::invalid_argument("Category can only contain letters and numbers.");
-                    }
+    // Reads one encoded group; false when the bytes are corrupted
+    static bool decode(const char*& pos, const char* end, ExpenseGroup& group) {
+        uint32_t memberCount, expenseCount;
+        int32_t lastId;
+        if (!ByteCodec::getString(pos, end, group.name) || !ByteCodec::get(pos, end, memberCount)
+            || memberCount > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        for (uint32_t member = 0; member < memberCount; ++member) {
+            string username;
+            int64_t balance;
+            if (!ByteCodec::getString(pos, end, username) || !ByteCodec::get(pos, end, balance)
+                || !group.addMember(username)) {
+                return false;
+            }
+            group.balances.back() = balance;
+        }
+        if (!ByteCodec::get(pos, end, lastId) || !ByteCodec::get(pos, end, expenseCount)
+            || expenseCount > static_cast<uint64_t>(end - pos)) {
+            return false;
+        }
+        group.lastId = lastId;
+        for (uint32_t i = 0; i < expenseCount; ++i) {
+            SharedExpense expense{0, 0, 0, "", 0, {}, 0};
+            int32_t id, dayNumber;
+            int64_t cents;
+            uint32_t participantCount;
+            if (!ByteCodec::get(pos, end, id) || !ByteCodec::get(pos, end, expense.payer)
+                || !ByteCodec::get(pos, end, cents) || !ByteCodec::getString(pos, end, expense.category)
+                || !ByteCodec::get(pos, end, dayNumber) || !ByteCodec::get(pos, end, expense.memberCount)
+                || !ByteCodec::get(pos, end, participantCount) || participantCount > static_cast<uint64_t>(end - pos)
+                || expense.payer >= memberCount || expense.memberCount > memberCount) {
+                return false;
+            }
+            expense.participants.resize(participantCount);
+            for (uint32_t& participant : expense.participants) {
+                if (!ByteCodec::get(pos, end, participant) || participant >= memberCount) {
+                    return false;
                 }
-                newCategory = categoryInput;
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
-                cout << "New Category: ";
-                getline(cin, categoryInput);
-                if (categoryInput.empty()) break;
             }
+            expense.id = id;
+            expense.cents = cents;
+            expense.dayNumber = dayNumber;
+            group.expenses.emplace(id, std::move(expense));
         }
+        return true;
     }
 
-    // Loop until valid date is entered
-    string dateInput;
-    cout << "New Date (YYYY-MM-DD): ";
-    getline(cin, dateInput);
-    if (!dateInput.empty()) {
-        while (true) {
-            try {
-                InputValidator::validateDateFormat(dateInput);
-                struct tm expenseDate = {};
-                if (!stringToDate(dateInput, expenseDate)) {
-                    throw std::invalid_argument("Invalid date format. Please enter a valid date.");
-                }
+private:
+    string name;
+    vector<string> members;
+    unordered_map<string, uint32_t> memberIndex;
+    vector<long long> balances; // by member, in cents
+    map<int, SharedExpense> expenses;
+    int lastId = 0;
+
+    // Adds (sign = 1) or withdraws (sign = -1) an expense; the cents that do not divide evenly
+    // go one each to the first participants
+    void apply(const SharedExpense& expense, int sign) {
+        size_t count = expense.participants.empty() ? expense.memberCount : expense.participants.size();
+        if (count == 0) {
+            return;
+        }
+        long long share = expense.cents / static_cast<long long>(count);
+        size_t extra = static_cast<size_t>(expense.cents % static_cast<long long>(count));
+        balances[expense.payer] += sign * expense.cents;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t member = expense.participants.empty() ? static_cast<uint32_t>(i) : expense.participants[i];
+            balances[member] -= sign * (share + (i < extra ? 1 : 0));
+        }
+    }
+};
 
-                // Check if date is in the future
-                time_t now = time(nullptr);
-                struct tm* currentDate = localtime(&now); // Convert to local time
-                if (mktime(&expenseDate) > mktime(currentDate)) {
-                    throw std::invalid_argument("Date cannot be in the future.");
-                }
+// Cross-user aggregates for the administrator report
+struct AdminReport {
+    struct Spender {
+        string username;
+        double spent;
+        double budget;
+    };
+
+    size_t userCount = 0;
+    size_t expenseCount = 0;
+    double totalSpent = 0;
+    unordered_map<string, double> spendByCategory; // lower-cased category
+    map<int, double> spendByMonth;                 // year * 12 + (month - 1)
+    vector<Spender> topSpenders;                   // highest spend first
+    vector<Spender> overBudget;                    // over their current period's budget
+    size_t workers = 0;
+    double elapsedMs = 0;
+};
 
-                newDate = dateInput;
-                break; // Exit loop on valid input
-            } catch (const std::exception& e) {
-                cout << "Error: " << e.what() << "\nPlease try again.\n";
-                cout << "New Date (YYYY-MM-DD): ";
-                getline(cin, dateInput);
-                if (dateInput.empty()) break;
+// Hit/miss and eviction counters of the resident-history cache
+struct HistoryCacheStats {
+    size_t hits = 0;          // history was already resident
+    size_t misses = 0;        // history had to be loaded from the store
+    size_t evictions = 0;     // histories written back to the store
+    size_t residentUsers = 0;
+    size_t residentBytes = 0;
+    size_t memoryBudget = 0;
+};
+
+class AccountManager {	//singleton implementation
+private:
+    static AccountManager* instance; // Static instance of the Singleton
+    vector<User> users;              // Store registered users
+    unordered_map<string, size_t> userIndex; // username -> position in users
+
+    // LRU bookkeeping for resident histories (front = most recently used)
+    struct ResidentEntry {
+        list<size_t>::iterator lruPos;
+        size_t bytes;
+    };
+    static const size_t DEFAULT_MEMORY_BUDGET = 64 * 1024 * 1024;
+    static const size_t NO_USER = static_cast<size_t>(-1);
+
+    unique_ptr<ExpenseStore> store;
+    list<size_t> lru;
+    unordered_map<size_t, ResidentEntry> resident;
+    size_t residentBytes;
+    size_t memoryBudget;
+    size_t pinnedUser;   // the logged-in user is never evicted
+    size_t lastAcquired; // most recently handed-out user, re-measured before the next eviction
+    HistoryCacheStats stats;
+    unique_ptr<WorkStealingPool> adminPool; // created on the first administrator report
+    map<string, ExpenseGroup> groups;       // by name; read from the store on first use, written on every change
+    bool groupsLoaded = false;
+    string adminPassword;                   // from EXPENSE_TRACKER_ADMIN_PASSWORD; empty disables admin access
+
+    AccountManager() // Private constructor
+        : store(new FileExpenseStore()), residentBytes(0),
+          memoryBudget(DEFAULT_MEMORY_BUDGET), pinnedUser(NO_USER), lastAcquired(NO_USER) {
+        const char* configured = getenv("EXPENSE_TRACKER_ADMIN_PASSWORD");
+        adminPassword = configured ? configured : "";
+    }
+
+    // Groups come from whichever store is set when they are first needed, e.g. a replay's scratch store
+    void loadGroups() {
+        if (groupsLoaded) {
+            return;
+        }
+        groupsLoaded = true;
+        string encoded;
+        if (!store->loadGroups(encoded)) {
+            return;
+        }
+        const char* pos = encoded.data();
+        const char* end = pos + encoded.size();
+        uint32_t count;
+        bool ok = ByteCodec::get(pos, end, count);
+        for (uint32_t i = 0; ok && i < count; ++i) {
+            ExpenseGroup group("");
+            ok = ExpenseGroup::decode(pos, end, group);
+            if (ok) {
+                string name = group.getName();
+                groups.emplace(name, std::move(group));
             }
         }
+        if (!ok || pos != end) {
+            throw std::runtime_error("The stored shared expense groups are corrupted.");
+        }
     }
 
-    // Update expense details
-    expense->setAmount(newAmount);
-    expense->setCategory(newCategory);
-    expense->setDate(newDate);
+    // Refresh the memory accounted to a resident user and mark it most recently used
+    void touch(size_t index) {
+        size_t bytes = users[index].estimateHistoryBytes();
+        auto found = resident.find(index);
+        if (found == resident.end()) {
+            lru.push_front(index);
+            resident[index] = {lru.begin(), bytes};
+        } else {
+            lru.splice(lru.begin(), lru, found->second.lruPos);
+            residentBytes -= found->second.bytes;
+            found->second.bytes = bytes;
+        }
+        residentBytes += bytes;
+    }
 
-    cout << "\n> Expense modified successfully!" << endl;
-    cout << "Updated Details:" << endl;
-    cout << "Amount: " << expense->getAmount() << endl;
-    cout << "Category: " << expense->getCategory() << endl;
-    cout << "Date: " << expense->getDate() << endl;
+    // Re-measure a resident user in place; callers may have added expenses since the last touch
+    void refreshBytes(size_t index) {
+        auto found = resident.find(index);
+        if (found != resident.end()) {
+            residentBytes -= found->second.bytes;
+            found->second.bytes = users[index].estimateHistoryBytes();
+            residentBytes += found->second.bytes;
+        }
+    }
 
-    // Display current budget
+    // Make sure the user's history is resident, loading it on first access
+    User& acquire(size_t index) {
+        if (lastAcquired != NO_USER && lastAcquired != index) {
+            refreshBytes(lastAcquired);
+        }
+        lastAcquired = index;
+        User& user = users[index];
+        if (user.isHistoryLoaded()) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+            vector<shared_ptr<Expense>> history;
+            string log;
+            store->load(user.getUsername(), history);
+            store->loadLog(user.getUsername(), log);
+            user.loadHistory(std::move(history), log);
+        }
+        touch(index);
+        return user;
+    }
 
-    // Prompt for additional modifications
-    char modChoice;
-    do {
-        cout << "\n> Modify another expense? (Y/N): ";
-        cin >> modChoice;
-        if (tolower(modChoice) != 'y' && tolower(modChoice) != 'n') {
-            cout << "Invalid Answer!\n";
+    void evict(size_t index) {
+        auto found = resident.find(index);
+        User& user = users[index];
+        store->save(user.getUsername(), user.liveExpenses());
+        store->saveLog(user.getUsername(), user.encodeMutationLog());
+        user.unloadHistory();
+        if (lastAcquired == index) {
+            lastAcquired = NO_USER;
         }
-        if (tolower(modChoice) == 'y') {
-            modifyExpense(user, budgetManager); // Recursive call for additional modifications
+        residentBytes -= found->second.bytes;
+        lru.erase(found->second.lruPos);
+        resident.erase(found);
+        stats.evictions++;
+    }
+
+    // Write back least recently used histories until the budget is met
+    void enforceMemoryBudget() {
+        if (lastAcquired != NO_USER) {
+            refreshBytes(lastAcquired);
+        }
+        auto it = lru.end();
+        while (residentBytes > memoryBudget && it != lru.begin()) {
+            --it;
+            size_t index = *it;
+            if (index == pinnedUser) {
+                continue;
+            }
+            it = next(it); // evict() invalidates the current position
+            try {
+                evict(index);
+            } catch (const std::exception&) {
+                break; // keep the history resident rather than lose it
+            }
         }
-    } while (tolower(modChoice) != 'y' && tolower(modChoice) != 'n');
-    
-    if(tolower(modChoice) == 'n') {
-        cout << endl << "> Redirecting to the main menu ..." << endl;
-        cout << "> Press any key to continue ...";
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cin.get();
     }
-}
 
-    void removeExpense(User& user, BudgetManager& budgetManager) {
-    	system("cls");
-    	int choice;
-    	string menuTitle = "REMOVE EXPENSE";
-        printHeader(menuTitle);
+public:
+    // Delete copy constructor and assignment operator
+    AccountManager(const AccountManager&) = delete;
+    AccountManager& operator=(const AccountManager&) = delete;
 
-		if (user.getExpenses().empty()) {
-        cout << "\n> You do not have any expense entries yet." << endl;
-        cout << "> Redirecting to the main menu..." << endl;
-        system("pause");
-        return;
-    	}
-	    
-		handleExpensesView(user);
-		expensesView(user, totalExpenses);
+    const vector<User>& getUsers() const {
+        return users; // Return reference to the users vector
+    }
 
- 		// Prompt for ID
-	    int expenseIdToDelete;
-	    cout << "\n> Enter the ID of the expense you want to delete (or '0' to cancel): ";
-	    cin >> expenseIdToDelete;
-	    
-	    if (expenseIdToDelete == 0) {
-	        return;
-	    }
-	
-	    // Locate thexpense manually using a loop
-	    auto& expenses = user.getExpenses();
-	    shared_ptr<Expense> expense = nullptr;
-	    auto it = expenses.end(); // Iterator to track the expense
-	
-	    for (auto iter = expenses.begin(); iter != expenses.end(); ++iter) {
-	        if ((*iter)->getId() == expenseIdToDelete) {
-	            expense = *iter;
-	            it = iter;
-	            break;
-	        }
-	    }
-	
-	    if (!expense) {
-	        cout << "\n> Expense ID not found. Returning to main menu..." << endl;
-	        system("pause");
-	        return;
-	    }
-	
-	    // Display the expense details
-	    cout << "\nExpense Details:" << endl;
-	    cout << "ID: " << expense->getId() << endl;
-	    cout << "Amount: " << expense->getAmount() << endl;
-	    cout << "Category: " << expense->getCategory() << endl;
-	    cout << "Date: " << expense->getDate() << endl;
-	
-	    // Confirm deletion
-	    char deleteChoice;
-	    cout << "\n> Delete this expense? (Y/N): ";
-	    cin >> deleteChoice;
-	
-	    if (tolower(deleteChoice) == 'y') {
-	        expenses.erase(it);
-	        cout << "\n> Expense deleted successfully!" << endl;
-	    } else {
-	        cout << "\n> Deletion canceled." << endl;
+    static AccountManager* getInstance() {
+        if (!instance) {
+            instance = new AccountManager();
+        }
+        return instance;
+    }
+
+	bool registerUser(const string& username, const string& password, double budget) {
+	    if (userIndex.count(username)) {
+	        return false; // Username already exists
 	    }
-	
-	    // Display current budget
-	    cout << "\nCURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
-	
-	    // Prompt for additional deletions
-	    char delChoice;
-	    do {
-		    cout << "\n> Delete another expense? (Y/N): ";
-		    cin >> delChoice;
-		    if (tolower(delChoice) != 'y' && tolower(delChoice) != 'n') {
-				cout << "Invalid Answer!\n";
-			}
-		    if (tolower(delChoice) == 'y') {
-		        removeExpense(user, budgetManager); // Recursive call for additional deletions
-		    }
-		} while (tolower(delChoice) != 'y' && tolower(delChoice) != 'n');
-		
-		if(tolower(delChoice) == 'n') {
-	        cout << endl << "\n> Redirecting to the main menu ..." << endl;
-	        cout << "> Press any key to continue ...";
-	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-	        cin.get();
-		} 
+	    users.emplace_back(username, password, budget);
+	    userIndex[username] = users.size() - 1;
+	    touch(users.size() - 1); // a new user starts with an empty, resident history
+	    return true; // Registration successful
 	}
 
-    void checkBudget(const User& user) const {}
-	
-    void generateReport(User& user, BudgetManager& budgetManager){ 
-    	system("cls");
-    	string menuTitle = "EXPENSE REPORT";
-        printHeader(menuTitle);
-        
-        if (user.getExpenses().empty()) {
-        cout << "\n> You do not have any expense entries yet." << endl;
-        cout << "> Redirecting to main menu." << endl;
-        cout << "> Press any key to continue ...";
-        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-        cin.get();
-        return;
-    	}
-    
-	    // Display filtered expenses and calculate total
-	    double totalExpenses = 0;
-	    
-	    // Call expensesView and calculate total expenses
-	    handleExpensesView(user);
-	    expensesView(user, totalExpenses);
 
-	    cout << "\nTOTAL EXPENSE: " << totalExpenses << endl;
-	    cout << "CURRENT BUDGET: " << budgetManager.getRemainingBudget() << endl;
-	    
-	    char mainChoice;
-	    do {
-		    cout << "\n> Return to main menu? (Y/N): ";
-	    	cin >> mainChoice;
-		    if (tolower(mainChoice) != 'y' && tolower(mainChoice) != 'n') {
-				cout << "\n> Invalid Answer!\n";
-			}
-		    if (tolower(mainChoice) == 'n') {
-		    	generateReport(user, budgetManager);
-		    }
-		} while (tolower(mainChoice) != 'y' && tolower(mainChoice) != 'n');
-		
-		if(tolower(mainChoice) == 'y') {
-	        cout << endl << "\n> Redirecting to the main menu ..." << endl;
-	        cout << "> Press any key to continue ...";
-	        cin.ignore(numeric_limits<streamsize>::max(), '\n');
-	        cin.get();
-		} 
-	}
+    User* login(const string& username, const string& password) {
+        auto found = userIndex.find(username);
+        if (found == userIndex.end()) {
+            cout << "User doesn't exist." << endl;
+            return nullptr;
+        }
+        if (!users[found->second].verifyPassword(password)) {
+            cout << "Invalid password!" << endl;
+            return nullptr;
+        }
+        User& user = acquire(found->second);
+        pinnedUser = found->second;
+        enforceMemoryBudget();
+        cout << "Welcome, " << username << "!" << endl;
+        return &user;
+    }
+
+    // One step of deferred work for the first resident user that has some
+    bool runMaintenance() {
+        for (const auto& entry : resident) {
+            if (users[entry.first].runMaintenance()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Releases the pin on the logged-in user so its history may be evicted
+    void logout(const User& user) {
+        auto found = userIndex.find(user.getUsername());
+        if (found == userIndex.end()) {
+            return;
+        }
+        touch(found->second); // history may have grown during the session
+        if (pinnedUser == found->second) {
+            pinnedUser = NO_USER;
+        }
+        enforceMemoryBudget();
+    }
+
+    // Access a user by name, loading its history on first access
+    User* getUser(const string& username) {
+        auto found = userIndex.find(username);
+        if (found == userIndex.end()) {
+            return nullptr;
+        }
+        User& user = acquire(found->second);
+        enforceMemoryBudget();
+        return &user;
+    }
+
+    bool hasUser(const string& username) const { return userIndex.count(username) > 0; }
+
+    // Deletes every user's stored history and the groups, e.g. the scratch store of a replay
+    void discardStore() {
+        for (const auto& user : users) {
+            store->discard(user.getUsername());
+        }
+        store->discardGroups();
+    }
+
+    bool hasAdministrator() const { return !adminPassword.empty(); }
+    bool verifyAdministrator(const string& password) const { return hasAdministrator() && password == adminPassword; }
+
+    // A new group holding only its creator; nullptr when the name is taken
+    ExpenseGroup* createGroup(const string& name, const string& creator) {
+        loadGroups();
+        auto created = groups.emplace(name, ExpenseGroup(name));
+        if (!created.second) {
+            return nullptr;
+        }
+        created.first->second.addMember(creator);
+        saveGroups();
+        return &created.first->second;
+    }
+
+    ExpenseGroup* getGroup(const string& name) {
+        loadGroups();
+        auto found = groups.find(name);
+        return found == groups.end() ? nullptr : &found->second;
+    }
+
+    // Writes every group back to the store; call after changing one
+    void saveGroups() {
+        string encoded;
+        ByteCodec::put(encoded, static_cast<uint32_t>(groups.size()));
+        for (const auto& group : groups) {
+            group.second.encode(encoded);
+        }
+        store->saveGroups(encoded);
+    }
+
+    vector<ExpenseGroup*> getGroupsOf(const string& username) {
+        loadGroups();
+        vector<ExpenseGroup*> memberOf;
+        for (auto& group : groups) {
+            if (group.second.isMember(username)) {
+                memberOf.push_back(&group.second);
+            }
+        }
+        return memberOf;
+    }
+
+    // Visits a user's expenses matching a view without making the history resident;
+    // cold histories are streamed from the store, skipping blocks outside the view's dates
+    bool scanHistory(const string& username, const ExpenseViewStrategy& view, const ExpenseStore::Visitor& visit) const {
+        auto found = userIndex.find(username);
+        if (found == userIndex.end()) {
+            return false;
+        }
+        const User& user = users[found->second];
+        if (user.isHistoryLoaded()) {
+            user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+                if (view.matches(*expense)) {
+                    visit(expense);
+                }
+            });
+            return true;
+        }
+        int fromDay = numeric_limits<int>::min(), toDay = numeric_limits<int>::max();
+        view.getDateRange(fromDay, toDay);
+        store->scan(username, fromDay, toDay, [&](const shared_ptr<Expense>& expense) {
+            if (view.matches(*expense)) {
+                visit(expense);
+            }
+        });
+        return true;
+    }
+
+    // Feeds every user's expenses to an exporter; cold histories are streamed from the store
+    void exportAll(ArrowExporter& exporter) const {
+        for (const auto& user : users) {
+            exporter.beginUser(user.getUsername(), user.getBaseCurrency());
+            if (user.isHistoryLoaded()) {
+                user.forEachExpense([&exporter](const shared_ptr<Expense>& expense) { exporter.add(*expense); });
+            } else {
+                store->scan(user.getUsername(), numeric_limits<int>::min(), numeric_limits<int>::max(),
+                            [&exporter](const shared_ptr<Expense>& expense) { exporter.add(*expense); });
+            }
+        }
+    }
+
+    // Aggregates every user's spending in parallel: users are split into ranges across a
+    // work-stealing pool, each worker fills its own partial report and the partials are merged.
+    // With a view only its expenses count, and cold histories skip the blocks outside its dates
+    AdminReport buildAdminReport(size_t topCount, const ExpenseViewStrategy* view = nullptr) {
+        auto started = chrono::steady_clock::now();
+        if (!adminPool) {
+            adminPool.reset(new WorkStealingPool());
+        }
+        typedef pair<double, size_t> Ranked; // spend, user index
+        struct Partial {
+            AdminReport report;
+            priority_queue<Ranked, vector<Ranked>, greater<Ranked>> top; // bounded min-heap
+        };
+        vector<Partial> partials(adminPool->size());
+        const int today = DateUtil::today();
+
+        adminPool->parallelFor(users.size(), 1024, [&](size_t begin, size_t end, size_t worker) {
+            Partial& partial = partials[worker];
+            AdminReport& report = partial.report;
+            for (size_t index = begin; index < end; ++index) {
+                const User& user = users[index]; // read only: workers never touch user state
+                double spent = 0;
+                auto tally = [&](const shared_ptr<Expense>& expense) {
+                    int dayNumber;
+                    if (DateUtil::toDayNumber(expense->getDate(), dayNumber)) {
+                        double amount = user.toBase(*expense);
+                        report.spendByCategory[InputValidator::toLowerCase(expense->getCategory())] += amount;
+                        report.spendByMonth[CategoryStatsIndex::monthKeyOf(dayNumber)] += amount;
+                        spent += amount;
+                    }
+                    report.expenseCount++;
+                };
+                if (view) {
+                    scanHistory(user.getUsername(), *view, tally);
+                } else if (user.isHistoryLoaded() && !user.hasCurrentRates()) {
+                    // Indexes converted with an older rate table; convert the rows on the fly
+                    user.forEachExpense(tally);
+                } else if (user.isHistoryLoaded()) {
+                    // Resident users are summarized from their category index, not their rows
+                    user.getCategoryStats().forEachMonth([&](const string& category, int month, double total) {
+                        report.spendByCategory[category] += total;
+                        report.spendByMonth[month] += total;
+                        spent += total;
+                    });
+                    report.expenseCount += user.getExpenseCount();
+                } else {
+                    store->scan(user.getUsername(), numeric_limits<int>::min(), numeric_limits<int>::max(), tally);
+                }
+                report.userCount++;
+                report.totalSpent += spent;
+                // Budgets are per period; the ledger stays resident even for cold users
+                BudgetLedger::PeriodSummary current = user.getBudgetSummary(today);
+                if (current.remaining() < 0) {
+                    report.overBudget.push_back({user.getUsername(), current.spent, current.budget + current.carriedIn});
+                }
+                partial.top.emplace(spent, index);
+                if (partial.top.size() > topCount) {
+                    partial.top.pop();
+                }
+            }
+        });
+
+        AdminReport merged;
+        priority_queue<Ranked, vector<Ranked>, greater<Ranked>> top;
+        for (auto& partial : partials) {
+            merged.userCount += partial.report.userCount;
+            merged.expenseCount += partial.report.expenseCount;
+            merged.totalSpent += partial.report.totalSpent;
+            for (const auto& category : partial.report.spendByCategory) {
+                merged.spendByCategory[category.first] += category.second;
+            }
+            for (const auto& month : partial.report.spendByMonth) {
+                merged.spendByMonth[month.first] += month.second;
+            }
+            merged.overBudget.insert(merged.overBudget.end(), partial.report.overBudget.begin(), partial.report.overBudget.end());
+            for (; !partial.top.empty(); partial.top.pop()) {
+                top.push(partial.top.top());
+                if (top.size() > topCount) {
+                    top.pop();
+                }
+            }
+        }
+        for (; !top.empty(); top.pop()) {
+            const User& user = users[top.top().second];
+            merged.topSpenders.push_back({user.getUsername(), top.top().first, user.getBudget()});
+        }
+        reverse(merged.topSpenders.begin(), merged.topSpenders.end());
+        merged.workers = adminPool->size();
+        merged.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        return merged;
+    }
+
+    void setMemoryBudget(size_t bytes) {
+        memoryBudget = bytes;
+        enforceMemoryBudget();
+    }
 
-//------------------ HELPER FUNCTIONS ----------------------
+    void setExpenseStore(unique_ptr<ExpenseStore> newStore) {
+        store = std::move(newStore);
+        groups.clear();
+        groupsLoaded = false;
+    }
 
-	void printHeader(const string& menuTitle) const {
-    cout << "================================================" << endl;
-    cout << "           " << menuTitle << "                  " << endl;
-    cout << "================================================" << endl;
-	}	
+    HistoryCacheStats getCacheStats() const {
+        HistoryCacheStats current = stats;
+        current.residentUsers = resident.size();
+        current.residentBytes = residentBytes;
+        current.memoryBudget = memoryBudget;
+        return current;
+    }
 };
 
-class AccountManager {	//singleton implementation
+// Define the static member
+AccountManager* AccountManager::instance = nullptr;
+
+// Groups the logged-in user belongs to, their shared expenses and how to settle up
+class SharedExpensesScreen : public UserInterface {
 private:
-    static AccountManager* instance; // Static instance of the Singleton
-    vector<User> users;              // Store registered users
+    User& currentUser;
 
-    AccountManager() {} // Private constructor
+    static string money(long long cents) {
+        ostringstream text;
+        text << fixed << setprecision(2) << cents / 100.0;
+        return text.str();
+    }
 
-public:
-    // Delete copy constructor and assignment operator
-    AccountManager(const AccountManager&) = delete;
-    AccountManager& operator=(const AccountManager&) = delete;
+    // A group the user is a member of, by name; nullptr when canceled or not found
+    ExpenseGroup* promptGroup() const {
+        string name;
+        cout << "\nGROUP NAME: ";
+        cin >> name;
+        if (name == "x" || name == "X") {
+            return nullptr;
+        }
+        ExpenseGroup* group = AccountManager::getInstance()->getGroup(name);
+        if (!group || !group->isMember(currentUser.getUsername())) {
+            cout << "\n> You are not in a group named '" << name << "'." << endl;
+            return nullptr;
+        }
+        return group;
+    }
 
-    const vector<User>& getUsers() const {
-        return users; // Return reference to the users vector
+    // Comma separated usernames, spaces around them ignored, or '-' for none
+    static vector<string> splitNames(const string& input) {
+        vector<string> names;
+        if (input == "-") {
+            return names;
+        }
+        stringstream list(input);
+        string name;
+        while (getline(list, name, ',')) {
+            size_t first = name.find_first_not_of(' ');
+            if (first != string::npos) {
+                names.push_back(name.substr(first, name.find_last_not_of(' ') - first + 1));
+            }
+        }
+        return names;
     }
-	
-    static AccountManager* getInstance() {
-        if (!instance) {
-            instance = new AccountManager();
+
+    // The rest of the input line, skipping leading whitespace
+    static string readLine() {
+        string line;
+        cin >> ws;
+        getline(cin, line);
+        return line;
+    }
+
+    void createGroup() const {
+        string name;
+        cout << "\nGROUP NAME: ";
+        cin >> name;
+        if (name == "x" || name == "X") {
+            return;
         }
-        return instance;
+        AccountManager* accounts = AccountManager::getInstance();
+        ExpenseGroup* group = accounts->createGroup(name, currentUser.getUsername());
+        if (!group) {
+            cout << "\n> A group named '" << name << "' already exists." << endl;
+            return;
+        }
+        cout << "OTHER MEMBERS (comma separated usernames, '-' for none): ";
+        addMembers(*group, splitNames(readLine()));
+        cout << "\n> Group '" << name << "' created with " << group->getMembers().size() << " member(s)." << endl;
     }
 
-	bool registerUser(const string& username, const string& password, double budget) {
-	    for (const auto& user : users) {
-	        if (user.getUsername() == username) {
-	            return false; // Username already exists
-	        }
-	    }
-	    users.emplace_back(username, password, budget);
-	    return true; // Registration successful
-	}
+    void addMembers(ExpenseGroup& group, const vector<string>& names) const {
+        AccountManager* accounts = AccountManager::getInstance();
+        for (const auto& name : names) {
+            if (!accounts->hasUser(name)) {
+                cout << "> No user named '" << name << "'; skipped." << endl;
+            } else if (!group.addMember(name)) {
+                cout << "> '" << name << "' is already in the group." << endl;
+            }
+        }
+        accounts->saveGroups();
+    }
+
+    void addSharedExpense(ExpenseGroup& group) const {
+        string amountInput, category, date;
+        double amount;
+        cout << "AMOUNT: ";
+        cin >> amountInput;
+        try {
+            amount = InputValidator::toAmount(amountInput);
+        } catch (const std::exception& e) {
+            cout << "\n> Error: " << e.what() << endl;
+            return;
+        }
+        cout << "CATEGORY (e.g. food > dining): ";
+        category = readLine();
+        try {
+            InputValidator::validateCategory(category);
+        } catch (const std::exception& e) {
+            cout << "\n> Error: " << e.what() << endl;
+            return;
+        }
+        cout << "DATE (YYYY-MM-DD): ";
+        cin >> date;
+        int dayNumber;
+        try {
+            dayNumber = InputValidator::toDayNumber(date);
+        } catch (const std::exception& e) {
+            cout << "\n> Error: " << e.what() << endl;
+            return;
+        }
+        cout << "SPLIT BETWEEN (comma separated usernames, '-' for everyone): ";
+        int id = group.addExpense(currentUser.getUsername(), amount, category, dayNumber, splitNames(readLine()));
+        if (id == 0) {
+            cout << "\n> Everyone in the split must be a member of the group." << endl;
+        } else {
+            AccountManager::getInstance()->saveGroups();
+            cout << "\n> Shared expense S" << id << " added. Your balance in '" << group.getName() << "' is now "
+                 << money(group.getBalance(currentUser.getUsername())) << "." << endl;
+        }
+    }
+
+    void removeSharedExpense(ExpenseGroup& group) const {
+        string input;
+        cout << "SHARED EXPENSE ID (e.g. S1): ";
+        cin >> input;
+        int id = 0;
+        try {
+            id = stoi(input[0] == 'S' || input[0] == 's' ? input.substr(1) : input);
+        } catch (const std::exception&) {
+            // not a number; no shared expense has id 0
+        }
+        auto found = group.getExpenses().find(id);
+        if (found == group.getExpenses().end()) {
+            cout << "\n> No shared expense with that ID." << endl;
+        } else if (!group.removeExpense(id, currentUser.getUsername())) {
+            cout << "\n> Only " << group.getMembers()[found->second.payer] << ", who paid S" << id
+                 << ", can remove it." << endl;
+        } else {
+            AccountManager::getInstance()->saveGroups();
+            cout << "\n> Shared expense S" << id << " removed." << endl;
+        }
+    }
 
+    // Balances, the latest expenses and the settlement plan, which can be recorded as paid
+    void viewGroup(ExpenseGroup& group) const {
+        const size_t RECENT_EXPENSES = 10;
+        vector<pair<long long, string>> balances;
+        for (const auto& member : group.getMembers()) {
+            balances.emplace_back(group.getBalance(member), member);
+        }
+        sort(balances.rbegin(), balances.rend());
+        cout << "\n---------------------------------\n";
+        cout << "MEMBER\t\tBALANCE\n";
+        cout << "---------------------------------\n";
+        for (const auto& balance : balances) {
+            cout << setw(10) << balance.second << "\t" << money(balance.first) << endl;
+        }
 
-    User* login(const string& username, const string& password) {
-        for (auto& user : users) {
-            if (user.getUsername() == username) {
-                if (user.verifyPassword(password)) {
-                    cout << "Welcome, " << username << "!" << endl;
-                    return &user;
+        const auto& expenses = group.getExpenses();
+        cout << "\n---------------------------------------------------------\n";
+        cout << "ID\tAMOUNT\tCATEGORY\tDATE\t\tPAID BY\n";
+        cout << "---------------------------------------------------------\n";
+        size_t shown = 0;
+        for (auto it = expenses.rbegin(); it != expenses.rend() && shown < RECENT_EXPENSES; ++it, ++shown) {
+            const auto& expense = it->second;
+            cout << "S" << expense.id << "\t" << money(expense.cents) << "\t" << setw(10) << expense.category << "\t"
+                 << DateUtil::toString(expense.dayNumber) << "\t" << group.getMembers()[expense.payer] << endl;
+        }
+        if (expenses.size() > shown) {
+            cout << "... and " << expenses.size() - shown << " earlier" << endl;
+        }
+
+        auto started = chrono::steady_clock::now();
+        vector<ExpenseGroup::Transfer> plan = group.settlementPlan();
+        long long elapsedMs = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+        if (plan.empty()) {
+            cout << "\n> Everyone is settled up." << endl;
+            return;
+        }
+        cout << "\nTO SETTLE UP (" << plan.size() << " transfer(s), planned in " << elapsedMs << " ms):\n";
+        for (const auto& transfer : plan) {
+            cout << "  " << transfer.from << " pays " << transfer.to << " " << money(transfer.cents) << endl;
+        }
+        char answer;
+        do {
+            cout << "\n> Record these payments as made? (Y/N): ";
+            cin >> answer;
+        } while (tolower(answer) != 'y' && tolower(answer) != 'n');
+        if (tolower(answer) == 'y') {
+            size_t recorded = 0;
+            for (const auto& transfer : plan) {
+                recorded += group.recordPayment(transfer.from, transfer.to, transfer.cents);
+            }
+            AccountManager::getInstance()->saveGroups();
+            if (recorded == plan.size()) {
+                cout << "\n> Payments recorded; everyone is settled up." << endl;
+            } else {
+                cout << "\n> Only " << recorded << " of " << plan.size() << " payment(s) could be recorded." << endl;
+            }
+        }
+    }
+
+public:
+    SharedExpensesScreen(User& user) : currentUser(user) {}
+
+    void displayScreen() const override {
+        system("cls");
+        cout << "================================================" << endl;
+        cout << "               SHARED EXPENSES                  " << endl;
+        cout << "================================================" << endl;
+        vector<ExpenseGroup*> groups = AccountManager::getInstance()->getGroupsOf(currentUser.getUsername());
+        if (groups.empty()) {
+            cout << "> You are not in any group yet." << endl;
+        }
+        for (const ExpenseGroup* group : groups) {
+            long long balance = group->getBalance(currentUser.getUsername());
+            cout << setw(12) << group->getName() << "\t" << group->getMembers().size() << " member(s)\t"
+                 << (balance > 0 ? "you are owed " + money(balance) : balance < 0 ? "you owe " + money(-balance) : "settled")
+                 << endl;
+        }
+        cout << "\n1 - Create a group\n";
+        cout << "2 - Add members to a group\n";
+        cout << "3 - Add a shared expense\n";
+        cout << "4 - Remove a shared expense\n";
+        cout << "5 - View balances and settle up\n";
+        cout << "6 - Back to main menu\n";
+        cout << "CHOICE: ";
+    }
+
+    void handleSharedExpenses() {
+        int choice;
+        while (true) {
+            displayScreen();
+            validateNumericInput(choice, 1, 6);
+            if (choice == 6) {
+                return;
+            }
+            cout << "> Input 'x' to cancel." << endl;
+            if (choice == 1) {
+                createGroup();
+            } else if (ExpenseGroup* group = promptGroup()) {
+                if (choice == 2) {
+                    cout << "NEW MEMBERS (comma separated usernames): ";
+                    addMembers(*group, splitNames(readLine()));
+                } else if (choice == 3) {
+                    addSharedExpense(*group);
+                } else if (choice == 4) {
+                    removeSharedExpense(*group);
                 } else {
-                    cout << "Invalid password!" << endl;
-                    return nullptr;
+                    viewGroup(*group);
                 }
             }
+            system("pause");
         }
-        cout << "User doesn't exist." << endl;
-        return nullptr;
     }
 };
 
-// Define the static member
-AccountManager* AccountManager::instance = nullptr;
-
 class MainMenuScreen : public UserInterface {
 private:
     User& currentUser;
@@ -1128,17 +7936,30 @@ public:
         cout << "4 - Manage Budget" << endl;
         cout << "5 - Remove Expenses" << endl;
         cout << "6 - Generate Report" << endl;
-        cout << "7 - Logout" << endl;
-        cout << "8 - Exit" << endl;
+        cout << "7 - Import Expenses" << endl;
+        cout << "8 - Bulk Edit Expenses" << endl;
+        cout << "9 - Recurring Expenses" << endl;
+        cout << "10 - Shared Expenses" << endl;
+        cout << "11 - Logout" << endl;
+        cout << "12 - Exit" << endl;
         cout << "\nHello, '" << currentUser.getUsername() << "'!" << endl; 
+        int today = DateUtil::today();
+        SpendForecast::Projection forecast = currentUser.getForecast(today);
+        cout << "> " << currentUser.getRemainingBudget(today) << " left this period, on pace to spend "
+             << forecast.projectedSpend << " by its end";
+        if (currentUser.getBudget() > 0 && forecast.runOutDay != SpendForecast::NO_RUN_OUT) {
+            cout << "; budget runs out around " << DateUtil::toString(forecast.runOutDay);
+        }
+        cout << "." << endl;
         cout << "> Please input your choice: ";
     }
 
     void handleMainMenu() {
         int choice;
         while (true) {
+            currentUser.syncRates(); // picks up a rate table loaded by another session
             displayScreen();
-            validateNumericInput(choice, 1, 8);
+            validateNumericInput(choice, 1, 12);
 
             switch (choice) {
                 case 1:
@@ -1160,10 +7981,23 @@ public:
                     expenseManager.generateReport(currentUser, budgetManager);
                     break;
                 case 7:
+                    expenseManager.importExpenses(currentUser, budgetManager);
+                    break;
+                case 8:
+                    expenseManager.bulkEditExpenses(currentUser, budgetManager);
+                    break;
+                case 9:
+                    expenseManager.manageRecurringExpenses(currentUser);
+                    break;
+                case 10:
+                    SharedExpensesScreen(currentUser).handleSharedExpenses();
+                    break;
+                case 11:
+                	AccountManager::getInstance()->logout(currentUser);
                 	cout <<"logging out, returning to the start screen ..." << endl;
                 	system("pause");
                     return; 
-                case 8:
+                case 12:
                 	cout << "Exiting the program..." << endl;
                 	exit(0);
                 default:
@@ -1185,7 +8019,8 @@ public:
         cout << "================================================" << endl;
         cout << "1 - Register an account" << endl;
         cout << "2 - Login" << endl;
-        cout << "3 - Exit" << endl;
+        cout << "3 - Administrator" << endl;
+        cout << "4 - Exit" << endl;
         cout << "> Please enter your choice: ";
     }
 
@@ -1193,13 +8028,15 @@ public:
         int choice;
         while (true) {
             displayScreen();
-            validateNumericInput(choice, 1, 3);
+            validateNumericInput(choice, 1, 4);
 
             if (choice == 1) {
                 handleRegistration();
             } else if (choice == 2) {
                 handleLogin();
             } else if (choice == 3) {
+                handleAdministrator();
+            } else if (choice == 4) {
                 cout << "Thank you for using the Expense Tracker. Goodbye!" << endl;
                 break;
             }
@@ -1207,6 +8044,140 @@ public:
     }
 
 private:
+    // Every account's expenses in one Arrow IPC stream, one row per expense tagged with its user
+    void handleExportAll() const {
+        system("cls");
+        cout << "================================================" << endl;
+        cout << "               EXPORT ALL EXPENSES              " << endl;
+        cout << "================================================" << endl;
+        string path;
+        cout << "EXPORT FILE (e.g. all_expenses.arrow): ";
+        cin >> path;
+
+        auto started = chrono::steady_clock::now();
+        ArrowExporter exporter;
+        AccountManager::getInstance()->exportAll(exporter);
+        size_t bytes = 0;
+        if (exporter.write(path, bytes)) {
+            cout << "\n> Exported " << exporter.rowCount() << " expense(s) to " << path << " (" << (bytes + 1023) / 1024
+                 << " KB) in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count()
+                 << " ms." << endl;
+        } else {
+            cout << "\n> Could not write " << path << "." << endl;
+        }
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+    }
+
+    // Cross-account screens, reachable only with the administrator password
+    void handleAdministrator() const {
+        system("cls");
+        cout << "================================================" << endl;
+        cout << "              ADMINISTRATOR LOG IN              " << endl;
+        cout << "================================================" << endl;
+        AccountManager* accounts = AccountManager::getInstance();
+        if (!accounts->hasAdministrator()) {
+            cout << "> Administrator access is disabled; set EXPENSE_TRACKER_ADMIN_PASSWORD to enable it." << endl;
+            system("pause");
+            return;
+        }
+        string password;
+        cout << "Enter administrator password: ";
+        Terminal::expectSecret();
+        cin >> password;
+        if (!accounts->verifyAdministrator(password)) {
+            cout << "Invalid password!" << endl;
+            system("pause");
+            return;
+        }
+
+        while (true) {
+            system("cls");
+            cout << "================================================" << endl;
+            cout << "                 ADMINISTRATOR                  " << endl;
+            cout << "================================================" << endl;
+            cout << "1 - Administrator Report" << endl;
+            cout << "2 - Export All Expenses" << endl;
+            cout << "3 - Back" << endl;
+            cout << "> Please enter your choice: ";
+            int choice;
+            validateNumericInput(choice, 1, 3);
+            if (choice == 3) {
+                return;
+            }
+            if (choice == 1) {
+                handleAdminReport();
+            } else {
+                handleExportAll();
+            }
+        }
+    }
+
+    // Global spend by category and month, top spenders and over-budget users across all accounts
+    void handleAdminReport() const {
+        const size_t TOP_SPENDERS = 10;
+        system("cls");
+        cout << "================================================" << endl;
+        cout << "              ADMINISTRATOR REPORT              " << endl;
+        cout << "================================================" << endl;
+        cout << "PERIOD (1 - All time, 2 - Past week, 3 - A month of this year, 4 - This year): ";
+        int period;
+        validateNumericInput(period, 1, 4);
+        unique_ptr<ExpenseViewStrategy> view;
+        if (period == 2) {
+            view.reset(new WeeklyViewStrategy());
+        } else if (period == 3) {
+            int month;
+            cout << "MONTH (1 - 12): ";
+            validateNumericInput(month, 1, 12);
+            view.reset(new MonthlyViewStrategy(month));
+        } else if (period == 4) {
+            view.reset(new YearlyViewStrategy());
+        }
+
+        AdminReport report = AccountManager::getInstance()->buildAdminReport(TOP_SPENDERS, view.get());
+        cout << "USERS: " << report.userCount << "\tEXPENSES: " << report.expenseCount
+             << "\tTOTAL SPENT: " << report.totalSpent << endl;
+
+        vector<pair<string, double>> categories(report.spendByCategory.begin(), report.spendByCategory.end());
+        sort(categories.begin(), categories.end(),
+             [](const pair<string, double>& a, const pair<string, double>& b) { return a.second > b.second; });
+        cout << "\n---------------------------------\n";
+        cout << "CATEGORY\tTOTAL\n";
+        cout << "---------------------------------\n";
+        for (const auto& category : categories) {
+            cout << setw(10) << category.first << "\t" << category.second << endl;
+        }
+
+        cout << "\n---------------------------------\n";
+        cout << "MONTH\t\tTOTAL\n";
+        cout << "---------------------------------\n";
+        for (const auto& month : report.spendByMonth) {
+            cout << month.first / 12 << "-" << setw(2) << setfill('0') << month.first % 12 + 1 << setfill(' ')
+                 << "\t\t" << month.second << endl;
+        }
+
+        cout << "\n---------------------------------\n";
+        cout << "TOP SPENDERS\tSPENT\tBUDGET\n";
+        cout << "---------------------------------\n";
+        for (const auto& spender : report.topSpenders) {
+            cout << setw(10) << spender.username << "\t" << spender.spent << "\t" << spender.budget << endl;
+        }
+
+        cout << "\n---------------------------------\n";
+        cout << "OVER BUDGET THIS PERIOD (" << report.overBudget.size() << ")\tSPENT\tBUDGET\n";
+        cout << "---------------------------------\n";
+        for (const auto& spender : report.overBudget) {
+            cout << setw(10) << spender.username << "\t" << spender.spent << "\t" << spender.budget << endl;
+        }
+
+        cout << "\n> Computed by " << report.workers << " worker(s) in " << report.elapsedMs << " ms." << endl;
+        cout << "> Press any key to continue ...";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        cin.get();
+    }
+
 	void handleRegistration() const {
     string username, password, choice;
     InputValidator inputValidator;
@@ -1252,6 +8223,7 @@ private:
     // Get password
     while (true) {
         cout << "Enter password: ";
+        Terminal::expectSecret();
         std::getline(cin, password);
 
         if (password == "x") {
@@ -1283,8 +8255,7 @@ private:
 
         try {
             InputValidator::validateNoSpaces(budgetInput);
-            InputValidator::validateIsNumeric(budgetInput);
-            budget = stod(budgetInput);
+            budget = InputValidator::toAmount(budgetInput);
             if (budget <= 0) {
                 throw std::invalid_argument("Budget must be a positive number.");
             }
@@ -1348,6 +8319,7 @@ private:
         }
 
         cout << "Enter password: ";
+        Terminal::expectSecret();
         cin >> password;
         if (password == "x") {
             cout << "\nCancelling login. Returning to start menu..." << endl;
@@ -1365,7 +8337,269 @@ private:
     }
 };
 
-int main() {
+/*
+    Session traces for performance testing. Every prompt reads cin, so a session is recorded as
+    the input lines it consumed, each with the milliseconds since the session started:
+        # expense tracker session trace
+        <ms>\t<input line>
+        <ms>*\t<n>      the answer to a password prompt: the session's n-th distinct password
+    Passwords never reach the trace; a replay answers with a stand-in per n, so registrations and
+    logins still agree with each other. A replay feeds the lines back through cin, waiting for each line's original time divided by
+    the speed (0 = no waiting). One operation is one input line: its latency runs from handing the
+    line over to the program asking for the next one, which covers all the work the answer caused.
+*/
+class SessionRecorder : public streambuf {
+private:
+    streambuf* source;
+    ofstream trace;
+    chrono::steady_clock::time_point started = chrono::steady_clock::now();
+    string line;
+    map<string, size_t> secrets; // distinct passwords of the session, numbered in order seen
+
+protected:
+    int_type underflow() override {
+        line.clear();
+        int_type c;
+        while ((c = source->sbumpc()) != traits_type::eof() && c != '\n') {
+            line += traits_type::to_char_type(c);
+        }
+        if (c == traits_type::eof() && line.empty()) {
+            return traits_type::eof();
+        }
+        long long offset = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - started).count();
+        if (Terminal::takeSecret() && line != "x" && line != "X") {
+            size_t secret = secrets.emplace(line, secrets.size() + 1).first->second;
+            trace << offset << "*\t" << secret << endl;
+        } else {
+            trace << offset << '\t' << line << endl; // flushed, so a crash keeps the trace
+        }
+        line += '\n';
+        setg(&line[0], &line[0], &line[0] + line.size());
+        return traits_type::to_int_type(line[0]);
+    }
+
+public:
+    SessionRecorder(streambuf* source, const string& path) : source(source), trace(path) {
+        trace << "# expense tracker session trace" << endl;
+    }
+
+    bool isOpen() const { return trace.is_open(); }
+};
+
+class SessionReplayer : public streambuf {
+public:
+    struct Entry {
+        long long offsetMs;
+        string line;
+    };
+
+    static bool loadTrace(const string& path, vector<Entry>& entries) {
+        ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        string text;
+        while (getline(in, text)) {
+            size_t tab = text.find('\t');
+            long long offset;
+            if (text.empty() || text[0] == '#' || tab == string::npos) {
+                continue;
+            }
+            auto parsed = from_chars(text.data(), text.data() + tab, offset);
+            if (parsed.ec != errc()) {
+                continue;
+            }
+            bool secret = parsed.ptr == text.data() + tab - 1 && *parsed.ptr == '*';
+            if (parsed.ptr != text.data() + tab && !secret) {
+                continue;
+            }
+            entries.push_back({offset, secret ? "Replay-secret-" + text.substr(tab + 1) : text.substr(tab + 1)});
+        }
+        return true;
+    }
+
+    // speed 1 keeps the recorded pacing, 2 halves it, 0 replays without waiting
+    SessionReplayer(vector<Entry>&& entries, double speed, const string& statsPath)
+        : entries(std::move(entries)), speed(speed), statsPath(statsPath) {}
+
+    // Also runs on exit(0) from the menus, as the replayer is a static object
+    ~SessionReplayer() {
+        auto finished = chrono::steady_clock::now();
+        if (next > 0) {
+            latenciesUs.push_back(chrono::duration<double, micro>(finished - deliveredAt).count());
+        }
+        ofstream stats(statsPath);
+        stats << latenciesUs.size() << '\t' << chrono::duration<double, milli>(finished - started).count() << '\n';
+        for (double latency : latenciesUs) {
+            stats << latency << '\n';
+        }
+    }
+
+protected:
+    int_type underflow() override {
+        auto now = chrono::steady_clock::now();
+        if (next == 0) {
+            started = now;
+        } else {
+            latenciesUs.push_back(chrono::duration<double, micro>(now - deliveredAt).count());
+        }
+        if (next == entries.size()) {
+            exit(0); // the menus never reach end of input on their own
+        }
+        if (speed > 0) {
+            auto due = started + chrono::microseconds(static_cast<long long>(entries[next].offsetMs * 1000 / speed));
+            while (chrono::steady_clock::now() < due && IdleLoop::getInstance()->runStep()) {
+            }
+            this_thread::sleep_until(due);
+        }
+        line = entries[next++].line + '\n';
+        setg(&line[0], &line[0], &line[0] + line.size());
+        deliveredAt = chrono::steady_clock::now();
+        return traits_type::to_int_type(line[0]);
+    }
+
+private:
+    vector<Entry> entries;
+    size_t next = 0;
+    double speed;
+    string statsPath;
+    string line;
+    vector<double> latenciesUs;
+    chrono::steady_clock::time_point started, deliveredAt;
+};
+
+/*
+    Runs a trace on several concurrent replayers. Each replayer is a separate process of this
+    program, so every one starts from a fresh account manager with its own expense store files;
+    their per-operation latencies come back through a stats file and are merged here.
+*/
+class ReplayHarness {
+public:
+    struct Summary {
+        size_t replayers = 0;
+        size_t operations = 0;
+        double wallMs = 0;
+        QuantileSketch latencyUs;
+    };
+
+    static bool run(const string& self, const string& tracePath, double speed, size_t replayers, Summary& summary) {
+#ifdef _WIN32
+        const string NULL_DEVICE = "NUL";
+#else
+        const string NULL_DEVICE = "/dev/null";
+#endif
+        auto started = chrono::steady_clock::now();
+        vector<future<int>> running;
+        for (size_t index = 0; index < replayers; ++index) {
+            string command = "\"" + self + "\" --replay-worker \"" + tracePath + "\" " + to_string(speed) + " \""
+                           + statsPath(tracePath, index) + "\" " + to_string(index)
+                           + " < " + NULL_DEVICE + " > " + NULL_DEVICE + " 2>&1";
+#ifdef _WIN32
+            command = "\"" + command + "\""; // cmd strips the outer quotes
+#endif
+            running.push_back(async(launch::async, [command] { return system(command.c_str()); }));
+        }
+        for (auto& replayer : running) {
+            replayer.get();
+        }
+        summary.wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+
+        for (size_t index = 0; index < replayers; ++index) {
+            ifstream stats(statsPath(tracePath, index));
+            size_t operations;
+            double replayMs, latency;
+            if (!(stats >> operations >> replayMs)) {
+                return false;
+            }
+            while (stats >> latency) {
+                summary.latencyUs.add(latency);
+            }
+            summary.operations += operations;
+            summary.replayers++;
+            stats.close();
+            remove(statsPath(tracePath, index).c_str());
+        }
+        return true;
+    }
+
+    // One replayer, in the worker process
+    static int runWorker(const string& tracePath, double speed, const string& stats, size_t index) {
+        vector<SessionReplayer::Entry> entries;
+        if (!SessionReplayer::loadTrace(tracePath, entries)) {
+            return 1;
+        }
+        AccountManager::getInstance()->setExpenseStore(
+            unique_ptr<ExpenseStore>(new FileExpenseStore("replay" + to_string(index) + "_")));
+        static SessionReplayer replayer(std::move(entries), speed, stats);
+        // Destroyed before the replayer, also on exit(0) at the end of the trace
+        static struct ScratchStore {
+            ~ScratchStore() { AccountManager::getInstance()->discardStore(); }
+        } scratchStore;
+        cin.rdbuf(&replayer);
+        StartScreen startScreen;
+        startScreen.handleStartMenu();
+        return 0;
+    }
+
+private:
+    static string statsPath(const string& tracePath, size_t index) {
+        return tracePath + ".replay" + to_string(index);
+    }
+};
+
+int main(int argc, char* argv[]) {
+    IdleLoop::getInstance()->addSource([] { return AccountManager::getInstance()->runMaintenance(); });
+
+    // Exchange rates are optional; without a table every expense is taken as base currency
+    size_t loadedRates = 0;
+    vector<string> rateErrors;
+    FxRates::getInstance()->load("fx_rates.csv", loadedRates, rateErrors);
+
+    vector<string> args(argv + 1, argv + argc);
+    if (args.size() == 5 && args[0] == "--replay-worker") {
+        return ReplayHarness::runWorker(args[1], atof(args[2].c_str()), args[3], static_cast<size_t>(atoi(args[4].c_str())));
+    }
+    if (args.size() >= 2 && args[0] == "--replay") {
+        double speed = 1;
+        size_t replayers = 1;
+        for (size_t i = 2; i + 1 < args.size(); i += 2) {
+            if (args[i] == "--speed") {
+                speed = max(0.0, atof(args[i + 1].c_str()));
+            } else if (args[i] == "--replayers") {
+                replayers = static_cast<size_t>(max(1, atoi(args[i + 1].c_str())));
+            }
+        }
+        ReplayHarness::Summary summary;
+        if (!ReplayHarness::run(argv[0], args[1], speed, replayers, summary)) {
+            cout << "> Unable to replay '" << args[1] << "'." << endl;
+            return 1;
+        }
+        cout << "REPLAYERS: " << summary.replayers << "\tSPEED: ";
+        if (speed > 0) {
+            cout << speed << "x" << endl;
+        } else {
+            cout << "flat out" << endl;
+        }
+        cout << "OPERATIONS: " << summary.operations << " in " << summary.wallMs << " ms ("
+             << summary.operations * 1000.0 / max(summary.wallMs, 1e-3) << " ops/s)" << endl;
+        cout << "LATENCY (ms): p50 " << summary.latencyUs.quantile(0.5) / 1000 << "\tp90 " << summary.latencyUs.quantile(0.9) / 1000
+             << "\tp99 " << summary.latencyUs.quantile(0.99) / 1000 << "\tmax " << summary.latencyUs.quantile(1) / 1000 << endl;
+        return 0;
+    }
+
+    static IdleInput idleInput(cin.rdbuf());
+    cin.rdbuf(&idleInput);
+
+    static unique_ptr<SessionRecorder> recorder; // static, so exit(0) from the menus still closes the trace
+    if (args.size() == 2 && args[0] == "--record") {
+        recorder.reset(new SessionRecorder(cin.rdbuf(), args[1]));
+        if (!recorder->isOpen()) {
+            cout << "> Unable to write '" << args[1] << "'." << endl;
+            return 1;
+        }
+        cin.rdbuf(recorder.get());
+    }
+
     StartScreen startScreen;
     startScreen.handleStartMenu();
     return 0;
@@ -0,0 +1,1143 @@
+// Checks for the data structures behind the expense tracker. Build and run from the repository root:
+//     g++ -std=c++17 -O2 -o expense_tests tests/tests.cpp && ./expense_tests
+// The whole program is compiled in with its main renamed, so every class is reachable as is.
+#include <random>
+
+#define main expenseTrackerMain
+#include "../FINAL-PROJECT.cpp"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            cout << "  " << __FILE__ << ":" << __LINE__ << ": " << #condition << endl;     \
+            failures++;                                                                    \
+        }                                                                                  \
+    } while (0)
+
+static shared_ptr<Expense> makeExpense(int id, const string& category, double amount, const string& date,
+                                       uint64_t tags = 0, uint16_t currency = CurrencyCode::BASE) {
+    auto expense = make_shared<DetailedExpense>(id, category, amount, date);
+    expense->setTags(tags);
+    expense->setCurrency(currency);
+    return expense;
+}
+
+// Idle users' histories are written back least recently used first once the memory budget is
+// exceeded, and come back unchanged the next time they are accessed
+static void testHistoryEviction() {
+    typedef map<int, pair<double, string>> Snapshot;
+    auto snapshot = [](const User& user) {
+        Snapshot rows;
+        user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+            rows[expense->getId()] = {expense->getAmount(), expense->getCategory() + "@" + expense->getDate()};
+        });
+        return rows;
+    };
+    AccountManager* accounts = AccountManager::getInstance();
+    accounts->setExpenseStore(unique_ptr<ExpenseStore>(new FileExpenseStore("lru_test_")));
+    vector<string> names;
+    vector<Snapshot> saved;
+    for (int i = 0; i < 5; ++i) {
+        names.push_back("lru_test_" + to_string(i));
+        CHECK(accounts->registerUser(names[i], "secret", 1000));
+        User* user = accounts->getUser(names[i]);
+        for (int id = 1; id <= 300; ++id) {
+            user->addExpense(makeExpense(id, id % 2 ? "Food" : "Rent", i * 1000 + id + 0.5, DateUtil::toString(20000 + id)));
+        }
+        saved.push_back(snapshot(*user));
+    }
+    auto find = [&](int i) -> const User& {
+        const vector<User>& users = accounts->getUsers();
+        return *find_if(users.begin(), users.end(), [&](const User& user) { return user.getUsername() == names[i]; });
+    };
+    auto resident = [&](int i) { return find(i).isHistoryLoaded(); };
+
+    size_t budget = find(0).estimateHistoryBytes() * 5 / 2; // room for two of the five
+    HistoryCacheStats before = accounts->getCacheStats();
+    accounts->setMemoryBudget(budget);
+    CHECK(accounts->getCacheStats().evictions == before.evictions + 3);
+    CHECK(accounts->getCacheStats().residentBytes <= budget);
+    CHECK(!resident(0) && !resident(1) && !resident(2) && resident(3) && resident(4));
+
+    // Loading the least recent history back makes room by writing out the next one in line
+    User* reloaded = accounts->getUser(names[0]);
+    HistoryCacheStats after = accounts->getCacheStats();
+    CHECK(after.misses == before.misses + 1 && after.evictions == before.evictions + 4);
+    CHECK(reloaded && snapshot(*reloaded) == saved[0]);
+    CHECK(resident(0) && !resident(3) && resident(4));
+    User* again = accounts->getUser(names[3]);
+    CHECK(again && snapshot(*again) == saved[3] && again->nextExpenseId() == 301);
+
+    accounts->discardStore();
+    accounts->setMemoryBudget(64 * 1024 * 1024);
+    accounts->setExpenseStore(unique_ptr<ExpenseStore>(new FileExpenseStore()));
+}
+
+// Ids, days and cents are stored as zigzag varint deltas, so the rows go up and down on purpose:
+// negative day deltas, days before 1970, sub-cent and large amounts, undated rows, tags and currencies
+static void testStoreRoundTrip() {
+    uint16_t usd = CurrencyCode::BASE;
+    CurrencyCode::parse("USD", usd);
+    vector<shared_ptr<Expense>> saved;
+    for (int i = 0; i < 300; ++i) {
+        int dayNumber = (i % 3 == 0 ? -1 : 1) * (i * 37 % 4000);
+        string date = i % 50 == 7 ? "someday" : DateUtil::toString(dayNumber);
+        double amount = i % 5 == 0 ? i * 1.005 : i % 7 == 0 ? 1e12 + i : i + 0.25;
+        saved.push_back(makeExpense(i * 3 + 1, i % 4 ? "Food" : "Rent>Flat", amount, date,
+                                    i % 6 ? 0 : uint64_t(1) << (i % 64), i % 9 ? CurrencyCode::BASE : usd));
+    }
+
+    FileExpenseStore store;
+    const string username = "store_round_trip_test";
+    store.save(username, saved);
+    vector<shared_ptr<Expense>> loaded;
+    CHECK(store.load(username, loaded));
+    CHECK(loaded.size() == saved.size());
+    for (size_t i = 0; i < min(saved.size(), loaded.size()); ++i) {
+        CHECK(loaded[i]->getId() == saved[i]->getId());
+        CHECK(loaded[i]->getCategory() == saved[i]->getCategory());
+        CHECK(loaded[i]->getAmount() == saved[i]->getAmount());
+        CHECK(loaded[i]->getDate() == saved[i]->getDate());
+        CHECK(loaded[i]->getTags() == saved[i]->getTags());
+        CHECK(loaded[i]->getCurrency() == saved[i]->getCurrency());
+    }
+
+    // A range scan may visit whole blocks around the range but never misses a row inside it
+    int fromDay = -500, toDay = 500;
+    set<int> expected, visited;
+    for (const auto& expense : saved) {
+        int dayNumber;
+        if (DateUtil::toDayNumber(expense->getDate(), dayNumber) && dayNumber >= fromDay && dayNumber <= toDay) {
+            expected.insert(expense->getId());
+        }
+    }
+    store.scan(username, fromDay, toDay, [&](const shared_ptr<Expense>& expense) { visited.insert(expense->getId()); });
+    CHECK(includes(visited.begin(), visited.end(), expected.begin(), expected.end()));
+    store.discard(username);
+    CHECK(!store.load(username, loaded));
+}
+
+// Random adds and withdrawals that grow the tree on both sides, against a plain per-day map
+static void testSpendIndexTotals() {
+    DailySpendIndex index;
+    map<int, double> daily;
+    mt19937 random(28);
+    for (int i = 0; i < 2000; ++i) {
+        int dayNumber = 20000 + static_cast<int>(random() % 3000) - 1500;
+        double amount = static_cast<double>(random() % 10000) / 100 * (random() % 4 == 0 ? -1 : 1);
+        index.add(dayNumber, amount);
+        daily[dayNumber] += amount;
+    }
+    for (int i = 0; i < 500; ++i) {
+        int fromDay = 20000 + static_cast<int>(random() % 4000) - 2000;
+        int toDay = fromDay + static_cast<int>(random() % 1000);
+        double expected = 0;
+        for (auto it = daily.lower_bound(fromDay); it != daily.end() && it->first <= toDay; ++it) {
+            expected += it->second;
+        }
+        CHECK(fabs(index.total(fromDay, toDay) - expected) < 1e-6);
+    }
+    CHECK(index.total(20010, 20000) == 0);
+}
+
+// Feeds a report its menu answers and returns what it printed
+static string runReport(const string& input, const function<void()>& report) {
+    istringstream in(input);
+    ostringstream out;
+    streambuf* oldIn = cin.rdbuf(in.rdbuf());
+    streambuf* oldOut = cout.rdbuf(out.rdbuf());
+    report();
+    cin.rdbuf(oldIn);
+    cout.rdbuf(oldOut);
+    return out.str();
+}
+
+// The largest-expenses and percentile reports agree with sorting every row, over more rows
+// than one conversion chunk holds
+static void testTopNAndPercentiles() {
+    User user("top_n_test", "secret", 1e9);
+    const char* CATEGORIES[] = {"Food", "Rent", "Travel"};
+    map<string, vector<double>> byCategory;
+    vector<pair<double, int>> all;
+    for (int id = 1; id <= 10000; ++id) {
+        double amount = static_cast<double>(id * 7919 % 100003) / 100 + 1; // all different
+        user.addExpense(makeExpense(id, CATEGORIES[id % 3], amount, DateUtil::toString(18000 + id % 2000)));
+        byCategory[CATEGORIES[id % 3]].push_back(amount);
+        all.emplace_back(amount, id);
+    }
+    ExpenseManager manager;
+
+    const int COUNT = 25;
+    istringstream largest(runReport(to_string(COUNT) + "\n3\n", [&] { manager.reportLargestExpenses(user); }));
+    vector<pair<double, int>> listed;
+    for (string line; getline(largest, line);) {
+        istringstream fields(line);
+        int id;
+        double amount;
+        if (fields >> id >> amount) {
+            listed.emplace_back(amount, id);
+        }
+    }
+    sort(all.rbegin(), all.rend());
+    CHECK(listed.size() == COUNT);
+    for (size_t i = 0; i < min<size_t>(listed.size(), COUNT); ++i) {
+        CHECK(listed[i].second == all[i].second && fabs(listed[i].first - all[i].first) < 0.005);
+    }
+
+    // Each reported quantile is within the sketch's 1% of the exact one
+    istringstream percentiles(runReport("3\n", [&] { manager.reportCategoryPercentiles(user); }));
+    size_t reported = 0;
+    for (string line; getline(percentiles, line);) {
+        istringstream fields(line);
+        string category;
+        long long count;
+        double median, p90;
+        if (!(fields >> category >> count >> median >> p90)) {
+            continue;
+        }
+        vector<double>& amounts = byCategory[category];
+        sort(amounts.begin(), amounts.end());
+        CHECK(count == static_cast<long long>(amounts.size()));
+        double exactMedian = amounts[llround(0.5 * (amounts.size() - 1))];
+        double exactP90 = amounts[llround(0.9 * (amounts.size() - 1))];
+        CHECK(fabs(median - exactMedian) <= 0.0101 * exactMedian);
+        CHECK(fabs(p90 - exactP90) <= 0.0101 * exactP90);
+        reported++;
+    }
+    CHECK(reported == 3);
+}
+
+// Each malformed amount or date maps to its own error, and out-of-range values are refused
+static void testParseErrors() {
+    const pair<const char*, ParseError> AMOUNTS[] = {
+        {"12.50", ParseError::None},       {"", ParseError::Empty},
+        {"12a", ParseError::NotNumeric},   {"1.2.3", ParseError::NotNumeric},
+        {"-5", ParseError::NotNumeric},    {".5", ParseError::LeadingDecimal},
+        {"1e5", ParseError::NotNumeric},   {"9999999999999999999999999999999999999999", ParseError::None},
+    };
+    for (const auto& entry : AMOUNTS) {
+        double value;
+        CHECK(InputValidator::parseAmount(entry.first, value) == entry.second);
+    }
+    double huge;
+    CHECK(InputValidator::parseAmount(string(400, '9'), huge) == ParseError::OutOfRange);
+
+    const pair<const char*, ParseError> DATES[] = {
+        {"2024-02-29", ParseError::None},         {"2023-02-29", ParseError::InvalidDate},
+        {"2025-04-31", ParseError::InvalidDate},  {"2025-12-31", ParseError::None},
+        {"2025-13-01", ParseError::InvalidDate},  {"2025-00-10", ParseError::InvalidDate},
+        {"2025-01-00", ParseError::InvalidDate},  {"1900-02-29", ParseError::InvalidDate},
+        {"2000-02-29", ParseError::None},         {"2025-1-01", ParseError::BadDateFormat},
+        {"2025/01/01", ParseError::BadDateFormat}, {"2025-01-0a", ParseError::BadDateFormat},
+        {"", ParseError::BadDateFormat},
+    };
+    for (const auto& entry : DATES) {
+        int dayNumber = 0;
+        CHECK(DateUtil::parse(entry.first, dayNumber) == entry.second);
+        if (entry.second == ParseError::None) {
+            CHECK(DateUtil::toString(dayNumber) == entry.first);
+        }
+    }
+
+    bool threw = false;
+    try {
+        InputValidator::validateIsNumeric(string(400, '9'));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+// Removes enough rows to start a background compaction, keeps removing, retagging and adding
+// while it runs, then checks that every id and tag still reaches the right row once it is swapped in
+static void testCompactionSlotRemap() {
+    User user("compaction", "secret", 1e9);
+    int flagged = user.internTag("flagged");
+    map<int, pair<double, bool>> expected; // id -> amount, tagged
+    int lastId = 0;
+    auto add = [&](bool tagged) {
+        ++lastId;
+        user.addExpense(makeExpense(lastId, "Food", lastId, "2025-06-15", tagged ? uint64_t(1) << flagged : 0));
+        expected[lastId] = {lastId, tagged};
+    };
+    auto remove = [&](int id) {
+        CHECK(user.removeExpense(id) == (expected.erase(id) == 1));
+    };
+    for (int i = 0; i < 4000; ++i) {
+        add(i % 3 == 0);
+    }
+    for (int id = 1; id <= 2000; id += 1) {
+        if (id % 4 != 0) {
+            remove(id);
+        }
+    }
+    for (int id = 2001; id <= 2400; ++id) { // meanwhile: removes, retags and appends
+        if (id % 2) {
+            remove(id);
+        } else if (auto expense = user.findExpense(id)) {
+            bool tagged = !expected[id].second;
+            user.setExpenseTags(*expense, tagged ? uint64_t(1) << flagged : 0);
+            expected[id].second = tagged;
+        }
+    }
+    for (int i = 0; i < 300; ++i) {
+        add(i % 2 == 0);
+    }
+    this_thread::sleep_for(chrono::milliseconds(200));
+    CHECK(!user.removeExpense(-1)); // collects the finished compaction
+    remove(3999);                   // and removals keep working on the remapped slots
+
+    CHECK(user.getExpenseCount() == expected.size());
+    for (const auto& row : expected) {
+        auto expense = user.findExpense(row.first);
+        CHECK(expense && expense->getAmount() == row.second.first);
+    }
+    CHECK(!user.findExpense(1) && !user.findExpense(2001));
+    TagQuery query;
+    string error;
+    CHECK(query.parse("flagged", user.getTagDictionary(), error));
+    set<int> tagged;
+    user.forEachTagged(query, [&](const shared_ptr<Expense>& expense) { tagged.insert(expense->getId()); });
+    set<int> expectedTagged;
+    for (const auto& row : expected) {
+        if (row.second.second) {
+            expectedTagged.insert(row.first);
+        }
+    }
+    CHECK(tagged == expectedTagged);
+}
+
+// The indexes of a user match those of a user given the same rows from scratch
+static bool matchesRebuilt(const User& user) {
+    User rebuilt("rebuilt", "secret", user.getBudget());
+    user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+        rebuilt.addExpense(makeExpense(expense->getId(), expense->getCategory(), expense->getAmount(), expense->getDate(),
+                                       expense->getTags(), expense->getCurrency()));
+    });
+    vector<pair<string, double>> totals = user.getCategoryStats().totals(0, numeric_limits<int>::max());
+    vector<pair<string, double>> expected = rebuilt.getCategoryStats().totals(0, numeric_limits<int>::max());
+    sort(totals.begin(), totals.end());
+    sort(expected.begin(), expected.end());
+    bool same = user.getExpenseCount() == rebuilt.getExpenseCount() && totals.size() == expected.size()
+             && user.getCategoryNames().size() == rebuilt.getCategoryNames().size();
+    for (size_t i = 0; same && i < totals.size(); ++i) {
+        same = totals[i].first == expected[i].first && fabs(totals[i].second - expected[i].second) < 1e-6;
+    }
+    for (int dayNumber = 19990; same && dayNumber <= 20100; ++dayNumber) {
+        same = fabs(user.getSpendBetween(dayNumber, dayNumber) - rebuilt.getSpendBetween(dayNumber, dayNumber)) < 1e-6;
+    }
+    user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+        same = same && user.countDuplicates(*expense) == rebuilt.countDuplicates(*expense);
+    });
+    return same;
+}
+
+// A bulk edit changes every matching row with one version bump and leaves the indexes as if the
+// rows had been entered that way; an adjustment that would be refused is previewed without a change
+static void testBulkEdit() {
+    User user("bulk_edit_test", "secret", 1e9);
+    for (int id = 1; id <= 600; ++id) {
+        user.addExpense(makeExpense(id, id % 3 ? "Food" : "Rent", 5 + id % 40, DateUtil::toString(20000 + id % 90)));
+    }
+    ExpenseFilter food;
+    food.categoryLower = "food";
+    food.fromDay = 20010;
+    food.toDay = 20040;
+    size_t matching = 0, belowTen = 0;
+    user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+        if (food.matches(*expense)) {
+            matching++;
+            belowTen += expense->getAmount() <= 10;
+        }
+    });
+    double spent = user.getSpendBetween(19990, 20100);
+    unsigned long long version = user.getVersion();
+
+    User::BulkAdjustment preview = user.previewAdjustment(food, -10);
+    CHECK(preview.rows == matching && preview.nonPositive == belowTen && belowTen > 0);
+    CHECK(fabs(preview.addedSpend + 10.0 * matching) < 1e-6);
+    CHECK(user.getVersion() == version && user.getSpendBetween(19990, 20100) == spent);
+
+    CHECK(user.bulkEdit(food, BulkAction::SetCategory, "Groceries", 0) == matching);
+    CHECK(user.getVersion() == version + 1);
+    CHECK(user.previewAdjustment(food, 0).rows == 0);
+    CHECK(matchesRebuilt(user));
+
+    ExpenseFilter groceries;
+    groceries.categoryLower = "groceries";
+    CHECK(user.bulkEdit(groceries, BulkAction::AdjustAmount, "", 2.5) == matching);
+    CHECK(fabs(user.getSpendBetween(19990, 20100) - spent - 2.5 * matching) < 1e-6);
+    CHECK(matchesRebuilt(user));
+
+    ExpenseFilter days;
+    days.fromDay = 20000;
+    days.toDay = 20029;
+    size_t count = user.getExpenseCount();
+    size_t deleted = user.bulkEdit(days, BulkAction::Delete, "", 0);
+    CHECK(deleted > 0 && user.getExpenseCount() == count - deleted && user.getSpendBetween(20000, 20029) == 0);
+    CHECK(matchesRebuilt(user));
+
+    version = user.getVersion();
+    CHECK(user.bulkEdit(days, BulkAction::Delete, "", 0) == 0 && user.getVersion() == version);
+}
+
+// Precedence, negation and parentheses, per row with matches and per bitmap chunk with
+// forEachTagged over more rows than one chunk holds
+static void testTagQueryEvaluation() {
+    User user("tags", "secret", 1e9);
+    for (const char* name : {"work", "travel", "food", "cash"}) {
+        user.internTag(name);
+    }
+    const pair<const char*, function<bool(uint64_t)>> QUERIES[] = {
+        {"work", [](uint64_t t) { return (t & 1) != 0; }},
+        {"work | travel & food", [](uint64_t t) { return (t & 1) || ((t & 2) && (t & 4)); }},
+        {"(work | travel) & food", [](uint64_t t) { return ((t & 1) || (t & 2)) && (t & 4); }},
+        {"!work & !cash", [](uint64_t t) { return !(t & 1) && !(t & 8); }},
+        {"!(WORK | cash) | food & travel & cash", [](uint64_t t) { return !((t & 1) || (t & 8)) || ((t & 4) && (t & 2) && (t & 8)); }},
+    };
+
+    vector<shared_ptr<Expense>> batch;
+    for (int id = 1; id <= 70000; ++id) {
+        batch.push_back(makeExpense(id, "Misc", 1 + id % 90, "2025-03-01", static_cast<uint64_t>(id * 7 % 16)));
+    }
+    user.addExpenses(std::move(batch));
+    for (int id = 2; id <= 70000; id += 5) {
+        user.removeExpense(id);
+    }
+
+    for (const auto& entry : QUERIES) {
+        TagQuery query;
+        string error;
+        CHECK(query.parse(entry.first, user.getTagDictionary(), error));
+        for (uint64_t tags = 0; tags < 16; ++tags) {
+            CHECK(query.matches(tags) == entry.second(tags));
+        }
+        size_t visited = 0, wrong = 0;
+        user.forEachTagged(query, [&](const shared_ptr<Expense>& expense) {
+            visited++;
+            wrong += !entry.second(expense->getTags());
+        });
+        size_t expected = 0;
+        user.forEachExpense([&](const shared_ptr<Expense>& expense) { expected += entry.second(expense->getTags()); });
+        CHECK(wrong == 0);
+        CHECK(visited == expected);
+    }
+
+    for (const char* invalid : {"", "work &", "(work | food", "work food", "unknown", "work )"}) {
+        TagQuery query;
+        string error;
+        CHECK(!query.parse(invalid, user.getTagDictionary(), error));
+        CHECK(!error.empty());
+    }
+
+    // Nesting is capped, so a long run of "not"s or parentheses is refused instead of overflowing the stack
+    TagQuery query;
+    string error;
+    CHECK(query.parse(string(64, '(') + "work" + string(64, ')'), user.getTagDictionary(), error));
+    CHECK(!query.parse(string(65, '(') + "work" + string(65, ')'), user.getTagDictionary(), error));
+    string negations;
+    for (int i = 0; i < 100000; ++i) {
+        negations += "not ";
+    }
+    CHECK(!query.parse(negations + "work", user.getTagDictionary(), error) && !error.empty());
+
+    // The operators cannot be tag names
+    for (const char* reserved : {"and", "OR", "Not"}) {
+        CHECK(user.internTag(reserved) < 0);
+    }
+}
+
+// Unspent budget carries forward, a month without spending adds a whole budget, an overspent
+// month carries nothing, and spending added to an earlier month is reflected in later carries
+static void testBudgetLedgerRollover() {
+    auto day = [](int month, int dayOfMonth) { return DateUtil::toDayNumber(2025, month, dayOfMonth); };
+    BudgetLedger ledger;
+    ledger.configure(100, BudgetPeriod::Monthly, true);
+    ledger.add(day(1, 10), 30);
+    ledger.add(day(2, 5), 50);
+    ledger.add(day(4, 20), 10);
+
+    CHECK(ledger.summary(day(1, 31)).remaining() == 70);
+    CHECK(ledger.summary(day(2, 1)).carriedIn == 70);
+    CHECK(ledger.summary(day(2, 28)).remaining() == 120);
+    CHECK(ledger.summary(day(3, 15)).carriedIn == 120);
+    CHECK(ledger.summary(day(4, 1)).carriedIn == 220);
+    CHECK(ledger.summary(day(4, 1)).remaining() == 310);
+
+    ledger.add(day(1, 20), 200); // January is now overspent
+    CHECK(ledger.summary(day(1, 1)).remaining() == -130);
+    CHECK(ledger.summary(day(2, 1)).carriedIn == 0);
+    CHECK(ledger.summary(day(3, 1)).carriedIn == 50);
+    CHECK(ledger.summary(day(4, 1)).carriedIn == 150);
+    CHECK(ledger.history(day(5, 1)).size() == 5);
+
+    ledger.configure(100, BudgetPeriod::Monthly, false);
+    CHECK(ledger.summary(day(4, 1)).carriedIn == 0);
+    CHECK(ledger.summary(day(4, 1)).remaining() == 90);
+}
+
+// Monthly and yearly rules keep their day of the month, clamped to shorter months without drifting
+static void testRecurringMonthEnd() {
+    RecurringSchedule schedule;
+    const int FOREVER = numeric_limits<int>::max();
+    schedule.add(10, "Rent", DateUtil::toDayNumber(2024, 1, 31), FOREVER, RecurrenceUnit::Months, 1);
+    schedule.add(20, "Gym", DateUtil::toDayNumber(2024, 1, 31), FOREVER, RecurrenceUnit::Months, 2);
+    schedule.add(30, "Insurance", DateUtil::toDayNumber(2024, 2, 29), FOREVER, RecurrenceUnit::Years, 1);
+
+    int fromDay = DateUtil::toDayNumber(2024, 1, 1), toDay = DateUtil::toDayNumber(2028, 12, 31);
+    map<string, vector<string>> dates;
+    schedule.expand(fromDay, toDay, [&](const RecurringSchedule::Rule& rule, int dayNumber) {
+        dates[rule.category].push_back(DateUtil::toString(dayNumber));
+    });
+    const vector<string> rent = {"2024-01-31", "2024-02-29", "2024-03-31", "2024-04-30", "2024-05-31"};
+    CHECK(dates["Rent"].size() == 60 && equal(rent.begin(), rent.end(), dates["Rent"].begin()));
+    CHECK(dates["Rent"][13] == "2025-02-28");
+    const vector<string> gym = {"2024-01-31", "2024-03-31", "2024-05-31", "2024-07-31", "2024-09-30", "2024-11-30"};
+    CHECK(dates["Gym"].size() == 30 && equal(gym.begin(), gym.end(), dates["Gym"].begin()));
+    const vector<string> insurance = {"2024-02-29", "2025-02-28", "2026-02-28", "2027-02-28", "2028-02-29"};
+    CHECK(dates["Insurance"] == insurance);
+
+    // The O(1) counts agree with the expansion, including windows that start on a clamped day
+    int febFrom = DateUtil::toDayNumber(2025, 2, 28), febTo = DateUtil::toDayNumber(2025, 3, 30);
+    CHECK(schedule.total(febFrom, febTo) == 10 + 30);
+    CHECK(schedule.total(fromDay, toDay) == 60 * 10 + 30 * 20 + 5 * 30);
+}
+
+// Occurrences due in the current period come off the remaining budget and count toward category budgets
+static void testRecurringInBudgets() {
+    User user("recurring_budget_test", "secret", 1000);
+    int today = DateUtil::today();
+    int monthStart = DateUtil::periodStart(BudgetPeriod::Monthly, today);
+    CHECK(user.setCategoryBudget("Housing", 500, BudgetPeriod::Monthly));
+    user.takeBudgetAlerts();
+    user.addRecurring(300, "Housing > Rent", monthStart - 31, numeric_limits<int>::max(), RecurrenceUnit::Days, 1);
+    long long due = today - monthStart + 1;
+    CHECK(user.getRemainingBudget(today) == 1000 - 300.0 * due);
+    CHECK(user.getBudgetSummary(today).spent == 300.0 * due);
+    vector<CategoryBudgets::Status> budgets = user.listCategoryBudgets(today);
+    CHECK(budgets.size() == 1 && budgets[0].spent == 300.0 * due);
+    vector<string> alerts = user.takeBudgetAlerts();
+    CHECK(alerts.size() == 1 && alerts[0].find(due >= 2 ? "is over" : "has reached") != string::npos);
+
+    // Entered expenses add to the due occurrences, and the ledger history leaves the occurrences out
+    user.addExpense(makeExpense(1, "Food", 50, DateUtil::toString(today)));
+    CHECK(user.getRemainingBudget(today) == 1000 - 300.0 * due - 50);
+    CHECK(user.getBudgetHistory(today).back().spent == 50);
+}
+
+// Withdrawing amounts from the running mean and variance matches recomputing them from scratch
+static void testWelfordRemoval() {
+    CategoryMoments moments;
+    mt19937 random(40);
+    multiset<double> kept;
+    vector<double> added;
+    for (int i = 0; i < 1000; ++i) {
+        double amount = 50 + static_cast<double>(random() % 100000) / 100;
+        moments.add("Food", amount, 1);
+        added.push_back(amount);
+        kept.insert(amount);
+    }
+    for (size_t i = 0; i < added.size(); i += 3) {
+        moments.add("FOOD", added[i], -1);
+        kept.erase(kept.find(added[i]));
+    }
+    double mean = 0, m2 = 0;
+    for (double amount : kept) {
+        mean += amount;
+    }
+    mean /= kept.size();
+    for (double amount : kept) {
+        m2 += (amount - mean) * (amount - mean);
+    }
+    double stddev = sqrt(m2 / (kept.size() - 1));
+
+    double zScore = 0, runningMean = 0;
+    CHECK(moments.score("food", 2000, zScore, runningMean));
+    CHECK(fabs(runningMean - mean) < 1e-6 * mean);
+    CHECK(fabs(zScore - (2000 - mean) / stddev) < 1e-6);
+
+    // Withdrawing everything forgets the category
+    for (double amount : kept) {
+        moments.add("Food", amount, -1);
+    }
+    CHECK(!moments.score("Food", 2000, zScore, runningMean));
+}
+
+// As-of queries give the same answers after the history and its mutation log have been
+// written to the store and read back, as when a cold user is acquired again
+static void testMutationLogReload() {
+    typedef map<int, pair<double, string>> Snapshot;
+    auto snapshot = [](const User& user) {
+        Snapshot rows;
+        user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+            rows[expense->getId()] = {expense->getAmount(), expense->getDate()};
+        });
+        return rows;
+    };
+    auto limits = [](const User& user) {
+        map<string, double> paths;
+        for (const auto& setting : user.getCategoryBudgets().settings()) {
+            paths[setting.path] = setting.limit;
+        }
+        return paths;
+    };
+    User user("as_of_test", "secret", 100);
+    FileExpenseStore store;
+    mt19937 random(42);
+    vector<tuple<long long, Snapshot, double, uint16_t, map<string, double>>> marks;
+    const char* CURRENCIES[] = {"EUR", "USD", "JPY"};
+    int lastId = 0;
+    for (int round = 0; round < 4; ++round) {
+        for (int i = 0; i < 300; ++i) {
+            int op = static_cast<int>(random() % 20);
+            if (op < 12 || !user.hasExpenses()) {
+                user.addExpense(makeExpense(++lastId, "Food", 1 + random() % 50, DateUtil::toString(20000 + random() % 300)));
+            } else if (op < 18) {
+                user.removeExpense(1 + static_cast<int>(random() % lastId));
+            } else if (op == 18) {
+                user.setBudget(random() % 1000);
+            } else if (random() % 2) {
+                uint16_t code = CurrencyCode::BASE;
+                CurrencyCode::parse(CURRENCIES[random() % 3], code);
+                user.setBaseCurrency(code);
+            } else if (!user.setCategoryBudget(random() % 2 ? "food" : "food > lunch", 1 + random() % 500, BudgetPeriod::Monthly)) {
+                CHECK(false);
+            } else if (random() % 3 == 0) {
+                user.removeCategoryBudget("food");
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(2));
+        marks.emplace_back(MutationLog::now(), snapshot(user), user.getBudget(), user.getBaseCurrency(), limits(user));
+        this_thread::sleep_for(chrono::milliseconds(2));
+
+        store.save(user.getUsername(), user.liveExpenses());
+        store.saveLog(user.getUsername(), user.encodeMutationLog());
+        user.unloadHistory();
+        CHECK(user.getMutationLog().memoryBytes() == 0);
+        vector<shared_ptr<Expense>> history;
+        string log;
+        CHECK(store.load(user.getUsername(), history) && store.loadLog(user.getUsername(), log));
+        user.loadHistory(std::move(history), log);
+        CHECK(user.getMutationLog().memoryBytes() > 0);
+    }
+    for (const auto& mark : marks) {
+        unique_ptr<User> past = user.asOf(get<0>(mark));
+        CHECK(snapshot(*past) == get<1>(mark));
+        CHECK(past->getBudget() == get<2>(mark));
+        CHECK(past->getBaseCurrency() == get<3>(mark));
+        CHECK(limits(*past) == get<4>(mark));
+    }
+    store.discard(user.getUsername());
+
+    // A corrupted log restarts from the loaded state instead of failing the load
+    vector<shared_ptr<Expense>> history = user.liveExpenses();
+    size_t rows = history.size();
+    user.unloadHistory();
+    user.loadHistory(std::move(history), "MLOG2 truncated");
+    CHECK(user.getExpenseCount() == rows);
+    CHECK(user.getMutationLog().checkpointCount() == 1 && user.getMutationLog().size() == 0);
+
+    // An as-of copy converts with the quotes dated by its day only: a later first quote is unseen
+    User traveler("as_of_rates_test", "secret", 1000);
+    uint16_t eur;
+    CurrencyCode::parse("EUR", eur);
+    traveler.addExpense(makeExpense(1, "Hotel", 10, DateUtil::toString(DateUtil::today() - 3), 0, eur));
+    {
+        ofstream rates("as_of_rates_test.csv");
+        rates << "date,code,rate\n" << DateUtil::toString(DateUtil::today() + 10) << ",EUR,4\n";
+    }
+    size_t loaded;
+    vector<string> errors;
+    CHECK(FxRates::getInstance()->load("as_of_rates_test.csv", loaded, errors) && loaded == 1);
+    traveler.syncRates();
+    CHECK(traveler.getSpendBetween(DateUtil::today() - 30, DateUtil::today()) == 40);
+    unique_ptr<User> past = traveler.asOf(MutationLog::now());
+    CHECK(past->getSpendBetween(DateUtil::today() - 30, DateUtil::today()) == 10);
+    ofstream("as_of_rates_test.csv", ios::trunc).close();
+    FxRates::getInstance()->load("as_of_rates_test.csv", loaded, errors);
+    remove("as_of_rates_test.csv");
+}
+
+// Misspelt, partial and differently cased queries find their category among thousands of
+// others, best match first, and a category no longer in use drops out of the results
+static void testCategorySearch() {
+    CategorySearchIndex index;
+    for (int i = 0; i < 3000; ++i) {
+        index.add("Item " + to_string(i), 1);
+    }
+    for (const char* name : {"Groceries", "Dining Out", "Coffee", "Health Insurance", "groceries"}) {
+        index.add(name, 1);
+    }
+    auto best = [&](const string& query) {
+        vector<CategorySearchIndex::Match> matches = index.search(query, 5);
+        return matches.empty() ? string() : matches[0].name;
+    };
+    vector<CategorySearchIndex::Match> exact = index.search("GROCERIES", 1);
+    CHECK(exact.size() == 1 && exact[0].name == "Groceries" && exact[0].score == 1 && exact[0].expenseCount == 2);
+    CHECK(best("grocries") == "Groceries");
+    CHECK(best("dining") == "Dining Out");
+    CHECK(best("insurance") == "Health Insurance");
+    CHECK(best("cofee") == "Coffee");
+    CHECK(best("item 1234") == "Item 1234");
+    CHECK(index.search("zzzz", 5).empty());
+
+    vector<CategorySearchIndex::Match> ranked = index.search("item 12", 10);
+    CHECK(ranked.size() == 10 && ranked[0].name == "Item 12");
+    for (size_t i = 1; i < ranked.size(); ++i) {
+        CHECK(ranked[i - 1].score >= ranked[i].score);
+    }
+
+    index.add("Coffee", -1);
+    CHECK(best("coffee") != "Coffee");
+    CHECK(index.size() == 3003);
+}
+
+// Converting a result set in one batch gives each row the rate quoted for its own day, carried
+// over the gaps between quotes, and a quote date cap hides the quotes dated after it
+static void testBatchedConversion() {
+    uint16_t eur = CurrencyCode::BASE, gbp = CurrencyCode::BASE;
+    CurrencyCode::parse("EUR", eur);
+    CurrencyCode::parse("GBP", gbp);
+    int first = DateUtil::toDayNumber(2024, 3, 1);
+    {
+        ofstream rates("batched_rates_test.csv");
+        rates << "date,code,rate\n"
+              << DateUtil::toString(first) << ",EUR,1.1\n"
+              << DateUtil::toString(first + 5) << ",EUR,1.2\n"
+              << DateUtil::toString(first + 2) << ",GBP,1.25\n";
+    }
+    size_t loaded;
+    vector<string> errors;
+    CHECK(FxRates::getInstance()->load("batched_rates_test.csv", loaded, errors) && loaded == 3 && errors.empty());
+    const FxRates& fx = *FxRates::getInstance();
+    CHECK(fx.rate(eur, first - 10) == 1.1 && fx.rate(eur, first + 4) == 1.1);
+    CHECK(fx.rate(eur, first + 5) == 1.2 && fx.rate(eur, first + 400) == 1.2);
+    CHECK(fx.rate(eur, first + 7, first + 4) == 1.1); // the second quote is not known yet
+    CHECK(fx.rate(gbp, first + 7, first + 1) == 1);   // nor is the first
+    CHECK(fx.factor(eur, gbp, first + 7, first + 1) == 1.1);
+
+    User user("batched_rates_test", "secret", 1e9);
+    user.setBaseCurrency(gbp);
+    vector<shared_ptr<Expense>> rows;
+    for (int i = 0; i < 200; ++i) {
+        string date = i == 199 ? "someday" : DateUtil::toString(first - 3 + i % 12);
+        rows.push_back(makeExpense(i + 1, "Travel", 10 + i, date, 0, i % 3 == 0 ? eur : i % 3 == 1 ? gbp : CurrencyCode::BASE));
+    }
+    vector<double> batched = user.toBase(rows);
+    CHECK(batched.size() == rows.size());
+    bool same = true;
+    for (size_t i = 0; i < min(batched.size(), rows.size()); ++i) {
+        int dayNumber = 0;
+        DateUtil::toDayNumber(rows[i]->getDate(), dayNumber);
+        double expected = rows[i]->getAmount() * fx.factor(rows[i]->getCurrency(), gbp, dayNumber);
+        same = same && batched[i] == expected && user.toBase(*rows[i]) == expected;
+    }
+    CHECK(same);
+    CHECK(fabs(batched[0] - 10 * 1.1 / 1.25) < 1e-12 && batched[1] == 11 && batched[2] == 12);
+    CHECK(fabs(batched[9] - 19 * 1.2 / 1.25) < 1e-12); // quoted on its own day
+
+    ofstream("batched_rates_test.csv", ios::trunc).close();
+    FxRates::getInstance()->load("batched_rates_test.csv", loaded, errors);
+    remove("batched_rates_test.csv");
+}
+
+// The filter never hides a recorded fingerprint as it grows, rarely passes an unknown one, and
+// the exact counts confirm every answer; a removed or changed expense is no longer a duplicate
+static void testDuplicateDetection() {
+    const uint64_t SPREAD = 0x9e3779b97f4a7c15ull;
+    ExpenseFingerprints fingerprints(0.01);
+    for (uint64_t key = 1; key <= 20000; ++key) {
+        fingerprints.add(key * SPREAD, 1);
+    }
+    size_t missed = 0, passed = 0, confirmed = 0;
+    for (uint64_t key = 1; key <= 20000; ++key) {
+        missed += fingerprints.count(key * SPREAD) != 1;
+    }
+    for (uint64_t key = 20001; key <= 120000; ++key) {
+        passed += fingerprints.mayContain(key * SPREAD);
+        confirmed += fingerprints.count(key * SPREAD);
+    }
+    CHECK(missed == 0 && confirmed == 0 && passed < 2000);
+    for (uint64_t key = 1; key <= 10000; ++key) {
+        fingerprints.add(key * SPREAD, -1);
+    }
+    for (uint64_t key = 1; key <= 20000; ++key) {
+        missed += fingerprints.count(key * SPREAD) != (key > 10000);
+    }
+    CHECK(missed == 0);
+
+    uint16_t eur = CurrencyCode::BASE;
+    CurrencyCode::parse("EUR", eur);
+    User user("duplicate_test", "secret", 1e9);
+    user.addExpense(makeExpense(1, "Food", 12.5, "2025-03-01"));
+    user.addExpense(makeExpense(2, "  FOOD ", 12.5, "2025-03-01"));
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.5, "2025-03-01")) == 2);
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.51, "2025-03-01")) == 0);
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.5, "2025-03-02")) == 0);
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.5, "2025-03-01", 0, eur)) == 0);
+    CHECK(user.removeExpense(1));
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.5, "2025-03-01")) == 1);
+    user.modifyExpense(*user.findExpense(2), 13, CurrencyCode::BASE, "Food", "2025-03-01");
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 12.5, "2025-03-01")) == 0);
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 13, "2025-03-01")) == 1);
+    CHECK(user.removeExpense(2));
+    CHECK(user.countDuplicates(*makeExpense(3, "food", 13, "2025-03-01")) == 0);
+}
+
+// Just enough of FlatBuffers to walk the Arrow IPC metadata: tables, scalars, offsets and vectors
+class FlatBufferTable {
+public:
+    FlatBufferTable(const string& buffer, size_t position) : buffer(&buffer), position(position) {}
+
+    static FlatBufferTable root(const string& buffer) { return FlatBufferTable(buffer, read<uint32_t>(buffer, 0)); }
+
+    bool has(int id) const { return fieldPosition(id) != 0; }
+
+    template <typename T>
+    T scalar(int id, T fallback = T()) const {
+        size_t at = fieldPosition(id);
+        return at ? read<T>(*buffer, at) : fallback;
+    }
+
+    FlatBufferTable table(int id) const { return FlatBufferTable(*buffer, target(fieldPosition(id))); }
+
+    string text(int id) const {
+        size_t at = target(fieldPosition(id));
+        return buffer->substr(at + 4, read<uint32_t>(*buffer, at));
+    }
+
+    // Element count and position of the first element
+    pair<size_t, size_t> vector(int id) const {
+        size_t at = target(fieldPosition(id));
+        return {read<uint32_t>(*buffer, at), at + 4};
+    }
+
+    // Element i of a vector of tables
+    FlatBufferTable element(int id, size_t i) const { return FlatBufferTable(*buffer, target(vector(id).second + 4 * i)); }
+
+    template <typename T>
+    static T read(const string& buffer, size_t at) {
+        T value;
+        memcpy(&value, buffer.data() + at, sizeof(T));
+        return value;
+    }
+
+private:
+    const string* buffer;
+    size_t position;
+
+    size_t target(size_t at) const { return at + read<uint32_t>(*buffer, at); }
+
+    size_t fieldPosition(int id) const {
+        size_t vtable = position - read<int32_t>(*buffer, position);
+        size_t entry = 4 + 2 * static_cast<size_t>(id);
+        if (entry >= read<uint16_t>(*buffer, vtable)) {
+            return 0;
+        }
+        uint16_t offset = read<uint16_t>(*buffer, vtable + entry);
+        return offset ? position + offset : 0;
+    }
+};
+
+// Reads the exporter's stream back: the schema, the dictionaries and the buffers of every record batch
+struct ArrowStream {
+    struct Batch {
+        int64_t rows = 0;
+        vector<pair<int64_t, int64_t>> nodes; // (length, null count) per column
+        vector<string> buffers;               // body slices in order
+    };
+
+    vector<string> fieldNames;
+    vector<int64_t> fieldDictionaries; // dictionary id, or -1
+    map<int64_t, vector<string>> dictionaries;
+    vector<Batch> batches;
+
+    bool read(const string& path) {
+        ifstream in(path, ios::binary);
+        string metadata, body;
+        while (true) {
+            uint32_t prefix[2];
+            if (!in.read(reinterpret_cast<char*>(prefix), sizeof(prefix)) || prefix[0] != 0xFFFFFFFF) {
+                return false;
+            }
+            if (prefix[1] == 0) {
+                return in.peek() == char_traits<char>::eof(); // end of stream
+            }
+            metadata.resize(prefix[1]);
+            in.read(&metadata[0], prefix[1]);
+            FlatBufferTable message = FlatBufferTable::root(metadata);
+            body.resize(static_cast<size_t>(message.scalar<int64_t>(3)));
+            if (!in.read(&body[0], static_cast<streamsize>(body.size()))) {
+                return false;
+            }
+            uint8_t headerType = message.scalar<uint8_t>(1);
+            FlatBufferTable header = message.table(2);
+            if (headerType == 1) { // Schema
+                for (size_t i = 0; i < header.vector(1).first; ++i) {
+                    FlatBufferTable field = header.element(1, i);
+                    fieldNames.push_back(field.text(0));
+                    fieldDictionaries.push_back(field.has(4) ? field.table(4).scalar<int64_t>(0) : -1);
+                }
+            } else if (headerType == 2) { // DictionaryBatch of utf8 values: validity, offsets, data
+                Batch batch = readBatch(metadata, header.table(1), body);
+                vector<string>& values = dictionaries[header.scalar<int64_t>(0)];
+                for (int64_t i = 0; i < batch.rows; ++i) {
+                    int32_t begin = FlatBufferTable::read<int32_t>(batch.buffers[1], 4 * i);
+                    int32_t end = FlatBufferTable::read<int32_t>(batch.buffers[1], 4 * (i + 1));
+                    values.push_back(batch.buffers[2].substr(begin, end - begin));
+                }
+            } else if (headerType == 3) { // RecordBatch
+                batches.push_back(readBatch(metadata, header, body));
+            } else {
+                return false;
+            }
+        }
+    }
+
+    // FieldNode and Buffer are both structs of two int64s
+    static Batch readBatch(const string& metadata, const FlatBufferTable& table, const string& body) {
+        Batch batch;
+        batch.rows = table.scalar<int64_t>(0);
+        auto nodes = table.vector(1);
+        for (size_t i = 0; i < nodes.first; ++i) {
+            batch.nodes.emplace_back(FlatBufferTable::read<int64_t>(metadata, nodes.second + 16 * i),
+                                     FlatBufferTable::read<int64_t>(metadata, nodes.second + 16 * i + 8));
+        }
+        auto buffers = table.vector(2);
+        for (size_t i = 0; i < buffers.first; ++i) {
+            int64_t offset = FlatBufferTable::read<int64_t>(metadata, buffers.second + 16 * i);
+            int64_t length = FlatBufferTable::read<int64_t>(metadata, buffers.second + 16 * i + 8);
+            batch.buffers.push_back(body.substr(static_cast<size_t>(offset), static_cast<size_t>(length)));
+        }
+        return batch;
+    }
+};
+
+// Rows exported for two users, across more than one record batch, come back with the same
+// user, id, date (null when undated), category, cents and currency
+static void testArrowReadBack() {
+    uint16_t eur = CurrencyCode::BASE, jpy = CurrencyCode::BASE;
+    CurrencyCode::parse("EUR", eur);
+    CurrencyCode::parse("JPY", jpy);
+    struct Row {
+        string user;
+        int id;
+        string date;
+        string category;
+        double amount;
+        string currency;
+    };
+    vector<Row> rows;
+    ArrowExporter exporter;
+    exporter.beginUser("ann", eur);
+    for (int id = 1; id <= static_cast<int>(ArrowExporter::BATCH_ROWS) + 100; ++id) {
+        bool undated = id % 1000 == 0;
+        Row row{"ann", id, undated ? "someday" : DateUtil::toString(19000 + id % 700), id % 3 ? "Food" : "Rent",
+                id * 0.25, id % 7 ? "EUR" : "JPY"};
+        exporter.add(*makeExpense(row.id, row.category, row.amount, row.date, 0, id % 7 ? CurrencyCode::BASE : jpy));
+        rows.push_back(row);
+    }
+    exporter.beginUser("bob", CurrencyCode::BASE);
+    Row unnamed{"bob", 7, "2024-02-29", "Travel>Rail", 12.5, ""};
+    exporter.add(*makeExpense(unnamed.id, unnamed.category, unnamed.amount, unnamed.date));
+    rows.push_back(unnamed);
+
+    const string path = "arrow_read_back_test.arrow";
+    size_t bytes = 0;
+    CHECK(exporter.write(path, bytes));
+    ArrowStream stream;
+    CHECK(stream.read(path));
+    remove(path.c_str());
+
+    const vector<string> NAMES = {"user", "id", "date", "category", "amount", "currency"};
+    CHECK(stream.fieldNames == NAMES);
+    CHECK(stream.fieldDictionaries.size() == 6 && stream.fieldDictionaries[1] == -1 && stream.fieldDictionaries[0] >= 0);
+    CHECK(stream.batches.size() == 2);
+    size_t next = 0;
+    bool matches = true;
+    for (const auto& batch : stream.batches) {
+        CHECK(batch.nodes.size() == 6 && batch.buffers.size() == 12);
+        for (int64_t i = 0; i < batch.rows && next < rows.size(); ++i, ++next) {
+            const Row& row = rows[next];
+            auto int32At = [&](int column) { return FlatBufferTable::read<int32_t>(batch.buffers[2 * column + 1], 4 * i); };
+            auto word = [&](int column) { return stream.dictionaries[stream.fieldDictionaries[column]][int32At(column)]; };
+            const string& validity = batch.buffers[4];
+            bool dated = validity.empty() || (validity[i / 8] >> (i % 8) & 1);
+            matches = matches && word(0) == row.user && int32At(1) == row.id && word(3) == row.category
+                   && FlatBufferTable::read<int64_t>(batch.buffers[9], 8 * i) == llround(row.amount * 100)
+                   && word(5) == row.currency
+                   && (dated ? DateUtil::toString(int32At(2)) == row.date : row.date == "someday");
+        }
+    }
+    CHECK(matches);
+    CHECK(next == rows.size());
+    CHECK(stream.batches[0].nodes[2].second == static_cast<int64_t>(ArrowExporter::BATCH_ROWS / 1000));
+}
+
+// The forecast kept up to date through adds, changes and removals, including rows dated later in
+// the period and outside it, matches one worked out from scratch over the same rows
+static void testForecastUpdates() {
+    int today = DateUtil::today();
+    User user("forecast_test", "secret", 3000);
+    int start = DateUtil::periodStart(user.getBudgetPeriod(), today);
+    int end = DateUtil::periodEnd(user.getBudgetPeriod(), today);
+    auto matchesRecomputed = [&]() {
+        User recomputed("forecast_recomputed", "secret", 3000);
+        user.forEachExpense([&](const shared_ptr<Expense>& expense) {
+            recomputed.addExpense(makeExpense(expense->getId(), expense->getCategory(), expense->getAmount(), expense->getDate()));
+        });
+        SpendForecast::Projection kept = user.getForecast(today), fresh = recomputed.getForecast(today);
+        return fabs(kept.dailyRate - fresh.dailyRate) < 1e-6 && fabs(kept.projectedSpend - fresh.projectedSpend) < 1e-6
+            && kept.runOutDay == fresh.runOutDay;
+    };
+    mt19937 random(49);
+    auto anyDay = [&]() { return DateUtil::toString(start - 5 + static_cast<int>(random() % (end - start + 11))); };
+
+    user.getForecast(today); // kept from here on
+    for (int id = 1; id <= 60; ++id) {
+        user.addExpense(makeExpense(id, "Food", 5 + random() % 50, anyDay()));
+    }
+    CHECK(matchesRecomputed());
+    for (int id = 1; id <= 60; id += 3) {
+        Expense& expense = *user.findExpense(id);
+        user.modifyExpense(expense, expense.getAmount() + 20, CurrencyCode::BASE, "Food", anyDay());
+    }
+    CHECK(matchesRecomputed());
+    for (int id = 2; id <= 60; id += 2) {
+        CHECK(user.removeExpense(id));
+    }
+    CHECK(matchesRecomputed());
+}
+
+// Balances always sum to zero, even for amounts that do not split evenly, and recording the
+// settlement plan as paid clears every balance in at most one transfer fewer than the members
+static void testSettlementSumsToZero() {
+    ExpenseGroup group("trip");
+    vector<string> members;
+    for (int i = 0; i < 9; ++i) {
+        members.push_back("member" + to_string(i));
+        group.addMember(members.back());
+    }
+    auto sum = [&]() {
+        long long total = 0;
+        for (const auto& member : members) {
+            total += group.getBalance(member);
+        }
+        return total;
+    };
+    mt19937 random(50);
+    vector<int> ids;
+    for (int i = 0; i < 400; ++i) {
+        vector<string> split;
+        for (const auto& member : members) {
+            if (random() % 3 == 0) {
+                split.push_back(member);
+            }
+        }
+        const string& payer = members[random() % members.size()];
+        int id = group.addExpense(payer, static_cast<double>(random() % 100000) / 100, "Food", 20000, split);
+        CHECK(id > 0);
+        ids.push_back(id);
+        if (i % 5 == 0) {
+            int removed = ids[random() % ids.size()];
+            auto found = group.getExpenses().find(removed);
+            if (found != group.getExpenses().end()) {
+                CHECK(group.removeExpense(removed, members[found->second.payer]));
+            }
+        }
+        CHECK(sum() == 0);
+    }
+
+    // Only the payer may remove an expense, and a repeated participant is charged once
+    int id = group.addExpense("member0", 10, "Taxi", 20000, {"member1", "member1"});
+    CHECK(!group.removeExpense(id, "member1"));
+    CHECK(group.getExpenses().at(id).participants.size() == 1);
+    CHECK(sum() == 0);
+
+    vector<ExpenseGroup::Transfer> plan = group.settlementPlan();
+    CHECK(plan.size() < members.size());
+    for (const auto& transfer : plan) {
+        CHECK(transfer.cents > 0);
+        group.recordPayment(transfer.from, transfer.to, transfer.cents);
+    }
+    for (const auto& member : members) {
+        CHECK(group.getBalance(member) == 0);
+    }
+    CHECK(group.settlementPlan().empty());
+}
+
+// Groups written through the store come back with the same members, expenses and balances
+static void testGroupReload() {
+    AccountManager* accounts = AccountManager::getInstance();
+    accounts->setExpenseStore(unique_ptr<ExpenseStore>(new FileExpenseStore("group_reload_test_")));
+    ExpenseGroup* group = accounts->createGroup("flat", "ann");
+    CHECK(group != nullptr);
+    group->addMember("bob");
+    group->addMember("cy");
+    int rent = group->addExpense("ann", 900.01, "Housing > Rent", 20000, {});
+    int taxi = group->addExpense("bob", 30, "Taxi", 20003, {"ann", "bob"});
+    group->addExpense("cy", 12.5, "Food", 20004, {"cy"});
+    CHECK(group->removeExpense(taxi, "bob"));
+    CHECK(!group->recordPayment("bob", "bob", 100));
+    CHECK(!group->recordPayment("bob", "dan", 100));
+    CHECK(!group->recordPayment("bob", "ann", 0));
+    CHECK(group->recordPayment("bob", "ann", 100));
+    accounts->saveGroups();
+    vector<long long> balances;
+    for (const auto& member : group->getMembers()) {
+        balances.push_back(group->getBalance(member));
+    }
+
+    accounts->setExpenseStore(unique_ptr<ExpenseStore>(new FileExpenseStore("group_reload_test_")));
+    ExpenseGroup* loaded = accounts->getGroup("flat");
+    CHECK(loaded != nullptr);
+    if (loaded) {
+        CHECK(loaded->getMembers() == vector<string>({"ann", "bob", "cy"}));
+        for (size_t i = 0; i < balances.size(); ++i) {
+            CHECK(loaded->getBalance(loaded->getMembers()[i]) == balances[i]);
+        }
+        CHECK(loaded->getExpenses().size() == 2);
+        CHECK(loaded->getExpenses().count(rent) == 1 && loaded->getExpenses().at(rent).category == "Housing > Rent");
+        int next = loaded->addExpense("ann", 1, "Food", 20005, {});
+        CHECK(next > rent && loaded->getExpenses().count(next) == 1);
+        CHECK(loaded->removeExpense(rent, "ann"));
+    }
+    CHECK(accounts->createGroup("flat", "bob") == nullptr);
+    accounts->discardStore();
+    accounts->setExpenseStore(unique_ptr<ExpenseStore>(new FileExpenseStore()));
+}
+
+int main() {
+    const pair<const char*, void (*)()> TESTS[] = {
+        {"history eviction", testHistoryEviction},
+        {"store round trip", testStoreRoundTrip},
+        {"spend index totals", testSpendIndexTotals},
+        {"top-n and percentiles", testTopNAndPercentiles},
+        {"parse errors", testParseErrors},
+        {"compaction slot remap", testCompactionSlotRemap},
+        {"bulk edit", testBulkEdit},
+        {"tag query evaluation", testTagQueryEvaluation},
+        {"budget ledger rollover", testBudgetLedgerRollover},
+        {"recurring month-end clamping", testRecurringMonthEnd},
+        {"recurring in budgets", testRecurringInBudgets},
+        {"welford removal", testWelfordRemoval},
+        {"mutation log reload", testMutationLogReload},
+        {"category search", testCategorySearch},
+        {"batched conversion", testBatchedConversion},
+        {"duplicate detection", testDuplicateDetection},
+        {"arrow read back", testArrowReadBack},
+        {"forecast updates", testForecastUpdates},
+        {"settlement sums to zero", testSettlementSumsToZero},
+        {"group reload", testGroupReload},
+    };
+    for (const auto& test : TESTS) {
+        int before = failures;
+        test.second();
+        cout << (failures == before ? "ok     " : "FAILED ") << test.first << endl;
+    }
+    cout << failures << " failed check(s)" << endl;
+    return failures == 0 ? 0 : 1;
+}